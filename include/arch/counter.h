@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+
+// Time sources for instrumentation and benchmarks.
+//
+// - Generic timer virtual count (CNTVCT_EL0): always available, fixed frequency
+//   (CNTFRQ_EL0, 62.5 MHz on QEMU virt). Use for wall-clock style latencies.
+// - PMU cycle counter (PMCCNTR_EL0): CPU cycles; must be enabled once with
+//   arch_cycles_enable() before arch_cycles_read() is meaningful.
+
+static inline uint64_t arch_counter_read(void) {
+  uint64_t v;
+  asm volatile("isb; mrs %0, cntvct_el0" : "=r"(v) :: "memory");
+  return v;
+}
+
+static inline uint64_t arch_counter_freq(void) {
+  uint64_t v;
+  asm volatile("mrs %0, cntfrq_el0" : "=r"(v));
+  return v;
+}
+
+static inline uint64_t arch_counter_to_ns(uint64_t ticks) {
+  const uint64_t freq = arch_counter_freq();
+  if (freq == 0) return 0;
+  return (ticks / freq) * 1000000000ull + ((ticks % freq) * 1000000000ull) / freq;
+}
+
+static inline void arch_cycles_enable(void) {
+  uint64_t pmcr;
+  asm volatile("mrs %0, pmcr_el0" : "=r"(pmcr));
+  pmcr |= (1ull << 0) | (1ull << 2);  // E: enable, C: reset cycle counter
+  asm volatile("msr pmcr_el0, %0" :: "r"(pmcr));
+  asm volatile("msr pmcntenset_el0, %0" :: "r"(1ull << 31));  // cycle counter
+  asm volatile("msr pmccfiltr_el0, xzr");                     // count at EL1
+  asm volatile("isb" ::: "memory");
+}
+
+static inline uint64_t arch_cycles_read(void) {
+  uint64_t v;
+  asm volatile("isb; mrs %0, pmccntr_el0" : "=r"(v) :: "memory");
+  return v;
+}
@@ -11,10 +11,20 @@ struct alignas(64) cpu_local {
   unsigned  need_resched;    // scheduler should pick another thread
   unsigned long ticks;       // timer tick counter
   unsigned  irq_depth;       // nesting depth of active IRQ handlers
+  Thread*   handoff_next;    // directed switch target (sched_handoff), or nullptr
+  unsigned  softirq_pending; // raised softirq vectors (bit per SOFTIRQ_*)
+  unsigned  in_softirq;      // softirq handlers running (IRQ exit or ksoftirqd)
+  unsigned  cpu_id;          // logical CPU number (== MPIDR Aff0 on virt)
+  uint64_t  irq_entry_cnt;   // CNTVCT at irq_el1 entry (IRQ_LATENCY_TRACE)
+  uint64_t  irq_eret_cnt;    // CNTVCT just before the last IRQ eret (IRQ_LATENCY_TRACE)
 } __attribute__((aligned(64)));
 #ifdef __cplusplus
 static_assert(offsetof(struct cpu_local, irq_stack_top) == 0,
               "cpu_local.irq_stack_top at offset 0");
+static_assert(offsetof(struct cpu_local, irq_depth) == 32,
+              "cpu_local.irq_depth at offset 32 (boot/vectors.S CPU_IRQ_DEPTH)");
+static_assert(offsetof(struct cpu_local, irq_entry_cnt) == 64 && offsetof(struct cpu_local, irq_eret_cnt) == 72,
+              "cpu_local latency stamps at offsets 64/72 (boot/vectors.S)");
 static_assert(sizeof(struct cpu_local) % 64 == 0,
               "cpu_local aligned to 64B");
 #endif
@@ -10,6 +10,29 @@ static inline uint32_t mmio_r32(uint64_t a){ return *(volatile uint32_t*)a; }
 static inline void mmio_w64(uint64_t a, uint64_t v){ *(volatile uint64_t*)a=v; }
 static inline uint64_t mmio_r64(uint64_t a){ return *(volatile uint64_t*)a; }
 
+#define GIC_SPI_BASE        32u     // INTIDs 0..15 SGI, 16..31 PPI, 32.. SPI
+#define GIC_MAX_INTID       1020u   // 1020..1023 are special (1023 = spurious)
+#define GIC_INTID_SPURIOUS  1023u
+#define GIC_PRIO_DEFAULT    0x80u
+
 void gic_init(void);
+// Enable the CPU interface system registers and open ICC_PMR_EL1. Needed
+// before the first local_irq_save() when IRQ_PMR_MASKING is on.
+void gic_cpuif_early_init(void);
 uint32_t gic_ack(void);
 void gic_eoi(uint32_t i);
+
+// Per-INTID configuration. SGIs/PPIs are programmed in this CPU's
+// redistributor, SPIs in the distributor (SPIs are also routed to this CPU).
+// Returns -1 for INTIDs the GIC does not implement.
+int  gic_irq_config(uint32_t intid, uint8_t prio, int edge);
+int  gic_irq_set_priority(uint32_t intid, uint8_t prio);
+void gic_irq_enable(uint32_t intid);
+void gic_irq_disable(uint32_t intid);
+// Raise SGI |sgi| (0..15) on the calling CPU (ICC_SGI1R_EL1).
+void gic_send_sgi_self(uint32_t sgi);
+// Raise SGI |sgi| on every CPU whose Aff0 bit is set in |targets|, within the
+// caller's cluster (same Aff3.Aff2.Aff1, Aff0 < 16). One register write.
+void gic_send_sgi(uint32_t sgi, uint16_t targets);
+// Number of implemented INTIDs (SGI+PPI+SPI), from GICD_TYPER.ITLinesNumber.
+uint32_t gic_num_intids(void);
@@ -8,7 +8,7 @@ struct alignas(16) irq_frame {
   uint64_t sp;            // pre-interrupt SP
   uint64_t spsr;          // saved program status
   uint64_t elr;           // return address
-  uint64_t reserved;      // keeps the frame 16-byte aligned (future SIMD spill)
+  uint64_t pmr;           // interrupted ICC_PMR_EL1 (IRQ_PMR_MASKING); keeps 16-byte alignment
 };
 static_assert(sizeof(struct irq_frame) == 192, "irq_frame size must match assembly");
 static_assert(alignof(struct irq_frame) == 16, "irq_frame must be 16-byte aligned");
@@ -1,14 +1,104 @@
 #pragma once
 
-static inline unsigned long local_irq_save(void) {
+// Local IRQ masking. By default this is PSTATE.DAIF.I, which blocks every
+// interrupt. With IRQ_PMR_MASKING the GIC CPU interface priority mask
+// (ICC_PMR_EL1) is raised instead: DAIF.I stays clear in thread context and
+// only INTIDs more urgent than GIC_PMR_IRQOFF (IRQ_PRIO_NMI, see irq.h) are
+// still delivered, so a pseudo-NMI can sample or watchdog IRQ-off regions.
+// The returned flags are the DAIF or PMR value to restore, respectively.
+#ifndef IRQ_PMR_MASKING
+#define IRQ_PMR_MASKING 0
+#endif
+
+// The GIC signals an INTID only if its priority is numerically below PMR.
+#define GIC_PMR_UNMASKED 0xFFu
+#define GIC_PMR_IRQOFF   0x40u
+
+#define DAIF_I_BIT       (1ul << 7)
+
+// With IRQSOFF_TRACE every masking transition reports to the irqsoff tracer.
+// The helpers are forced inline so the recorded address is the caller's.
+#define IRQFLAGS_INLINE static inline __attribute__((always_inline))
+
+#include "irqsoff_trace.h"
+
+#if IRQSOFF_TRACE
+IRQFLAGS_INLINE uintptr_t irqflags_ip(void) {
+  uintptr_t ip;
+  asm volatile("adr %0, ." : "=r"(ip));
+  return ip;
+}
+#define IRQFLAGS_TRACE_OFF_IF(was_on) do { if (was_on) trace_irqs_off(irqflags_ip()); } while (0)
+#define IRQFLAGS_TRACE_ON_IF(turn_on) do { if (turn_on) trace_irqs_on(irqflags_ip()); } while (0)
+#else
+#define IRQFLAGS_TRACE_OFF_IF(was_on) do { } while (0)
+#define IRQFLAGS_TRACE_ON_IF(turn_on) do { } while (0)
+#endif
+
+#if IRQ_PMR_MASKING
+IRQFLAGS_INLINE unsigned long local_irq_save(void) {
+  unsigned long flags;
+  asm volatile("mrs %0, ICC_PMR_EL1" : "=r"(flags) :: "memory");
+  // PMR writes are self-synchronising: nothing below the mask is taken after
+  // this instruction.
+  asm volatile("msr ICC_PMR_EL1, %0" :: "r"((unsigned long)GIC_PMR_IRQOFF) : "memory");
+  IRQFLAGS_TRACE_OFF_IF(flags > GIC_PMR_IRQOFF);
+  return flags;
+}
+
+IRQFLAGS_INLINE void local_irq_restore(unsigned long flags) {
+  IRQFLAGS_TRACE_ON_IF(flags > GIC_PMR_IRQOFF);
+  asm volatile("msr ICC_PMR_EL1, %0" :: "r"(flags) : "memory");
+  // Make the new mask visible to the redistributor so pending IRQs are
+  // signalled now rather than eventually.
+  asm volatile("dsb sy" ::: "memory");
+}
+
+IRQFLAGS_INLINE void local_irq_enable(void) {
+  local_irq_restore(GIC_PMR_UNMASKED);
+}
+
+IRQFLAGS_INLINE void local_irq_disable(void) {
+#if IRQSOFF_TRACE
+  unsigned long prev;
+  asm volatile("mrs %0, ICC_PMR_EL1" : "=r"(prev) :: "memory");
+#endif
+  asm volatile("msr ICC_PMR_EL1, %0" :: "r"((unsigned long)GIC_PMR_IRQOFF) : "memory");
+  IRQFLAGS_TRACE_OFF_IF(prev > GIC_PMR_IRQOFF);
+}
+
+IRQFLAGS_INLINE unsigned long arch_irq_pmr_read(void) {
+  unsigned long v;
+  asm volatile("mrs %0, ICC_PMR_EL1" : "=r"(v) :: "memory");
+  return v;
+}
+#else
+IRQFLAGS_INLINE unsigned long local_irq_save(void) {
   unsigned long flags;
   asm volatile("mrs %0, daif" : "=r"(flags) :: "memory");
   asm volatile("msr daifset, #2" ::: "memory");
   asm volatile("isb" ::: "memory");
+  IRQFLAGS_TRACE_OFF_IF(!(flags & DAIF_I_BIT));
   return flags;
 }
 
-static inline void local_irq_restore(unsigned long flags) {
+IRQFLAGS_INLINE void local_irq_restore(unsigned long flags) {
+  IRQFLAGS_TRACE_ON_IF(!(flags & DAIF_I_BIT));
   asm volatile("msr daif, %0" :: "r"(flags) : "memory");
   asm volatile("isb" ::: "memory");
 }
+
+IRQFLAGS_INLINE void local_irq_enable(void) {
+  IRQFLAGS_TRACE_ON_IF(1);
+  asm volatile("msr daifclr, #2" ::: "memory");
+}
+
+IRQFLAGS_INLINE void local_irq_disable(void) {
+#if IRQSOFF_TRACE
+  unsigned long prev;
+  asm volatile("mrs %0, daif" : "=r"(prev) :: "memory");
+#endif
+  asm volatile("msr daifset, #2" ::: "memory");
+  IRQFLAGS_TRACE_OFF_IF(!(prev & DAIF_I_BIT));
+}
+#endif
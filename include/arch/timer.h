@@ -2,3 +2,9 @@
 #include <stdint.h>
 void timer_init_hz(uint32_t hz);
 void timer_irq();
+// Compare value (CNTV_CVAL_EL0 / CNTP_CVAL_EL0) of the pending tick: the
+// counter value the current timer interrupt was due at.
+uint64_t timer_deadline();
+// Compare value of the most recent tick, latched by timer_irq() before it
+// re-arms: the counter value that tick was due at.
+uint64_t timer_last_deadline();
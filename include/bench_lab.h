@@ -0,0 +1,21 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// cyclictest-style wakeup latency benchmark (needs SCHED_POLICY=PRIO).
+// BENCH_THREADS measurement threads at descending priorities sleep to
+// absolute tick deadlines with thread_sleep_until() and record how late they
+// ran against the compare value of the deadline tick. Thread i uses an
+// interval of BENCH_INTERVAL_TICKS + i ticks and takes BENCH_LOOPS samples.
+// - mode=1: idle system (baseline)
+// - mode=2: BENCH_HOGS CPU-hog threads
+// - mode=3: hogs + BENCH_LOCKERS threads contending on a mutex and on an
+//           irqsave spinlock
+// - mode=4: hogs + lockers + BENCH_DMA_THREADS threads streaming DMA copies
+void bench_lab_setup(unsigned mode);
+
+#ifdef __cplusplus
+}
+#endif
@@ -13,6 +13,12 @@ int dma_submit_memcpy(void* dst, const void* src, size_t len,
                       dma_cb_t cb, void* user);
 void dma_poll_complete(void);
 
+// Completion is signalled through a "doorbell" SGI whose threaded handler
+// runs dma_poll_complete() in a kernel thread at DMA_IRQ_THREAD_PRIO. Until
+// dma_irq_init() is called (after irq_init()), callers poll directly.
+#define DMA_DOORBELL_SGI 2u
+int dma_irq_init(void);
+
 // Optional helper: allocate from the dedicated DMA window.
 void* dma_alloc_buffer(size_t len, size_t align);
 
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "thread.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct mailbox;
+
+// A thread waiting on one or more objects through event_wait_any() (or
+// notify_wait()) links one poller per object into that object's poller list.
+// Pollers live on the waiter's stack and are only touched with IRQs masked,
+// which is all the exclusion this single-CPU kernel needs (as for waitqs).
+struct event_poller {
+  Thread*       thread;
+  uint64_t      mask;   // notification bits of interest (ignored for mailboxes)
+  event_poller* next;
+};
+
+// Wake every poller on |*head| whose mask intersects |bits|. Caller has
+// preemption disabled and IRQs masked.
+void event_pollers_wake(event_poller** head, uint64_t bits);
+
+// Notification object: a 64-bit word of signal bits. notify_signal() is an
+// atomic OR that only takes the slow path (IRQ-masked waiter scan + wakeup)
+// when somebody is waiting for one of the newly set bits. Safe from IRQ
+// context, so an IRQ handler can post "source N fired" with one call.
+struct notification {
+  uint64_t      bits;
+  event_poller* pollers;
+};
+
+void     notify_init(notification* n);
+void     notify_signal(notification* n, uint64_t bits);
+// Atomically clear and return the pending bits in |mask| (0 if none).
+uint64_t notify_take(notification* n, uint64_t mask);
+// Pending bits without clearing them.
+uint64_t notify_peek(const notification* n);
+// Block until a bit in |mask| is pending, then clear and return those bits.
+// Returns 0 on timeout (ticks; TIMEOUT_NO_WAIT / TIMEOUT_FOREVER).
+uint64_t notify_wait(notification* n, uint64_t mask, uint64_t timeout_ticks);
+
+// Wait for any of several objects.
+#define EVENT_WAIT_MAX   8
+#define EVENT_SRC_NOTIFY 1   // ready when (bits & mask) != 0
+#define EVENT_SRC_MBOX   2   // ready when a message can be received
+
+struct event_source {
+  unsigned type;
+  void*    obj;        // notification* or mailbox*
+  uint64_t mask;       // EVENT_SRC_NOTIFY: bits of interest
+};
+
+// Block until at least one source is ready and return the index of the first
+// ready one, or -1 on timeout / bad arguments. Readiness is level-triggered
+// and nothing is consumed: follow up with notify_take() / mbox_tryrecv(),
+// which may come up empty if another thread got there first.
+int event_wait_any(const event_source* srcs, unsigned n, uint64_t timeout_ticks);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "thread.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Synchronous rendezvous IPC (L4-style call / reply-and-wait).
+//
+// A client ipc_call()s an endpoint and blocks until the server replies. If a
+// server is already waiting in ipc_reply_wait(), the payload is copied straight
+// into the server's receive buffer and the CPU is handed to the server with
+// sched_handoff() (no runqueue pick). The server runs on the client's
+// priority and remaining time slice until it replies; the reply hands the CPU
+// (and the rest of the slice) back to the client the same way.
+// Callers that queue while the server is busy raise it to their priority
+// as well, until the requests ahead of them are served.
+//
+// Payloads are a few message registers copied by value; bulk data should be
+// passed by reference (single address space).
+
+#define IPC_MSG_WORDS 4
+
+struct ipc_msg {
+  uint64_t mr[IPC_MSG_WORDS];
+};
+
+struct ipc_endpoint {
+  Thread* server;       // server blocked in ipc_reply_wait(), or nullptr
+  Thread* busy;         // server handling a request, or nullptr
+  Thread* callers;      // clients waiting for the server (Thread::wait_next)
+};
+
+void ipc_endpoint_init(ipc_endpoint* ep);
+
+// Client side: send |msg| and block for the reply, which overwrites |msg|.
+// Returns 0 on success, -1 on invalid use (no current thread).
+int ipc_call(ipc_endpoint* ep, ipc_msg* msg);
+
+// Server side: reply |reply| to the current caller (nullptr on the first
+// call, when there is none) and wait for the next request, received into
+// |recv|. |reply| and |recv| may alias. Returns 0 on success, -1 on invalid use.
+int ipc_reply_wait(ipc_endpoint* ep, const ipc_msg* reply, ipc_msg* recv);
+
+#ifdef __cplusplus
+}
+#endif
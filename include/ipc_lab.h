@@ -0,0 +1,18 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// IPC lab (requires SCHED_POLICY=PRIO):
+// - mode=1: ipc_call/ipc_reply_wait round-trip microbenchmark (direct handoff)
+//           vs a semaphore ping-pong baseline
+// - mode=2: mailbox lanes, timed send/receive and multi-reader wakeup
+// - mode=3: event_wait_any() over a notification and a mailbox
+// - mode=4: a high-priority caller queued behind a low-priority request
+//           donates to the busy server ahead of a medium-priority hog
+void ipc_lab_setup(unsigned mode);
+
+#ifdef __cplusplus
+}
+#endif
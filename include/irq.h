@@ -1,10 +1,98 @@
 #pragma once
+#include <stdint.h>
+
 #include "arch/irq.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 void irq_handler_el1(struct irq_frame* frame);
+// Outermost IRQ exit (irq_el1), on the interrupted thread's stack below its
+// saved frame with IRQs masked: switch threads if a wakeup asked for it.
+void irq_exit_schedule(void);
+
+// Interrupt dispatch table. One flat slot per GIC INTID (SGI, PPI and SPI),
+// so dispatch is a bounds check plus one indexed load. Handlers run in
+// hard-IRQ context and must not block.
+//
+// With IRQ_NESTING (default) a handler runs with IRQs unmasked at the GIC
+// running priority of its INTID: only INTIDs of a strictly more urgent
+// priority group can preempt it, equal and lower ones stay pending until EOI.
+// Anything a handler shares with another interrupt must therefore be touched
+// under local_irq_save() (all IRQ-safe kernel APIs already do), or the
+// handler is registered with IRQF_NO_NEST to run fully masked.
+typedef void (*irq_handler_t)(uint32_t intid, void* ctx);
+
+#ifndef IRQ_NESTING
+#define IRQ_NESTING 1
+#endif
+
+#define IRQ_NR               1020u   // GIC_MAX_INTID
+
+#define IRQF_TRIGGER_LEVEL   0x0u
+#define IRQF_TRIGGER_EDGE    0x1u
+#define IRQF_NO_ENABLE       0x2u    // register but leave the INTID masked
+#define IRQF_ONESHOT         0x4u    // threaded: keep masked until thread_fn returns
+#define IRQF_NO_NEST         0x8u    // run the handler with IRQs masked
+#define IRQF_NMI             0x10u   // pseudo-NMI, see below
+// Optional GIC priority (lower = more urgent): IRQF_PRIO(IRQ_PRIO_HIGH).
+// Default IRQ_PRIO_NORMAL.
+#define IRQF_PRIO(p)         ((((uint32_t)(p)) & 0xFFu) << 8)
+#define IRQF_PRIO_MASK       0xFF00u
+
+// Priority levels. GICs implement at least 5 priority bits and preempt on the
+// group priority (ICC_BPR1_EL1 is clamped to its minimum, 0x10 granules on
+// QEMU), so levels are kept 0x20 apart.
+#define IRQ_PRIO_NMI         0x20u   // IRQF_NMI only; above GIC_PMR_IRQOFF
+#define IRQ_PRIO_HIGH        0x40u   // latency-critical devices
+#define IRQ_PRIO_TIMER       0x60u   // scheduler tick
+#define IRQ_PRIO_NORMAL      0x80u   // GIC_PRIO_DEFAULT
+#define IRQ_PRIO_BULK        0xA0u   // bulk I/O completions (DMA doorbell)
+
+// IRQF_NMI forces IRQ_PRIO_NMI. With IRQ_PMR_MASKING such an INTID is still
+// delivered inside local_irq_save() sections (profilers, hard-lockup
+// watchdogs), so its handler runs fully masked, may interrupt any kernel code
+// and must only touch per-CPU counters or atomics: no locks, no wakeups, no
+// raise_softirq(). Its exit never runs softirqs or preempts. Without
+// IRQ_PMR_MASKING it is just the most urgent, non-nesting level.
+//
+// Install |handler| for |intid|, configure trigger/priority (and routing to
+// this CPU for SPIs) and enable it. Returns 0 on success, -1 if the INTID is
+// out of range/unimplemented or already has a handler.
+int  irq_register(uint32_t intid, irq_handler_t handler, void* ctx, uint32_t flags);
+int  irq_unregister(uint32_t intid);
+void irq_enable(uint32_t intid);
+void irq_disable(uint32_t intid);
+// Change the GIC priority of a registered INTID (lower = more urgent).
+int  irq_set_priority(uint32_t intid, uint8_t prio);
+
+// Threaded handlers. |hard| runs in IRQ context and should only ack/quiesce
+// the device; returning IRQ_WAKE_THREAD schedules |thread_fn| on a dedicated
+// kernel thread at scheduler priority |prio|, where it may block and runs
+// with IRQs enabled. |hard| may be nullptr (always wake the thread). With
+// IRQF_ONESHOT the INTID is masked in the GIC from the top half until
+// |thread_fn| returns (required for level-triggered sources that the top
+// half does not silence). Wakeups while the thread is busy coalesce into one
+// more run. Call after sched_init() and gic_init(). At most 16 threaded
+// handlers exist; their descriptors come from a static pool.
+enum irq_return {
+  IRQ_NONE = 0,
+  IRQ_HANDLED = 1,
+  IRQ_WAKE_THREAD = 2,
+};
+typedef enum irq_return (*irq_hard_handler_t)(uint32_t intid, void* ctx);
+typedef void (*irq_thread_fn_t)(uint32_t intid, void* ctx);
+
+int irq_register_threaded(uint32_t intid, irq_hard_handler_t hard, irq_thread_fn_t thread_fn,
+                          void* ctx, uint32_t flags, int prio);
+
+// Number of times |intid| was taken (including unhandled ones).
+uint64_t irq_count(uint32_t intid);
+// Print every INTID with a non-zero count, and the deepest nesting seen.
+void irq_dump_stats(void);
+
+// Install the scheduler tick handler on the timer PPI (after gic_init()).
+void irq_init(void);
 #ifdef __cplusplus
 }
 #endif
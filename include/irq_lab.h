@@ -0,0 +1,26 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// IRQ lab (requires SCHED_POLICY=PRIO):
+// - mode=1: softirq restart budget / ksoftirqd overflow and workqueue items
+//           queued from hard-IRQ context that sleep
+// - mode=2: nested IRQs: a higher-priority SGI preempts a running handler,
+//           an equal-priority one waits for its EOI (needs IRQ_NESTING=1)
+// - mode=3: pseudo-NMI: an IRQF_NMI SGI lands inside local_irq_save(), a
+//           normal one waits for the restore (needs IRQ_PMR_MASKING=1)
+// - mode=4: IPIs on one CPU: queued calls to self (one SGI, FIFO), local
+//           calls, reschedule kick and batched TLB flushes
+// - mode=5: IRQ latency histograms over 2000 ticks (needs IRQ_LATENCY_TRACE=1)
+// - mode=6: lock-free mem_pool_lf shared by a thread and an SGI handler with
+//           IRQs unmasked: no block handed out twice, none lost
+// - mode=7: ringbuf.h: an SGI handler feeds a BlockingRing<SpscRing> drained
+//           by a thread (order, no loss), then MpmcRing bulk push/pop across
+//           two producer and two consumer threads (count and sum)
+void irq_lab_setup(unsigned mode);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,55 @@
+#pragma once
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// IRQ entry latency harness (IRQ_LATENCY_TRACE=1). irq_el1 stamps CNTVCT at
+// vector entry and right before eret; irq_handler_el1 adds stamps after
+// gic_ack() and after the handler. Per-CPU histograms:
+//
+//   timer   vector entry - programmed CVAL of the tick (hardware + pipeline)
+//   entry   gic_ack() done - vector entry (frame save, stack switch, C prologue)
+//   handler handler done - gic_ack() done
+//   exit    eret - handler done (EOI, softirqs, frame restore)
+//
+// Counter ticks are 16 ns on QEMU virt (62.5 MHz); the histograms use
+// IRQ_LAT_BUCKET_TICKS-wide buckets, the last one catching everything above.
+#ifndef IRQ_LATENCY_TRACE
+#define IRQ_LATENCY_TRACE 0
+#endif
+
+#define IRQ_LAT_BUCKETS       128
+#ifndef IRQ_LAT_BUCKET_TICKS
+#define IRQ_LAT_BUCKET_TICKS  8
+#endif
+
+enum {
+  IRQ_LAT_TIMER = 0,
+  IRQ_LAT_ENTRY,
+  IRQ_LAT_HANDLER,
+  IRQ_LAT_EXIT,
+  IRQ_LAT_NR,
+};
+
+struct irq_lat_summary {
+  uint64_t samples;
+  uint64_t min_ns;
+  uint64_t avg_ns;
+  uint64_t max_ns;
+  uint64_t p99_ns;   // upper edge of the bucket holding the 99th percentile
+};
+
+// Called by irq_handler_el1 on the way out (IRQs masked). |cval| is the
+// timer deadline for the tick INTID, 0 otherwise.
+void irq_latency_record(uint64_t entry, uint64_t cval, uint64_t acked, uint64_t handled);
+
+void irq_latency_reset(void);
+int  irq_latency_summary(unsigned cpu, unsigned kind, irq_lat_summary* out);
+// Print every non-empty histogram of every CPU.
+void irq_latency_dump(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,49 @@
+#pragma once
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// irqsoff / preemptoff tracer (IRQSOFF_TRACE=1). Every transition that masks
+// local IRQs (local_irq_save/disable, hardirq entry) or takes preempt_cnt
+// from 0 to 1 in thread context opens a section; the matching unmask or
+// preempt_enable closes it. Per CPU and per kind the longest section is kept
+// along with the code addresses that opened and closed it; resolve them with
+// addr2line against kernel.elf.
+//
+// The hooks run with IRQs masked (IRQ side) or only touch state IRQs never
+// touch (preempt side, irq_depth == 0), so they take no locks. Pseudo-NMIs
+// are not traced.
+#ifndef IRQSOFF_TRACE
+#define IRQSOFF_TRACE 0
+#endif
+
+enum {
+  IRQSOFF_KIND_IRQ = 0,   // local IRQs masked
+  IRQSOFF_KIND_PREEMPT,   // preemption disabled
+  IRQSOFF_KIND_NR,
+};
+
+struct irqsoff_max {
+  uint64_t  sections;   // sections closed since the last reset
+  uint64_t  max_ns;
+  uintptr_t start_ip;   // where the longest section was opened
+  uintptr_t end_ip;     // where it was closed
+};
+
+// Hooks; |ip| is the code address of the transition. Opening an open section
+// or closing a closed one is a no-op.
+void trace_irqs_off(uintptr_t ip);
+void trace_irqs_on(uintptr_t ip);
+void trace_preempt_off(uintptr_t ip);
+void trace_preempt_on(uintptr_t ip);
+
+void irqsoff_trace_reset(void);
+int  irqsoff_trace_max(unsigned cpu, unsigned kind, irqsoff_max* out);
+// Print the longest section of each kind on every online CPU.
+void irqsoff_trace_dump(void);
+
+#ifdef __cplusplus
+}
+#endif
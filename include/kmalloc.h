@@ -0,0 +1,62 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// General-purpose kernel heap on top of the buddy page allocator.
+//
+// Requests up to KMALLOC_MAX_SMALL bytes are rounded to a size class (powers
+// of two plus the mid-points between them: 16, 32, 48, 64, 96, ... 1024) and
+// served from one-page slabs, each a mem_pool behind a small header at the
+// start of the page. Every class keeps a list of partially used slabs and one
+// spare empty slab; further empty slabs go back to the page allocator, so the
+// heap shrinks after a burst. Larger requests get their own 2^order page block
+// with the same header. kfree() finds the header by rounding the pointer down
+// to its page.
+//
+// Alloc and free are O(1) except when a slab is created or a large block is
+// split/merged (O(PAGE_ORDER_MAX)). Each size class has its own irqsave lock,
+// so both are callable from IRQ context. Memory is 16-byte aligned.
+//
+// Built with KMALLOC_TLSF=1, every request is served from one TLSF heap
+// (tlsf.h) grown in PAGE_ORDER_MAX blocks instead: bounded O(1) alloc/free
+// for real-time paths, at the cost of one lock for all sizes. The heap never
+// shrinks, and requests larger than one block's payload fail. The class
+// statistics then report no classes, and large_allocs and large_pages count
+// live blocks and heap pages.
+#define KMALLOC_MAX_SMALL 1024u
+
+// kmalloc() flags.
+#define KM_ZERO 0x1u   // zero the returned memory
+
+void* kmalloc(size_t size, uint32_t flags);
+// Accepts nullptr. Frees of pointers kmalloc() never returned are reported on
+// the UART and ignored when the header check catches them; so are double
+// frees of slab objects, caught by the slab's allocation bitmap.
+void  kfree(void* p);
+// Usable size of an allocation (the class size or the large block payload).
+size_t ksize(const void* p);
+
+struct kmalloc_class_stats {
+  size_t obj_size;
+  size_t slabs;      // including the spare
+  size_t in_use;     // live objects
+};
+
+struct kmalloc_stats {
+  size_t large_allocs;   // live large blocks
+  size_t large_pages;
+  size_t classes;
+};
+
+void kmalloc_stats_get(struct kmalloc_stats* out);
+// Returns -1 when |cls| >= kmalloc_stats.classes.
+int  kmalloc_class_stats_get(unsigned cls, struct kmalloc_class_stats* out);
+void kmalloc_dump(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -5,6 +5,9 @@ extern "C" {
 #endif
 void   kmem_init(void);
 void*  kmem_alloc_aligned(size_t size, size_t align); // align is power of two
+// Called by page_alloc_init(): from now on an exhausted heap refills with
+// 2 MiB chunks from alloc_pages() instead of failing.
+void   kmem_handoff(void);
 #ifdef __cplusplus
 }
 #endif
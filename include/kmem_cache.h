@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mem_pool.h"
+#include "spinlock.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Object caches (Bonwick, "The Slab Allocator", USENIX 1994).
+//
+// A cache hands out objects of one type from slabs of 2^order pages. Each slab
+// is a mem_pool behind a header at the start of the block. The constructor
+// runs once per object when its slab is created, not on every allocation, so
+// kmem_cache_alloc() returns an object that is already in its constructed
+// state. Callers must return objects to that state before kmem_cache_free().
+// Objects keep their state while free because the mem_pool link word lives in
+// a prefix in front of each object, not in the object itself.
+//
+// Slab coloring: the space a slab cannot fill with whole objects is used to
+// shift the first object by a different multiple of the cache line in each
+// new slab. Objects at the same index in different slabs then land in
+// different cache sets instead of all competing for the same ones.
+//
+// Each slab header carries a mem_pool allocation bitmap, so a double free is
+// rejected in O(1).
+//
+// Like kmalloc, each cache keeps a partial list plus one spare empty slab and
+// gives further empty slabs back to the page allocator. Alloc/free take the
+// cache's irqsave lock and are O(1) unless a slab is created or released.
+typedef void (*kmem_ctor_t)(void* obj);
+
+struct kmem_slab;
+
+struct kmem_cache {
+  const char*        name;
+  size_t             obj_size;
+  size_t             align;
+  kmem_ctor_t        ctor;
+  unsigned           slab_order;
+  size_t             header_bytes;  // slab header + allocation bitmap
+  size_t             link_bytes;    // prefix holding the mem_pool link
+  size_t             stride;        // link + object, rounded to |align|
+  size_t             per_slab;
+  size_t             colors;        // distinct first-object offsets
+  size_t             color_next;
+  struct spinlock    lock;
+  struct kmem_slab*  partial;
+  struct kmem_slab*  spare;
+  size_t             slabs;
+  size_t             in_use;
+  uint64_t           ctor_calls;
+  struct kmem_cache* next;          // all caches, for kmem_cache_dump()
+};
+
+// |align| 0 means 16; it is rounded up to a power of two. |ctor| may be
+// nullptr. Returns nullptr if the object does not fit a slab of
+// PAGE_ORDER_MAX pages or memory is short.
+struct kmem_cache* kmem_cache_create(const char* name, size_t size, size_t align, kmem_ctor_t ctor);
+void* kmem_cache_alloc(struct kmem_cache* c);
+// Returns 0, or -1 if |obj| is not a free-able object of |c|.
+int   kmem_cache_free(struct kmem_cache* c, void* obj);
+
+void  kmem_cache_dump(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "sync.h"
+
+#ifndef LOCKDEP
+#define LOCKDEP 0
+#endif
+
+#ifndef SYNC_LAB_MODE
+#define SYNC_LAB_MODE 0
+#endif
+
+// The deadlock labs rely on lockdep even when LOCKDEP=0.
+#if LOCKDEP || SYNC_LAB_MODE == 5 || SYNC_LAB_MODE == 6
+#define LOCKDEP_ENABLED 1
+#else
+#define LOCKDEP_ENABLED 0
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Lock-class dependency validator (mutexes only).
+//
+// Every mutex belongs to a lock class: by default its mutex_init() call site,
+// or an explicit key (mutex_set_lock_class()). Whenever a thread acquires class B while already
+// holding class A, the edge A->B is recorded in a global dependency graph. A
+// new edge that closes a cycle is a potential deadlock (e.g. AB/BA) and is
+// reported the first time the offending order is *attempted*, even if the two
+// orders never overlap at runtime.
+//
+// After the first report lockdep turns itself off (the graph is no longer
+// trustworthy), mirroring Linux' debug_locks_off().
+//
+// All entry points must be called with preemption disabled.
+
+// Validate and record the dependencies of |cur| (current held set:
+// Thread::owned_mutexes) -> |m|. Called before blocking in mutex_lock().
+void lockdep_acquire(Thread* cur, mutex* m);
+
+// Drop the class keyed by |key| and every edge into or out of it. Use it
+// before the key's storage is reused; mutex_destroy() calls it for mutexes
+// that are their own class.
+void lockdep_free_key(const void* key);
+
+// Print graph statistics (classes, edges, checks).
+void lockdep_dump_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
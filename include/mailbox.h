@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "event.h"
+#include "thread.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Bounded asynchronous mailbox: fixed-size messages copied into a ring, one
+// ring per priority lane. Receivers always drain the highest non-empty lane
+// first (FIFO within a lane).
+//
+// Senders block while their lane is full; receivers block while every lane
+// is empty. Each posted message wakes one blocked receiver (highest priority
+// first), so N messages release up to N readers. Woken threads re-check the
+// mailbox, so a message taken by someone else just sends them back to sleep.
+//
+// Timeouts are in scheduler ticks: TIMEOUT_NO_WAIT (try once) or
+// TIMEOUT_FOREVER. The non-blocking calls may be used from IRQ context.
+// All functions return 0 on success, -1 on timeout / would-block / bad args.
+
+#define MBOX_LANES        2
+#define MBOX_LANE_NORMAL  0
+#define MBOX_LANE_URGENT  1
+
+// Bytes of storage needed for |depth| messages of |msg_size| bytes per lane.
+#define MBOX_STORAGE_BYTES(msg_size, depth) ((size_t)(msg_size) * (size_t)(depth) * MBOX_LANES)
+
+struct mbox_lane {
+  uint32_t head;        // free-running read index
+  uint32_t tail;        // free-running write index
+};
+
+struct mailbox {
+  uint8_t*  storage;
+  uint32_t  msg_size;
+  uint32_t  depth;                 // messages per lane (power of two)
+  mbox_lane lanes[MBOX_LANES];
+  Thread*   senders[MBOX_LANES];   // blocked on a full lane (Thread::wait_next)
+  Thread*   receivers;             // blocked on an empty mailbox
+  event_poller* pollers;           // event_wait_any() waiters
+};
+
+// |storage| must hold MBOX_STORAGE_BYTES(msg_size, depth) bytes; |depth| must
+// be a power of two.
+int mbox_init(mailbox* mb, void* storage, size_t msg_size, unsigned depth);
+
+int mbox_send(mailbox* mb, const void* msg, unsigned lane);
+int mbox_trysend(mailbox* mb, const void* msg, unsigned lane);
+int mbox_send_timeout(mailbox* mb, const void* msg, unsigned lane, uint64_t timeout_ticks);
+
+// |lane| (optional) receives the lane the message came from.
+int mbox_recv(mailbox* mb, void* msg, unsigned* lane);
+int mbox_tryrecv(mailbox* mb, void* msg, unsigned* lane);
+int mbox_recv_timeout(mailbox* mb, void* msg, unsigned* lane, uint64_t timeout_ticks);
+
+// Messages currently queued across all lanes (snapshot).
+unsigned mbox_count(const mailbox* mb);
+
+#ifdef __cplusplus
+}
+#endif
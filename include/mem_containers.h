@@ -0,0 +1,135 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mem_resource.h"
+
+// Small containers that take their memory from a mem_resource.
+//
+// - SmallVector<T, N>: N elements inline (on the stack or inside the owning
+//   object), then grows by doubling into the resource. With an arena behind
+//   it, outgrowing the inline slots costs a bump and nothing to free.
+// - Ring<T>: FIFO whose capacity is chosen at init() and allocated from the
+//   resource (rounded up to a power of two).
+//
+// Neither is synchronized; for cross-context handoff use the rings in
+// ringbuf.h. There are no exceptions: operations that need memory return
+// false when the resource is exhausted and leave the container unchanged.
+// T must be trivially copyable, as elements are copied by value.
+
+template <typename T, size_t N>
+class SmallVector {
+  static_assert(N >= 1, "SmallVector needs at least one inline slot");
+  static_assert(__is_trivially_copyable(T), "SmallVector copies elements by value");
+
+ public:
+  explicit SmallVector(mem_resource* mr) : mr_(mr), data_(inline_), size_(0), cap_(N) {}
+  ~SmallVector() { drop_heap(); }
+  SmallVector(const SmallVector&) = delete;
+  SmallVector& operator=(const SmallVector&) = delete;
+
+  static constexpr size_t inline_capacity() { return N; }
+
+  bool push_back(const T& v) {
+    if (size_ == cap_ && !reserve(cap_ * 2u)) return false;
+    data_[size_++] = v;
+    return true;
+  }
+
+  void pop_back() {
+    if (size_) size_--;
+  }
+
+  bool reserve(size_t n) {
+    if (n <= cap_) return true;
+    T* p = static_cast<T*>(mr_allocate(mr_, n * sizeof(T), alignof(T)));
+    if (!p) return false;
+    for (size_t i = 0; i < size_; ++i) p[i] = data_[i];
+    drop_heap();
+    data_ = p;
+    cap_ = n;
+    return true;
+  }
+
+  void clear() { size_ = 0; }
+
+  T&       operator[](size_t i) { return data_[i]; }
+  const T& operator[](size_t i) const { return data_[i]; }
+  T*       data() { return data_; }
+  T*       begin() { return data_; }
+  T*       end() { return data_ + size_; }
+  size_t   size() const { return size_; }
+  size_t   capacity() const { return cap_; }
+  bool     empty() const { return size_ == 0; }
+  bool     on_heap() const { return data_ != inline_; }
+
+ private:
+  void drop_heap() {
+    if (on_heap()) mr_deallocate(mr_, data_, cap_ * sizeof(T), alignof(T));
+  }
+
+  mem_resource* mr_;
+  T*            data_;
+  size_t        size_;
+  size_t        cap_;
+  T             inline_[N];
+};
+
+template <typename T>
+class Ring {
+  static_assert(__is_trivially_copyable(T), "Ring copies elements by value");
+
+ public:
+  Ring() = default;
+  ~Ring() { destroy(); }
+  Ring(const Ring&) = delete;
+  Ring& operator=(const Ring&) = delete;
+
+  // Returns false if |mr| cannot supply the slots; the ring is then empty
+  // with capacity 0.
+  bool init(mem_resource* mr, size_t capacity) {
+    destroy();
+    size_t cap = 1;
+    while (cap < capacity) cap <<= 1u;
+    slots_ = static_cast<T*>(mr_allocate(mr, cap * sizeof(T), alignof(T)));
+    if (!slots_) return false;
+    mr_ = mr;
+    mask_ = cap - 1u;
+    head_ = tail_ = 0;
+    return true;
+  }
+
+  // Hands the slots back to the resource.
+  void destroy() {
+    if (slots_) mr_deallocate(mr_, slots_, (mask_ + 1u) * sizeof(T), alignof(T));
+    slots_ = nullptr;
+    mr_ = nullptr;
+    mask_ = 0;
+    head_ = tail_ = 0;
+  }
+
+  bool push(const T& v) {
+    if (!slots_ || full()) return false;
+    slots_[tail_++ & mask_] = v;
+    return true;
+  }
+
+  bool pop(T* out) {
+    if (empty()) return false;
+    *out = slots_[head_++ & mask_];
+    return true;
+  }
+
+  size_t capacity() const { return slots_ ? mask_ + 1u : 0; }
+  size_t size() const { return tail_ - head_; }
+  bool   empty() const { return head_ == tail_; }
+  bool   full() const { return size() == capacity(); }
+
+ private:
+  mem_resource* mr_ = nullptr;
+  T*            slots_ = nullptr;
+  size_t        mask_ = 0;
+  size_t        head_ = 0;
+  size_t        tail_ = 0;
+};
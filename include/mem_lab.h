@@ -6,6 +6,18 @@ extern "C" {
 
 // Memory allocator lab:
 // - mode=1: run internal vs external fragmentation demos and print metrics
+// - mode=2: buddy page allocator checks (alignment, coalescing, misuse,
+//           kmem refill after the handoff)
+// - mode=3: kmalloc size classes, slab grow/shrink and the large path
+// - mode=4: per-CPU magazine cache vs a locked mem_pool, bulk ops, drain
+// - mode=5: kmem_cache constructed-state reuse and slab coloring
+// - mode=6: TLSF vs the first-fit heap: per-op latency, fragmentation report,
+//           coalescing and double-free checks
+// - mode=7: StaticPool<T, N>: typed alloc/free, 16-bit generation-checked
+//           handles, stale handle (also after reuse) and double-free
+//           rejection, per-type stats
+// - mode=8: request-scoped arena (ArenaScope) with SmallVector/Ring, arena vs
+//           kmalloc cost, pool- and page-backed resources
 void mem_lab_run(unsigned mode);
 
 #ifdef __cplusplus
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mem_pool.h"
+#include "smp.h"
+#include "spinlock.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Per-CPU magazine layer in front of a mem_pool (Bonwick/Adams, "Magazines
+// and Vmem", USENIX 2001).
+//
+// A magazine is an array of up to MAG_ROUNDS cached blocks. Each CPU owns a
+// |loaded| and a |previous| magazine and serves alloc/free from them with
+// only local IRQs masked: no lock, no shared cache line. When both are empty
+// (alloc) or full (free), the CPU swaps a whole magazine with the depot under
+// the depot lock. Only when the depot has nothing to trade does it go to the
+// pool, refilling or flushing a magazine in one mem_pool_alloc_bulk /
+// mem_pool_free_bulk pass under the pool lock. The depot keeps at most
+// MAG_DEPOT_MAX_FULL full magazines; beyond that they are flushed to the pool.
+//
+// Magazines are kmalloc()ed on demand. Every pool access must go through the
+// cache once it is in use. Frees are checked with mem_pool_owns() only;
+// double frees are not detected while a block sits in a magazine.
+#define MAG_ROUNDS 14          // sizeof(struct magazine) == 128
+#define MAG_DEPOT_MAX_FULL 4
+
+struct magazine {
+  struct magazine* next;       // depot list link
+  uint32_t         rounds;     // cached blocks in obj[0..rounds)
+  uint32_t         pad;
+  void*            obj[MAG_ROUNDS];
+};
+
+struct mag_cpu {
+  struct magazine* loaded;
+  struct magazine* previous;
+  uint64_t         hits;       // served from loaded/previous
+  uint64_t         depot;      // magazine exchanges with the depot
+  uint64_t         pool;       // bulk refills/flushes against the pool
+} __attribute__((aligned(64)));
+
+struct mag_cache {
+  struct mem_pool* pool;
+  struct spinlock  pool_lock;
+  struct spinlock  depot_lock;
+  struct magazine* full;
+  struct magazine* empty;
+  size_t           nr_full;
+  size_t           nr_empty;
+  struct mag_cpu   cpu[SMP_MAX_CPUS];
+};
+
+struct mag_cache_stats {
+  uint64_t hits;
+  uint64_t depot;
+  uint64_t pool;
+  size_t   depot_full;
+  size_t   depot_empty;
+  size_t   cached;             // blocks held in magazines (all CPUs + depot)
+};
+
+// |pool| must be initialized. Returns 0, or -1 on invalid parameters.
+int   mag_cache_init(struct mag_cache* c, struct mem_pool* pool);
+void* mag_cache_alloc(struct mag_cache* c);
+// Returns 0, or -1 if |p| is not a block of the pool.
+int   mag_cache_free(struct mag_cache* c, void* p);
+// Return the calling CPU's and the depot's cached blocks to the pool and free
+// the magazines (other CPUs keep theirs).
+void  mag_cache_drain(struct mag_cache* c);
+
+void  mag_cache_stats_get(struct mag_cache* c, struct mag_cache_stats* out);
+
+#ifdef __cplusplus
+}
+#endif
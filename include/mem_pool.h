@@ -14,26 +14,53 @@ extern "C" {
 // - no external fragmentation
 // - predictable behavior under interrupt/preemption when guarded externally
 //
-// This pool is intentionally simple: it does not do per-block metadata beyond
-// storing the next pointer inside freed blocks.
+// Blocks carry no header; the free list's next pointer lives inside freed
+// blocks. mem_pool_owns() maps a pointer to its block index with a shift
+// (power-of-two block sizes) or a precomputed reciprocal multiply, never a
+// divide.
+//
+// Optional allocation bitmap: one bit per block, in caller-provided storage.
+// With it attached, free rejects double frees in O(1), cheap enough to keep
+// on in production. Without it, MEM_POOL_DEBUG=1 falls back to an O(n) free
+// list walk.
 struct mem_pool {
-  uint8_t* base;
-  size_t   block_size;
-  size_t   block_count;
-  void*    free_list;   // singly-linked list (pointer stored in freed blocks)
-  size_t   free_count;
+  uint8_t*  base;
+  void*     free_list;    // singly-linked list (pointer stored in freed blocks)
+  uint64_t* bitmap;       // optional; bit set = block allocated
+  uint64_t  div_magic;    // 2^64 / block_size rounded up (non power of two)
+  uint32_t  block_size;
+  uint32_t  block_count;
+  uint32_t  free_count;
+  uint32_t  block_shift;  // log2(block_size) if a power of two, else 0
 };
 
-// Initialize a pool over [backing, backing+backing_size).
+#define MEM_POOL_BITMAP_WORDS(blocks) (((blocks) + 63u) / 64u)
+
+// Initialize a pool over [backing, backing+backing_size). Block sizes are
+// rounded up to 16 bytes; at most 4 GiB of the region is used.
 // Returns 0 on success, -1 on invalid parameters.
 int mem_pool_init(struct mem_pool* pool, void* backing, size_t backing_size, size_t block_size);
 
+// Track allocation state in |words| (MEM_POOL_BITMAP_WORDS(capacity) words,
+// outside the pool's blocks). Blocks allocated at attach time are marked
+// allocated. Returns 0, or -1 if |words| is too small.
+int mem_pool_attach_bitmap(struct mem_pool* pool, uint64_t* words, size_t nwords);
+
 // Allocate one block; returns nullptr if exhausted.
 void* mem_pool_alloc(struct mem_pool* pool);
 
-// Free a previously allocated block. Returns 0 on success, -1 on invalid pointer.
+// Free a previously allocated block. Returns 0 on success, -1 on invalid
+// pointer (or, with a bitmap, a block that is not allocated).
 int mem_pool_free(struct mem_pool* pool, void* p);
 
+// Batched variants: one pass over the free list for up to |n| blocks, so a
+// caller that guards the pool with a lock takes it once per batch.
+// alloc_bulk stores the blocks in |out| and returns how many it got (short
+// when the pool runs dry). free_bulk skips blocks mem_pool_free() would
+// reject and returns how many it freed.
+size_t mem_pool_alloc_bulk(struct mem_pool* pool, void** out, size_t n);
+size_t mem_pool_free_bulk(struct mem_pool* pool, void* const* blocks, size_t n);
+
 // Pointer classification helpers.
 int mem_pool_owns(const struct mem_pool* pool, const void* p);
 
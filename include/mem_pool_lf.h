@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Lock-free fixed-size pool: a Treiber stack of free blocks.
+//
+// Unlike mem_pool, alloc/free need no lock and no IRQ masking: they may be
+// called from thread context, hard-IRQ context and any CPU at the same time,
+// e.g. for descriptors and messages allocated on hot paths.
+//
+// ABA: a pop reads head and head->next, then swings head to next with a
+// compare-and-swap. If the block was popped and pushed back in between, head
+// compares equal but next is stale. The head therefore packs a 32-bit
+// generation tag next to a 32-bit block index (index + 1, 0 = empty). Every
+// successful update bumps the tag, so the 64-bit CAS fails on any intervening
+// change. Free blocks link by index in their first word for the same reason.
+// The tag would have to wrap (2^32 updates) inside one interrupted pop for
+// ABA to slip through.
+//
+// Cost: one CAS per alloc/free, retried only when another context changed
+// the head in the meantime. A free pointer is range- and alignment-checked,
+// but double frees are not detected.
+struct mem_pool_lf {
+  uint8_t* base;
+  size_t   block_size;
+  uint32_t block_count;
+  uint32_t free_count;    // updated atomically; a snapshot under concurrency
+  uint64_t cas_retries;   // failed CAS attempts, alloc and free combined
+  // tag << 32 | (index + 1); own cache line so the counters do not share it.
+  uint64_t head __attribute__((aligned(64)));
+};
+
+// Same rules as mem_pool_init(): blocks are 16-byte aligned and rounded up to
+// 16 bytes. At most UINT32_MAX - 1 blocks. Not safe against concurrent use.
+// Returns 0 or -1.
+int   mem_pool_lf_init(struct mem_pool_lf* pool, void* backing, size_t backing_size, size_t block_size);
+
+void* mem_pool_lf_alloc(struct mem_pool_lf* pool);
+// Returns 0, or -1 if |p| is not a block of |pool|.
+int   mem_pool_lf_free(struct mem_pool_lf* pool, void* p);
+
+int    mem_pool_lf_owns(const struct mem_pool_lf* pool, const void* p);
+size_t mem_pool_lf_capacity(const struct mem_pool_lf* pool);
+size_t mem_pool_lf_available(const struct mem_pool_lf* pool);
+
+#ifdef __cplusplus
+}
+#endif
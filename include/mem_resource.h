@@ -0,0 +1,119 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mem_pool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Memory resources: one allocate/deallocate/release interface over the
+// kernel's allocators, in the spirit of std::pmr::memory_resource, so code
+// and containers can take "where memory comes from" as a parameter.
+//
+// - arena_resource: monotonic bump allocation. It starts in an optional
+//   caller buffer (e.g. on the stack) and continues in chunks from an
+//   upstream resource. deallocate() is a no-op; arena_release() frees every
+//   chunk at once, and a mark/rewind pair (ArenaScope in C++) drops just what
+//   one request allocated. kmem_alloc_aligned() is the same bump strategy,
+//   except that it never gives memory back.
+// - pool_resource: a mem_pool behind the interface, for blocks of one size.
+// - page_resource(): buddy pages, each request rounded to a 2^order block.
+//
+// Callers pass the size and alignment to deallocate() as well, so resources
+// need no per-allocation header. Arena and pool resources are not locked;
+// the page resource inherits the page allocator's lock.
+struct mem_resource;
+
+struct mem_resource_ops {
+  void* (*allocate)(struct mem_resource* r, size_t size, size_t align);
+  void  (*deallocate)(struct mem_resource* r, void* p, size_t size, size_t align);
+  void  (*release)(struct mem_resource* r);   // may be nullptr
+};
+
+struct mem_resource {
+  const struct mem_resource_ops* ops;
+  const char*                    name;
+};
+
+// |align| 0 means 16; alignments must be powers of two.
+static inline void* mr_allocate(struct mem_resource* r, size_t size, size_t align) {
+  return (r && size) ? r->ops->allocate(r, size, align) : (void*)0;
+}
+
+static inline void mr_deallocate(struct mem_resource* r, void* p, size_t size, size_t align) {
+  if (r && p) r->ops->deallocate(r, p, size, align);
+}
+
+static inline void mr_release(struct mem_resource* r) {
+  if (r && r->ops->release) r->ops->release(r);
+}
+
+// ---- Monotonic arena ----
+struct arena_chunk;
+
+struct arena_resource {
+  struct mem_resource  res;           // first: &arena.res is the resource
+  struct mem_resource* upstream;
+  uint8_t*             initial;       // caller buffer, may be nullptr
+  size_t               initial_bytes;
+  struct arena_chunk*  chunks;        // newest first
+  uintptr_t            cur;
+  uintptr_t            end;
+  size_t               next_chunk;    // doubles per chunk up to ARENA_CHUNK_MAX
+  size_t               used;          // bytes handed out since the last release
+  size_t               peak;
+  size_t               nr_chunks;
+  uint64_t             allocs;
+};
+
+#define ARENA_CHUNK_MIN (4u * 1024u)
+#define ARENA_CHUNK_MAX (256u * 1024u)
+
+// |upstream| nullptr means page_resource(). |buf| may be nullptr.
+void arena_init(struct arena_resource* a, void* buf, size_t bytes, struct mem_resource* upstream);
+// Frees every chunk to the upstream and restarts in the initial buffer.
+void arena_release(struct arena_resource* a);
+
+struct arena_mark {
+  struct arena_chunk* chunk;
+  uintptr_t           cur;
+  size_t              used;
+};
+
+struct arena_mark arena_mark_get(const struct arena_resource* a);
+// Drops everything allocated since |m| and frees the chunks added since.
+void arena_rewind(struct arena_resource* a, struct arena_mark m);
+
+// ---- Fixed-size pool ----
+struct pool_resource {
+  struct mem_resource res;
+  struct mem_pool*    pool;
+};
+
+// Requests larger than the pool's block size (or aligned to more than 16)
+// fail.
+void pool_resource_init(struct pool_resource* r, struct mem_pool* pool);
+
+// ---- Buddy pages ----
+struct mem_resource* page_resource(void);
+
+#ifdef __cplusplus
+}
+
+// Rewinds the arena to where it was at construction: request-scoped
+// allocation with no per-object free.
+class ArenaScope {
+ public:
+  explicit ArenaScope(arena_resource* a) : arena_(a), mark_(arena_mark_get(a)) {}
+  ~ArenaScope() { arena_rewind(arena_, mark_); }
+  ArenaScope(const ArenaScope&) = delete;
+  ArenaScope& operator=(const ArenaScope&) = delete;
+
+ private:
+  arena_resource* arena_;
+  arena_mark      mark_;
+};
+#endif
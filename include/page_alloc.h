@@ -0,0 +1,47 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Buddy allocator for 4 KiB page frames. It manages all RAM above the kernel
+// image (everything past __dma_nc_end up to the end reported by
+// platform_ram_range()). Blocks are 2^order pages, order 0..PAGE_ORDER_MAX,
+// with one free list per order; a freed block merges with its buddy as long as
+// the buddy is free at the same order.
+//
+// The page map (one byte per frame) is carved from the front of the managed
+// range. After page_alloc_init() the boot bump allocator stops being limited
+// to the linker heap and refills from here (see kmem_handoff()).
+//
+// alloc_pages/free_pages take an irqsave spinlock and may be called from IRQ
+// context. Cost is O(PAGE_ORDER_MAX) per call.
+#define PAGE_SHIFT 12
+#define PAGE_SIZE (1ul << PAGE_SHIFT)
+#define PAGE_ORDER_MAX 10   // 4 MiB blocks
+
+struct page_alloc_stats {
+  size_t total_pages;                       // frames handed to the allocator
+  size_t free_pages;
+  size_t free_blocks[PAGE_ORDER_MAX + 1];   // free list length per order
+};
+
+void page_alloc_init(void);
+
+// Returns a 2^order page block aligned to its own size, or nullptr.
+void* alloc_pages(unsigned order);
+// |order| must match the allocation. Returns 0, or -1 for a pointer the
+// allocator does not own, a wrong order or a double free.
+int   free_pages(void* p, unsigned order);
+
+// Smallest order whose block holds |bytes|; PAGE_ORDER_MAX + 1 if none does.
+unsigned page_order_for(size_t bytes);
+
+void page_alloc_stats_get(struct page_alloc_stats* out);
+void page_alloc_dump(void);
+
+#ifdef __cplusplus
+}
+#endif
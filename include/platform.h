@@ -17,6 +17,10 @@ void platform_early_init(void);
 // Initialize the platform interrupt controller (if present).
 void platform_irq_init(void);
 
+// RAM usable by the kernel: [*start, *end). Covers the kernel image; the page
+// allocator takes everything above it.
+void platform_ram_range(uintptr_t* start, uintptr_t* end);
+
 // Return 1 if the build supports the full IRQ+timer+RR scheduler path.
 // RPi4 bring-up starts in a UART-only mode until its IRQ controller support is
 // implemented.
@@ -4,7 +4,6 @@ extern "C" {
 #endif
 void preempt_disable(void);
 void preempt_enable(void);
-void preempt_return(void);
 #ifdef __cplusplus
 }
 #endif
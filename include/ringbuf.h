@@ -0,0 +1,283 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sync.h"
+
+// Lock-free bounded ring buffers for IRQ -> thread (and thread <-> thread)
+// handoff. Header-only templates; no allocation (storage is embedded, so
+// place rings in .bss or inside a kmem_alloc_aligned() block).
+//
+// - SpscRing<T, N>: single producer / single consumer, wait-free. The
+//   producer may be an IRQ handler; no masking needed on either side.
+// - MpmcRing<T, N>: bounded multi-producer / multi-consumer (Vyukov): one
+//   sequence number per cell, one CAS per operation (or per batch).
+// - BlockingRing<Ring>: adds a counting semaphore so consumers can sleep
+//   until data arrives. Producers never block (IRQ-safe).
+//
+// Producer and consumer indices live on separate cache lines so the two sides
+// do not bounce a shared line. N must be a power of two; T must be trivially
+// copyable (elements are copied by value).
+
+constexpr size_t kRingCacheLine = 64;
+
+namespace ringbuf_detail {
+template <typename T>
+inline T load_acquire(const T* p) {
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+template <typename T>
+inline T load_relaxed(const T* p) {
+  return __atomic_load_n(p, __ATOMIC_RELAXED);
+}
+
+template <typename T>
+inline void store_release(T* p, T v) {
+  __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+template <typename T>
+inline bool cas_relaxed(T* p, T* expected, T desired) {
+  return __atomic_compare_exchange_n(p, expected, desired, /*weak=*/true,
+                                     __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+}  // namespace ringbuf_detail
+
+template <typename T, size_t N>
+class SpscRing {
+  static_assert(N >= 2 && (N & (N - 1u)) == 0, "SpscRing size must be a power of two");
+  static_assert(__is_trivially_copyable(T), "SpscRing elements must be trivially copyable");
+
+ public:
+  using value_type = T;
+
+  void init() {
+    head_ = 0;
+    tail_ = 0;
+    cached_head_ = 0;
+    cached_tail_ = 0;
+  }
+
+  // Producer side. Returns false if full.
+  bool push(const T& v) {
+    return push_bulk(&v, 1) == 1;
+  }
+
+  // Producer side. Copies up to |n| elements; returns the number enqueued.
+  size_t push_bulk(const T* src, size_t n) {
+    using namespace ringbuf_detail;
+    const size_t tail = tail_;
+    size_t free = N - (tail - cached_head_);
+    if (free < n) {
+      cached_head_ = load_acquire(&head_);
+      free = N - (tail - cached_head_);
+    }
+    if (n > free) n = free;
+    for (size_t i = 0; i < n; ++i) {
+      slots_[(tail + i) & (N - 1u)] = src[i];
+    }
+    if (n) store_release(&tail_, tail + n);
+    return n;
+  }
+
+  // Consumer side. Returns false if empty.
+  bool pop(T* out) {
+    return pop_bulk(out, 1) == 1;
+  }
+
+  // Consumer side. Copies up to |max| elements; returns the number dequeued.
+  size_t pop_bulk(T* dst, size_t max) {
+    using namespace ringbuf_detail;
+    const size_t head = head_;
+    size_t avail = cached_tail_ - head;
+    if (avail < max) {
+      cached_tail_ = load_acquire(&tail_);
+      avail = cached_tail_ - head;
+    }
+    if (max > avail) max = avail;
+    for (size_t i = 0; i < max; ++i) {
+      dst[i] = slots_[(head + i) & (N - 1u)];
+    }
+    if (max) store_release(&head_, head + max);
+    return max;
+  }
+
+  // Approximate (exact when called from either endpoint with the other idle).
+  size_t size() const {
+    using namespace ringbuf_detail;
+    return load_acquire(&tail_) - load_acquire(&head_);
+  }
+
+  static constexpr size_t capacity() { return N; }
+
+ private:
+  // Consumer-owned line.
+  alignas(kRingCacheLine) size_t head_ = 0;
+  size_t cached_tail_ = 0;
+  // Producer-owned line.
+  alignas(kRingCacheLine) size_t tail_ = 0;
+  size_t cached_head_ = 0;
+  alignas(kRingCacheLine) T slots_[N];
+};
+
+template <typename T, size_t N>
+class MpmcRing {
+  static_assert(N >= 2 && (N & (N - 1u)) == 0, "MpmcRing size must be a power of two");
+  static_assert(__is_trivially_copyable(T), "MpmcRing elements must be trivially copyable");
+
+ public:
+  using value_type = T;
+
+  void init() {
+    for (size_t i = 0; i < N; ++i) {
+      cells_[i].seq = i;
+    }
+    enqueue_pos_ = 0;
+    dequeue_pos_ = 0;
+  }
+
+  bool push(const T& v) {
+    return push_bulk(&v, 1) == 1;
+  }
+
+  // Claims up to |n| consecutive free cells with a single CAS, then publishes
+  // each one. Returns the number enqueued (0 if full).
+  size_t push_bulk(const T* src, size_t n) {
+    using namespace ringbuf_detail;
+    if (n == 0) return 0;
+    if (n > N) n = N;
+    size_t pos = load_relaxed(&enqueue_pos_);
+    for (;;) {
+      size_t k = 0;
+      while (k < n) {
+        const size_t seq = load_acquire(&cells_[(pos + k) & (N - 1u)].seq);
+        if (seq != pos + k) break;
+        k++;
+      }
+      if (k == 0) {
+        const size_t seq = load_acquire(&cells_[pos & (N - 1u)].seq);
+        if (static_cast<intptr_t>(seq - pos) < 0) return 0;  // full
+        pos = load_relaxed(&enqueue_pos_);                   // lost a race
+        continue;
+      }
+      if (cas_relaxed(&enqueue_pos_, &pos, pos + k)) {
+        for (size_t i = 0; i < k; ++i) {
+          Cell& c = cells_[(pos + i) & (N - 1u)];
+          c.value = src[i];
+          store_release(&c.seq, pos + i + 1u);
+        }
+        return k;
+      }
+      // |pos| was reloaded by the failed CAS.
+    }
+  }
+
+  bool pop(T* out) {
+    return pop_bulk(out, 1) == 1;
+  }
+
+  size_t pop_bulk(T* dst, size_t max) {
+    using namespace ringbuf_detail;
+    if (max == 0) return 0;
+    if (max > N) max = N;
+    size_t pos = load_relaxed(&dequeue_pos_);
+    for (;;) {
+      size_t k = 0;
+      while (k < max) {
+        const size_t seq = load_acquire(&cells_[(pos + k) & (N - 1u)].seq);
+        if (seq != pos + k + 1u) break;
+        k++;
+      }
+      if (k == 0) {
+        const size_t seq = load_acquire(&cells_[pos & (N - 1u)].seq);
+        if (static_cast<intptr_t>(seq - (pos + 1u)) < 0) return 0;  // empty
+        pos = load_relaxed(&dequeue_pos_);
+        continue;
+      }
+      if (cas_relaxed(&dequeue_pos_, &pos, pos + k)) {
+        for (size_t i = 0; i < k; ++i) {
+          Cell& c = cells_[(pos + i) & (N - 1u)];
+          dst[i] = c.value;
+          store_release(&c.seq, pos + i + N);
+        }
+        return k;
+      }
+    }
+  }
+
+  static constexpr size_t capacity() { return N; }
+
+ private:
+  struct Cell {
+    size_t seq;
+    T      value;
+  };
+
+  alignas(kRingCacheLine) size_t enqueue_pos_ = 0;
+  alignas(kRingCacheLine) size_t dequeue_pos_ = 0;
+  alignas(kRingCacheLine) Cell cells_[N];
+};
+
+// Sleep-capable consumer side on top of any ring above. The semaphore counts
+// published elements and consumers take counts before elements, so every
+// element popped is paid for. With MpmcRing an element can be counted while an
+// earlier cell is still being published; the consumer then holds on to its
+// counts, waits for the next one and returns the surplus after popping.
+template <typename Ring>
+class BlockingRing {
+ public:
+  using T = typename Ring::value_type;
+
+  void init() {
+    ring_.init();
+    sem_init(&items_, 0);
+  }
+
+  // Never blocks; callable from IRQ context. Returns false if full.
+  bool push(const T& v) {
+    if (!ring_.push(v)) return false;
+    sem_up(&items_);
+    return true;
+  }
+
+  size_t push_bulk(const T* src, size_t n) {
+    const size_t k = ring_.push_bulk(src, n);
+    for (size_t i = 0; i < k; ++i) sem_up(&items_);
+    return k;
+  }
+
+  bool try_pop(T* out) {
+    if (sem_trydown(&items_) != 0) return false;
+    if (ring_.pop(out)) return true;
+    sem_up(&items_);
+    return false;
+  }
+
+  // Blocks until one element is available.
+  void pop_wait(T* out) {
+    (void)pop_bulk_wait(out, 1);
+  }
+
+  // Blocks until at least one element is available, then drains up to |max|.
+  size_t pop_bulk_wait(T* dst, size_t max) {
+    if (max == 0) return 0;
+    size_t held = 0;
+    for (;;) {
+      sem_down(&items_);
+      held++;
+      while (held < max && sem_trydown(&items_) == 0) held++;
+      const size_t k = ring_.pop_bulk(dst, held < max ? held : max);
+      if (k == 0) continue;
+      for (size_t i = k; i < held; ++i) sem_up(&items_);
+      return k;
+    }
+  }
+
+  Ring& ring() { return ring_; }
+
+ private:
+  Ring      ring_;
+  semaphore items_;
+};
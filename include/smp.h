@@ -0,0 +1,70 @@
+#pragma once
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Inter-processor interrupts over SGIs (ICC_SGI1R_EL1).
+//
+// - IPI_SGI_RESCHEDULE: the target re-runs the scheduler on its IRQ exit.
+// - IPI_SGI_CALL_FUNC:  the target drains its call queue and runs each
+//   queued function in hard-IRQ context (must not block), FIFO per sender.
+//
+// Each CPU's call queue is a lock-free multi-producer list: senders push with
+// a CAS and only the push that finds the queue empty sends the SGI, so a
+// burst of calls costs one interrupt. The target detaches the whole list with
+// one exchange. SGI 2 is the DMA doorbell; SGIs 3-8 are used by the IRQ lab.
+//
+// Only the boot CPU is online today; the API is written for SMP_MAX_CPUS
+// CPUs in one Aff1 cluster, with the logical CPU number equal to MPIDR Aff0.
+#define IPI_SGI_RESCHEDULE 0u
+#define IPI_SGI_CALL_FUNC  1u
+
+#ifndef SMP_MAX_CPUS
+#define SMP_MAX_CPUS 8
+#endif
+
+typedef uint32_t cpumask_t;
+typedef void (*smp_call_func_t)(void* info);
+
+// Caller-owned request for smp_call_function_single_async(). Busy from
+// submission until the function has returned on the target.
+struct call_single_data {
+  call_single_data* next;
+  smp_call_func_t   func;
+  void*             info;
+  volatile uint32_t flags;
+};
+
+// Register the IPI handlers; call after irq_init().
+void smp_init(void);
+unsigned smp_processor_id(void);
+cpumask_t smp_online_mask(void);
+
+void smp_send_reschedule(unsigned cpu);
+
+// Run |func(info)| on |cpu|. On the calling CPU it runs right away with IRQs
+// masked; elsewhere it is queued and, with |wait|, the caller spins until it
+// has finished. Waiting callers must have IRQs enabled (two CPUs waiting on
+// each other with IRQs masked deadlock). Returns 0, or -1 if |cpu| is offline.
+int smp_call_function_single(unsigned cpu, smp_call_func_t func, void* info, int wait);
+
+// Run |func(info)| on every online CPU in |mask| except the caller, with one
+// SGI write for all of them. Returns the number of CPUs targeted.
+int smp_call_function_many(cpumask_t mask, smp_call_func_t func, void* info, int wait);
+
+// smp_call_function_many() on all other CPUs plus a local call.
+void on_each_cpu(smp_call_func_t func, void* info, int wait);
+
+// Queue |csd| (func/info filled in by the caller) on |cpu| and raise the IPI,
+// even when |cpu| is the calling CPU: the function then runs on the next IRQ
+// exit window in hard-IRQ context. Returns -1 if |csd| is still in flight.
+int smp_call_function_single_async(unsigned cpu, call_single_data* csd);
+
+// IPIs received by this CPU, per kind.
+uint64_t smp_ipi_count(unsigned sgi);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,44 @@
+#pragma once
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Softirqs: a fixed set of deferred-work vectors, raised with one bit in the
+// per-CPU pending mask (cpu_local()->softirq_pending). Pending vectors run
+// at the outermost IRQ exit, still in IRQ context (must not block, but IRQs
+// are enabled with IRQ_NESTING), lowest vector number first. Each exit is bounded by SOFTIRQ_MAX_RESTART passes
+// and SOFTIRQ_BUDGET_US of counter time; whatever is still pending after
+// that (or is raised from thread context) is handed to the ksoftirqd
+// thread, which runs the same handlers with IRQs enabled.
+enum {
+  SOFTIRQ_HI = 0,
+  SOFTIRQ_TIMER,    // sched timeouts (moved out of the tick handler)
+  SOFTIRQ_BLOCK,    // I/O / DMA completions
+  SOFTIRQ_TASKLET,
+  SOFTIRQ_RCU,
+  SOFTIRQ_NR,
+};
+
+#ifndef SOFTIRQ_MAX_RESTART
+#define SOFTIRQ_MAX_RESTART 10
+#endif
+#ifndef SOFTIRQ_BUDGET_US
+#define SOFTIRQ_BUDGET_US 500
+#endif
+
+typedef void (*softirq_fn_t)(void);
+
+// Create ksoftirqd; call after sched_init().
+void softirq_init(void);
+void open_softirq(unsigned nr, softirq_fn_t fn);
+// Mark |nr| pending. Safe from any context.
+void raise_softirq(unsigned nr);
+// Called by irq_handler_el1() on the way out of the outermost IRQ.
+void softirq_irq_exit(void);
+uint64_t softirq_count(unsigned nr);
+
+#ifdef __cplusplus
+}
+#endif
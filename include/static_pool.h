@@ -0,0 +1,178 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "spinlock.h"
+
+// Typed fixed-size object pools with compile-time layout.
+//
+// StaticPool<T, N> holds storage for N objects of type T inside the pool
+// object itself, so a pool defined at namespace scope lives in .bss. Its
+// all-zero state is an empty, ready pool: slots are handed out first by a
+// bump index and then from a free list, so there is no init() call and no
+// boot-time loop threading a free list through N blocks.
+//
+// - alloc()/free() are typed and O(1). The free links (16-bit indices) and an
+//   allocation bitmap live outside the objects: free() rejects foreign
+//   pointers and double frees, and a freed object keeps its contents.
+// - Handles: handle() maps an object to a 16-bit handle, its index + 1 in the
+//   low bit_width(N) bits and the slot's generation in the rest (0 is the
+//   null handle). free() bumps the generation, so from_handle() returns
+//   nullptr for a handle to a freed object even after its slot has been
+//   reallocated, until the generation wraps (after 2^(16 - bit_width(N))
+//   frees of that slot; 4096 for N = 8). Use handles where a pointer would
+//   be the larger part of a record.
+// - Per-type statistics: in use, high-water mark, allocations, exhaustion
+//   and rejected frees.
+//
+// alloc() returns raw storage for a T: zero on its first use, otherwise as
+// the previous owner left it. Constructors and destructors never run, so T
+// must be trivially destructible. Alloc/free take an irqsave spinlock and are
+// callable from IRQ context.
+struct static_pool_stats {
+  size_t   obj_size;
+  size_t   capacity;
+  size_t   footprint;    // bytes of the whole pool, storage included
+  size_t   in_use;
+  size_t   high_water;   // most objects live at once
+  uint64_t allocs;
+  uint64_t failed;       // alloc() with the pool exhausted
+  uint64_t bad_frees;    // foreign pointers and double frees
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+void static_pool_print(const char* name, const struct static_pool_stats* s);
+#ifdef __cplusplus
+}
+#endif
+
+template <typename T, size_t N>
+class StaticPool {
+  static constexpr unsigned bit_width(size_t v) { return v ? 1u + bit_width(v >> 1) : 0u; }
+  static constexpr unsigned kIndexBits = bit_width(N);
+  static constexpr unsigned kIndexMask = (1u << kIndexBits) - 1u;
+  static constexpr unsigned kGenMask = (1u << (16u - kIndexBits)) - 1u;
+  static_assert(N >= 1 && kIndexBits <= 12, "handles keep at least 4 generation bits");
+  static_assert(__is_trivially_destructible(T), "StaticPool never runs destructors");
+
+ public:
+  using handle_t = uint16_t;
+  static constexpr handle_t kNullHandle = 0;
+
+  static constexpr size_t capacity() { return N; }
+  static constexpr size_t slot_bytes() { return sizeof(Slot); }
+  static constexpr size_t footprint() { return sizeof(StaticPool); }
+
+  T* alloc() {
+    unsigned long flags = spin_lock_irqsave(&lock_);
+    size_t idx;
+    if (free_head_) {
+      idx = free_head_ - 1u;
+      free_head_ = next_[idx];
+    } else if (bump_ < N) {
+      idx = bump_++;
+    } else {
+      failed_++;
+      spin_unlock_irqrestore(&lock_, flags);
+      return nullptr;
+    }
+    used_[idx / 64u] |= uint64_t{1} << (idx % 64u);
+    if (++in_use_ > high_water_) high_water_ = in_use_;
+    allocs_++;
+    spin_unlock_irqrestore(&lock_, flags);
+    return reinterpret_cast<T*>(slots_[idx].bytes);
+  }
+
+  // Returns 0, or -1 (counted in bad_frees) if |obj| is not a live object of
+  // this pool. Accepts nullptr as a no-op.
+  int free(T* obj) {
+    if (!obj) return 0;
+    size_t idx;
+    unsigned long flags = spin_lock_irqsave(&lock_);
+    if (!index_of(obj, &idx) || !is_used(idx)) {
+      bad_frees_++;
+      spin_unlock_irqrestore(&lock_, flags);
+      return -1;
+    }
+    used_[idx / 64u] &= ~(uint64_t{1} << (idx % 64u));
+    gen_[idx] = static_cast<uint16_t>((gen_[idx] + 1u) & kGenMask);
+    next_[idx] = free_head_;
+    free_head_ = static_cast<uint16_t>(idx + 1u);
+    in_use_--;
+    spin_unlock_irqrestore(&lock_, flags);
+    return 0;
+  }
+
+  bool owns(const T* obj) const {
+    size_t idx;
+    return index_of(obj, &idx);
+  }
+
+  // kNullHandle if |obj| is not a live object of this pool.
+  handle_t handle(const T* obj) const {
+    size_t idx;
+    if (!index_of(obj, &idx) || !is_used(idx)) return kNullHandle;
+    return static_cast<handle_t>((gen_[idx] << kIndexBits) | (idx + 1u));
+  }
+
+  // nullptr for the null handle, out-of-range handles and handles to freed
+  // objects, including slots that have been reallocated since.
+  T* from_handle(handle_t h) {
+    const size_t idx1 = h & kIndexMask;
+    if (idx1 == 0 || idx1 > N) return nullptr;
+    const size_t idx = idx1 - 1u;
+    if (!is_used(idx) || __atomic_load_n(&gen_[idx], __ATOMIC_RELAXED) != (h >> kIndexBits)) return nullptr;
+    return reinterpret_cast<T*>(slots_[idx].bytes);
+  }
+
+  void stats(static_pool_stats* out) {
+    if (!out) return;
+    unsigned long flags = spin_lock_irqsave(&lock_);
+    out->obj_size = sizeof(T);
+    out->capacity = N;
+    out->footprint = footprint();
+    out->in_use = in_use_;
+    out->high_water = high_water_;
+    out->allocs = allocs_;
+    out->failed = failed_;
+    out->bad_frees = bad_frees_;
+    spin_unlock_irqrestore(&lock_, flags);
+  }
+
+ private:
+  struct Slot {
+    alignas(T) uint8_t bytes[sizeof(T)];
+  };
+  static_assert(sizeof(Slot) == sizeof(T), "slots are packed at the type's own stride");
+
+  // Division by the constant slot size compiles to a multiply or shift.
+  bool index_of(const T* obj, size_t* idx) const {
+    const uintptr_t base = reinterpret_cast<uintptr_t>(slots_);
+    const uintptr_t v = reinterpret_cast<uintptr_t>(obj);
+    if (v < base || v >= base + sizeof(slots_)) return false;
+    const uintptr_t off = v - base;
+    if (off % sizeof(Slot)) return false;
+    *idx = off / sizeof(Slot);
+    return true;
+  }
+
+  bool is_used(size_t idx) const {
+    return (__atomic_load_n(&used_[idx / 64u], __ATOMIC_RELAXED) >> (idx % 64u)) & 1u;
+  }
+
+  Slot     slots_[N];
+  uint16_t next_[N];                 // free-list links, index + 1
+  uint16_t gen_[N];                  // bumped by every free, wraps at kGenMask
+  uint64_t used_[(N + 63u) / 64u];   // bit set = allocated
+  spinlock lock_;
+  uint16_t free_head_;               // index + 1 of the first free slot, 0 = none
+  uint32_t bump_;                    // slots below this have been handed out
+  uint32_t in_use_;
+  uint32_t high_water_;
+  uint64_t allocs_;
+  uint64_t failed_;
+  uint64_t bad_frees_;
+};
@@ -12,17 +12,37 @@ struct mutex {
   Thread* waiters;      // wait-queue (Thread::wait_next)
   mutex*  owner_next;   // link in Thread::owned_mutexes
   int     pi_enabled;
+
+  // Lockdep class (see include/lockdep.h). Unused when lockdep is disabled.
+  const void* lock_key;   // class key; nullptr = the mutex itself
+  const char* lock_name;  // optional class name for reports
+  int         lock_class; // cached class index, -1 = not registered yet
 };
 
-void mutex_init(mutex* m);
+// Use the mutex_init() macro below. |key| nullptr makes the mutex its own
+// lockdep class.
+void mutex_init_key(mutex* m, const void* key, const char* name);
 void mutex_set_pi_enabled(mutex* m, int enabled);
+// Put |m| into the lockdep class identified by |key| (any stable address, e.g.
+// a static object shared by all instances of a per-object lock). Must be
+// called before the mutex is first locked.
+void mutex_set_lock_class(mutex* m, const void* key, const char* name);
+// Call before the memory of an unlocked mutex is reused (stack, kmalloc). If
+// the mutex is its own lockdep class, the class and its edges are dropped so
+// a later mutex at the same address does not inherit them.
+void mutex_destroy(mutex* m);
 void mutex_lock(mutex* m);
 // Try to acquire a mutex without blocking.
 // Returns 0 on success, -1 if the mutex is currently owned by another thread.
 int  mutex_trylock(mutex* m);
 void mutex_unlock(mutex* m);
 
-// Counting semaphore.
+// Set |t|'s effective priority to the highest of its base priority, its PI
+// waiters and an IPC donation (Thread::ipc_donated_prio).
+void thread_recompute_priority(Thread* t);
+
+// Counting semaphore. sem_up() and sem_trydown() may be called from IRQ
+// context.
 struct semaphore {
   int     count;        // may become negative while waiters exist
   Thread* waiters;      // wait-queue (Thread::wait_next)
@@ -31,7 +51,51 @@ struct semaphore {
 void sem_init(semaphore* s, int initial_count);
 void sem_down(semaphore* s);
 void sem_up(semaphore* s);
+// Non-blocking down: returns 0 if a count was taken, -1 otherwise.
+int  sem_trydown(semaphore* s);
+
+// Condition variable. Waiters must all use the same mutex.
+//
+// signal/broadcast never wake a thread only to have it block again on the
+// mutex: while the mutex is owned, waiters are requeued directly onto the
+// mutex wait-queue ("wait morphing") and receive ownership via mutex_unlock()
+// handoff. broadcast wakes at most one thread and requeues the rest.
+struct condvar {
+  Thread* waiters;      // wait-queue (Thread::wait_next), FIFO per priority
+  mutex*  m;            // mutex the current waiters released
+};
+
+void condvar_init(condvar* cv);
+// Atomically release |m| and block; |m| is held again on return.
+void condvar_wait(condvar* cv, mutex* m);
+void condvar_signal(condvar* cv);
+void condvar_broadcast(condvar* cv);
+
+// One-shot (or counted) completion event. complete(), complete_all() and
+// try_wait_for_completion() may be called from IRQ context.
+struct completion {
+  unsigned done;        // pending complete() count; kCompletionAll after complete_all()
+  Thread*  waiters;     // wait-queue (Thread::wait_next)
+};
+
+void init_completion(completion* c);
+void reinit_completion(completion* c);
+void wait_for_completion(completion* c);
+// Non-blocking variant: returns 0 if a completion was consumed, -1 otherwise.
+int  try_wait_for_completion(completion* c);
+// Wake one waiter (or bank one completion if nobody is waiting).
+void complete(completion* c);
+// Wake all current and future waiters until reinit_completion().
+void complete_all(completion* c);
 
 #ifdef __cplusplus
 }
 #endif
+
+// Every mutex initialized at the same mutex_init() call site shares one
+// lockdep class, so per-object locks do not each take a class slot.
+#define mutex_init(m)                               \
+  do {                                              \
+    static char mutex_init_site_key_;               \
+    mutex_init_key((m), &mutex_init_site_key_, #m); \
+  } while (0)
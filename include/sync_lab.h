@@ -10,7 +10,10 @@ extern "C" {
 // - mode=2: intentionally deadlock (AB/BA) and detect it
 // - mode=3: avoid deadlock via global lock ordering
 // - mode=4: avoid deadlock via trylock + backoff
-// - mode=5: avoid deadlock via simplified lockdep (cycle detection)
+// - mode=5: detect the deadlock via lockdep (lock-class graph cycle)
+// - mode=6: lockdep reports an AB/BA inversion whose orders never overlap
+// Condvar/completion lab:
+// - mode=7: broadcast requeues waiters onto the held mutex; completions
 void sync_lab_setup(unsigned mode);
 
 #ifdef __cplusplus
@@ -22,6 +22,19 @@ struct Thread {
   mutex*     waiting_on;          // mutex this thread is blocked on (for lockdep)
   mutex*     owned_mutexes;       // list head for priority inheritance
 
+  // ---- Timed waits (see sched_timeout_arm) ----
+  uint64_t   wake_tick;           // absolute tick the armed timeout fires at
+  Thread*    timeout_next;        // sorted per-CPU timeout list
+  Thread**   timeout_waitq;       // wait-queue to unlink from on expiry
+  int        timeout_armed;
+  int        wait_result;         // 0 = woken, -1 = timed out
+
+  // ---- IPC (see include/ipc.h) ----
+  void*      ipc_buf;             // message buffer while blocked in call/receive
+  Thread*    ipc_partner;         // server side: caller awaiting our reply
+  int        ipc_donated_prio;    // server side: client priority while serving it, -1 = none
+  int        ipc_saved_budget;    // server side: own slice while running on a donated one
+
   // ---- FPSIMD context ----
   int        fpsimd_valid;                 // 0 = never saved / initial zeros, 1 = valid saved state
   alignas(16) uint8_t fpsimd_vregs[32*16]; // q0..q31 (512 bytes)
@@ -47,12 +60,37 @@ void  sched_start(void);   // enter the first thread (never returns)
 void  thread_yield(void);  // cooperative switch to next thread
 __attribute__((noreturn)) void thread_exit(void);
 void  sched_resched_from_irq_tail(void);
+// First thing thread_trampoline runs: a new thread starts with IRQs enabled
+// even when it was switched to with them masked.
+void  sched_thread_start(void);
 void  sched_on_tick(void);
 
 // Scheduler/sync helpers (used by mutex/semaphore). These must be called with
-// preemption disabled.
+// preemption disabled. sched_make_runnable() is also safe from IRQ context.
 void sched_block_current(void);
 void sched_make_runnable(Thread* t);
+// Make |next| runnable and switch straight to it at the next preempt_enable(),
+// bypassing the runqueue pick (unless a strictly higher-priority thread is
+// ready). Used for IPC direct handoff.
+void sched_handoff(Thread* next);
+
+// Timed blocking. Timeouts are in scheduler ticks (cpu_local()->ticks).
+#define TIMEOUT_NO_WAIT 0ull
+#define TIMEOUT_FOREVER (~0ull)
+
+// Arm a timeout for |t| (normally the current thread, right before
+// sched_block_current()) at absolute tick |deadline|. If it expires while |t|
+// is still blocked, |t| is unlinked from |waitq| (may be nullptr), gets
+// Thread::wait_result = -1 and is made runnable. Any other wakeup disarms it.
+// Expiry runs in the timer softirq (IRQ exit or ksoftirqd), so |waitq| must
+// only be modified with IRQs masked.
+void sched_timeout_arm(Thread* t, uint64_t deadline, Thread** waitq);
+// SOFTIRQ_TIMER handler: expire every timeout due at the current tick.
+void sched_run_timeouts(void);
+// Block the current thread until cpu_local()->ticks reaches the absolute tick
+// |deadline|. Returns at once if it already has, or if the caller may not
+// sleep (no current thread, IRQ context).
+void thread_sleep_until(uint64_t deadline);
 
 int  thread_base_priority(const Thread* t);
 int  thread_effective_priority(const Thread* t);
@@ -0,0 +1,39 @@
+#pragma once
+#include <stdint.h>
+
+#include "smp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Batched TLB shootdown. Page-table updates collect the affected pages in a
+// tlb_batch and flush once: the local CPU invalidates them with non-broadcast
+// TLBIs behind a single DSB, and every other online CPU gets one call-function
+// IPI for the whole batch instead of one per page. Past TLB_BATCH_MAX pages
+// the batch degrades to a full (VMALLE1) flush.
+#define TLB_BATCH_MAX 32
+
+struct tlb_batch {
+  uintptr_t va[TLB_BATCH_MAX];
+  unsigned  nr;
+  unsigned  full;     // overflowed: flush everything
+};
+
+void tlb_batch_init(tlb_batch* b);
+void tlb_batch_add(tlb_batch* b, uintptr_t va);
+// Flush the batch on every online CPU (waits for remote CPUs, so call with
+// IRQs enabled) and reset it.
+void tlb_batch_flush(tlb_batch* b);
+
+struct tlb_stats {
+  uint64_t batches;
+  uint64_t pages;
+  uint64_t full;
+  uint64_t ipis;      // remote CPUs signalled
+};
+void tlb_get_stats(tlb_stats* out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Two-Level Segregated Fit allocator (Masmano et al., "TLSF: a New Dynamic
+// Memory Allocator for Real-Time Systems", ECRTS 2004).
+//
+// Free blocks sit on one of TLSF_FL_COUNT x TLSF_SL_COUNT segregated lists.
+// The first level splits sizes by powers of two and the second level divides
+// each power-of-two range into TLSF_SL_COUNT linear steps; sizes below 256
+// bytes use 16-byte steps. A bitmap per level lets malloc find a non-empty
+// list that is guaranteed to fit with two find-first-set instructions, with
+// no list search. Free merges with both physical neighbours immediately.
+// Both operations are O(1): their cost does not depend on heap size or
+// state.
+//
+// Blocks carry a 16-byte header (previous physical block, size and flags).
+// Payloads are 16-byte aligned and a multiple of 16 bytes. Good-fit rounding
+// wastes at most 1/TLSF_SL_COUNT of a request. A heap is not locked;
+// callers serialize access.
+#define TLSF_SL_LOG2   4
+#define TLSF_SL_COUNT  (1u << TLSF_SL_LOG2)
+#define TLSF_FL_MAX    24                       // blocks below 16 MiB
+#define TLSF_FL_SHIFT  (TLSF_SL_LOG2 + 4)       // 256: end of the linear range
+#define TLSF_FL_COUNT  (TLSF_FL_MAX - TLSF_FL_SHIFT + 1)
+#define TLSF_MAX_POOLS 8
+
+struct tlsf_block;
+
+struct tlsf_heap {
+  uint32_t           fl_bitmap;
+  uint32_t           sl_bitmap[TLSF_FL_COUNT];
+  struct tlsf_block* blocks[TLSF_FL_COUNT][TLSF_SL_COUNT];
+  void*              pools[TLSF_MAX_POOLS];   // first block of each pool
+  unsigned           nr_pools;
+  uint64_t           mallocs;
+  uint64_t           frees;
+  uint64_t           failed;
+  uint64_t           bad_frees;               // unknown pointers, double frees
+};
+
+struct tlsf_report {
+  size_t   pool_bytes;
+  size_t   used_bytes;        // payload of allocated blocks
+  size_t   used_blocks;
+  size_t   free_bytes;
+  size_t   free_blocks;
+  size_t   largest_free;
+  unsigned external_frag_pct; // 100 * (1 - largest_free / free_bytes)
+  uint64_t mallocs;
+  uint64_t frees;
+  uint64_t failed;
+  uint64_t bad_frees;
+};
+
+// Start a heap over [mem, mem + bytes). Returns 0, or -1 if the region is too
+// small or too large (at most 1 << TLSF_FL_MAX bytes per pool).
+int    tlsf_init(struct tlsf_heap* h, void* mem, size_t bytes);
+// Add another region to an existing heap. Returns 0 or -1.
+int    tlsf_add_pool(struct tlsf_heap* h, void* mem, size_t bytes);
+
+void*  tlsf_malloc(struct tlsf_heap* h, size_t size);
+// Nonzero if a fresh pool of |pool_bytes| (16-byte aligned) would satisfy
+// tlsf_malloc(size). Lets a caller that grows the heap on demand refuse
+// requests no new pool can hold.
+int    tlsf_pool_fits(size_t pool_bytes, size_t size);
+// Ignores nullptr. Pointers whose header is not an allocated block are
+// counted in bad_frees and ignored.
+void   tlsf_free(struct tlsf_heap* h, void* p);
+// Payload bytes of an allocated block (at least the requested size).
+size_t tlsf_block_size(const void* p);
+
+// Walks every block; O(number of blocks), for diagnostics only.
+void   tlsf_report_get(const struct tlsf_heap* h, struct tlsf_report* out);
+void   tlsf_report_print(const char* tag, const struct tlsf_heap* h);
+
+#ifdef __cplusplus
+}
+#endif
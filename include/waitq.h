@@ -0,0 +1,33 @@
+#pragma once
+
+#include "thread.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Thread wait-queues shared by the blocking primitives (mutex, semaphore,
+// condvar, completion, IPC). A queue is a Thread* head linked through
+// Thread::wait_next. All helpers must be called with preemption disabled
+// (and IRQs masked if the queue is also touched from IRQ context).
+
+// Append |t| at the tail (FIFO among equal priorities).
+void waitq_append(Thread** head, Thread* t);
+
+// Unlink and return the highest effective-priority waiter (oldest first among
+// equals when the queue is filled with waitq_append()); nullptr if empty.
+Thread* waitq_pop_highest(Thread** head);
+
+// Highest effective priority among the waiters, or -1 if the queue is empty.
+int waitq_max_priority(Thread* head);
+
+// Unlink |t| if it is queued on |head|; returns 1 if it was found.
+int waitq_remove(Thread** head, Thread* t);
+
+// Make a dequeued waiter runnable and request a reschedule if it should
+// preempt the current thread.
+void waitq_wake(Thread* t);
+
+#ifdef __cplusplus
+}
+#endif
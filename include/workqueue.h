@@ -0,0 +1,49 @@
+#pragma once
+#include <stdint.h>
+
+#include "sync.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Workqueues: deferred work that may sleep, run by dedicated worker threads.
+// queue_work() is IRQ-safe, so a hard-IRQ (or softirq) handler can push the
+// part of its job that needs to block. A work item is queued at most once
+// until it starts running; it may requeue itself.
+struct work_struct;
+typedef void (*work_fn_t)(work_struct* work);
+
+struct work_struct {
+  work_struct*      next;
+  work_fn_t         fn;
+  volatile uint32_t pending;
+};
+
+struct workqueue {
+  const char*  name;
+  work_struct* head;
+  work_struct* tail;
+  semaphore    items;      // one count per queued work item
+  unsigned     nr_workers;
+  uint64_t     executed;
+};
+
+void work_init(work_struct* work, work_fn_t fn);
+
+// Create a queue served by |nr_workers| threads at scheduler priority |prio|.
+// Call after sched_init(). Queues come from a static pool of 8, system_wq
+// included. Returns nullptr when the pool or thread creation runs out.
+workqueue* workqueue_create(const char* name, unsigned nr_workers, int prio);
+
+// Returns 1 if queued, 0 if |work| was already pending.
+int queue_work(workqueue* wq, work_struct* work);
+
+// Create the shared system_wq; call after sched_init().
+void workqueue_init(void);
+extern workqueue* system_wq;
+int schedule_work(work_struct* work);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,138 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+if ! command -v qemu-system-aarch64 >/dev/null 2>&1; then
+  echo "::error ::qemu-system-aarch64 not found in PATH; install QEMU to run the bench lab"
+  exit 2
+fi
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+REPO_ROOT="$(cd "${SCRIPT_DIR}/.." && pwd)"
+cd "${REPO_ROOT}"
+
+BUILD_DIR="${REPO_ROOT}/build"
+LOG_PATH="${BUILD_DIR}/qemu-bench-lab.log"
+TRACE_LOG="${BUILD_DIR}/qemu-bench-lab-trace.log"
+
+export VIRT_RAM_MB="${VIRT_RAM_MB:-512}"
+HIST_CSV="${BUILD_DIR}/bench-lab-hist.csv"
+
+BENCH_LAB_MODE="${BENCH_LAB_MODE:-1}"
+BENCH_THREADS="${BENCH_THREADS:-4}"
+BENCH_LOOPS="${BENCH_LOOPS:-500}"
+BENCH_HOGS="${BENCH_HOGS:-2}"
+BENCH_LOCKERS="${BENCH_LOCKERS:-2}"
+BENCH_DMA_THREADS="${BENCH_DMA_THREADS:-1}"
+BENCH_TIMEOUT="${BENCH_TIMEOUT:-15s}"
+
+echo "[bench] Building kernel (SCHED_POLICY=PRIO BENCH_LAB_MODE=${BENCH_LAB_MODE} threads=${BENCH_THREADS} loops=${BENCH_LOOPS} hogs=${BENCH_HOGS} lockers=${BENCH_LOCKERS} dma=${BENCH_DMA_THREADS})..."
+make clean
+if ! make -j \
+  DMA_LAB_MODE=0 \
+  MEM_LAB_MODE=0 \
+  STACK_LAB_MODE=0 \
+  LOCK_LAB_MODE=0 \
+  SYNC_LAB_MODE=0 \
+  IPC_LAB_MODE=0 \
+  IRQ_LAB_MODE=0 \
+  SCHED_POLICY=PRIO \
+  BENCH_THREADS="${BENCH_THREADS}" \
+  BENCH_LOOPS="${BENCH_LOOPS}" \
+  BENCH_HOGS="${BENCH_HOGS}" \
+  BENCH_LOCKERS="${BENCH_LOCKERS}" \
+  BENCH_DMA_THREADS="${BENCH_DMA_THREADS}" \
+  BENCH_LAB_MODE="${BENCH_LAB_MODE}"; then
+  echo "::error ::Kernel build failed; see make output above"
+  exit 1
+fi
+
+mkdir -p "${BUILD_DIR}"
+
+: >"${LOG_PATH}"
+: >"${TRACE_LOG}"
+
+CMD=(
+  qemu-system-aarch64
+  -machine virt,gic-version=3
+  -cpu cortex-a72
+  -smp 1
+  -m "${VIRT_RAM_MB}"
+  -nographic
+  -serial mon:stdio
+  -kernel "${BUILD_DIR}/kernel.elf"
+  -d guest_errors,unimp
+  -D "${TRACE_LOG}"
+)
+
+echo "[bench] Launching QEMU with ${BENCH_TIMEOUT} timeout..."
+set +e
+timeout "${BENCH_TIMEOUT}" "${CMD[@]}" 2>&1 | tee "${LOG_PATH}"
+status=${PIPESTATUS[0]}
+set -e
+
+if [[ ${status} -eq 124 ]]; then
+  echo "[bench] QEMU terminated after timeout (expected for lab)."
+  status=0
+fi
+if [[ ${status} -ne 0 ]]; then
+  echo "[bench] QEMU exited with status ${status}."
+  exit "${status}"
+fi
+
+if [[ -s "${TRACE_LOG}" ]] && grep -Eq '(^unimp([[:space:]:]|$)|unimp:|unimplemented|guest[_[:space:]]+error|guest_errors)' "${TRACE_LOG}"; then
+  echo "::error ::QEMU produced guest_errors/unimp logs (see ${TRACE_LOG})"
+  tail -n 50 "${TRACE_LOG}" || true
+  exit 1
+fi
+
+if grep -qF "[EXC]" "${LOG_PATH}"; then
+  echo "::error ::Unexpected exception in bench lab log; see ${LOG_PATH}"
+  exit 1
+fi
+
+for needle in "[bench] done mode=${BENCH_LAB_MODE}" "[bench] result PASS"; do
+  if ! grep -qF "${needle}" "${LOG_PATH}"; then
+    echo "::error ::Missing expected bench lab output: ${needle}"
+    tail -n 160 "${LOG_PATH}" || true
+    exit 1
+  fi
+done
+
+# Summary table plus one histogram per measurement thread. The CSV keeps the
+# raw buckets so runs can be compared across scheduler changes.
+tr -d '\r' <"${LOG_PATH}" | awk -v csv="${HIST_CSV}" '
+  function field(line, key,    re) {
+    re = " " key "=[^ ]+"
+    if (!match(line, re)) return ""
+    return substr(line, RSTART + length(key) + 2, RLENGTH - length(key) - 2)
+  }
+  /\[bench\] t=/ {
+    t = field($0, "t")
+    printf "thread %s prio=%s interval=%sms n=%s min=%sus avg=%sus max=%sus p99=%sus\n", t,
+      field($0, "prio"), field($0, "interval_ticks"), field($0, "n"),
+      field($0, "min_ns") / 1000, field($0, "avg_ns") / 1000,
+      field($0, "max_ns") / 1000, field($0, "p99_ns") / 1000
+    threads[++nt] = t
+  }
+  /\[bench\] hist t=/ {
+    t = field($0, "t"); us = field($0, "us"); n = field($0, "n") + 0
+    rows[t] = rows[t] " " us ":" n
+    if (n > peak[t]) peak[t] = n
+    if (!header++) print "thread,us,count" > csv
+    print t "," us "," n > csv
+  }
+  END {
+    for (i = 1; i <= nt; ++i) {
+      t = threads[i]
+      printf "\nthread %s lateness histogram (us, count)\n", t
+      m = split(rows[t], cells, " ")
+      for (j = 1; j <= m; ++j) {
+        split(cells[j], kv, ":")
+        w = int(kv[2] * 50 / peak[t]); if (w < 1) w = 1
+        bar = sprintf("%" w "s", ""); gsub(/ /, "#", bar)
+        printf "  %6s %7s %s\n", kv[1], kv[2], bar
+      }
+    }
+  }'
+echo "[bench] Histogram buckets written to ${HIST_CSV}"
+echo "[bench] All lab checks passed."
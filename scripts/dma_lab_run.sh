@@ -14,6 +14,8 @@ BUILD_DIR="${REPO_ROOT}/build"
 LOG_PATH="${BUILD_DIR}/qemu-dma-lab.log"
 TRACE_LOG="${BUILD_DIR}/qemu-dma-lab-trace.log"
 
+export VIRT_RAM_MB="${VIRT_RAM_MB:-512}"
+
 DMA_WINDOW_POLICY="${DMA_WINDOW_POLICY:-CACHEABLE}"
 DMA_LAB_MODE="${DMA_LAB_MODE:-1}"
 
@@ -24,6 +26,9 @@ if ! make -j \
   SYNC_LAB_MODE=0 \
   STACK_LAB_MODE=0 \
   LOCK_LAB_MODE=0 \
+  IPC_LAB_MODE=0 \
+  IRQ_LAB_MODE=0 \
+  BENCH_LAB_MODE=0 \
   SCHED_POLICY=RR \
   DMA_WINDOW_POLICY="${DMA_WINDOW_POLICY}" \
   DMA_LAB_MODE="${DMA_LAB_MODE}"; then
@@ -41,7 +46,7 @@ CMD=(
   -machine virt,gic-version=3
   -cpu cortex-a72
   -smp 1
-  -m 512
+  -m "${VIRT_RAM_MB}"
   -nographic
   -serial mon:stdio
   -kernel "${BUILD_DIR}/kernel.elf"
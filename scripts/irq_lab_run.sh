@@ -0,0 +1,127 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+if ! command -v qemu-system-aarch64 >/dev/null 2>&1; then
+  echo "::error ::qemu-system-aarch64 not found in PATH; install QEMU to run IRQ labs"
+  exit 2
+fi
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+REPO_ROOT="$(cd "${SCRIPT_DIR}/.." && pwd)"
+cd "${REPO_ROOT}"
+
+BUILD_DIR="${REPO_ROOT}/build"
+LOG_PATH="${BUILD_DIR}/qemu-irq-lab.log"
+TRACE_LOG="${BUILD_DIR}/qemu-irq-lab-trace.log"
+
+export VIRT_RAM_MB="${VIRT_RAM_MB:-512}"
+
+IRQ_LAB_MODE="${IRQ_LAB_MODE:-1}"
+IRQ_PMR_MASKING=0
+IRQ_LATENCY_TRACE=0
+if [[ "${IRQ_LAB_MODE}" == "3" ]]; then
+  IRQ_PMR_MASKING=1
+fi
+if [[ "${IRQ_LAB_MODE}" == "5" ]]; then
+  IRQ_LATENCY_TRACE=1
+fi
+
+echo "[irq-lab] Building kernel (SCHED_POLICY=PRIO IRQ_LAB_MODE=${IRQ_LAB_MODE} IRQ_PMR_MASKING=${IRQ_PMR_MASKING} IRQ_LATENCY_TRACE=${IRQ_LATENCY_TRACE})..."
+make clean
+if ! make -j \
+  DMA_LAB_MODE=0 \
+  MEM_LAB_MODE=0 \
+  STACK_LAB_MODE=0 \
+  LOCK_LAB_MODE=0 \
+  SYNC_LAB_MODE=0 \
+  BENCH_LAB_MODE=0 \
+  SCHED_POLICY=PRIO \
+  IPC_LAB_MODE=0 \
+  IRQ_PMR_MASKING="${IRQ_PMR_MASKING}" \
+  IRQ_LATENCY_TRACE="${IRQ_LATENCY_TRACE}" \
+  IRQ_LAB_MODE="${IRQ_LAB_MODE}"; then
+  echo "::error ::Kernel build failed; see make output above"
+  exit 1
+fi
+
+mkdir -p "${BUILD_DIR}"
+
+: >"${LOG_PATH}"
+: >"${TRACE_LOG}"
+
+CMD=(
+  qemu-system-aarch64
+  -machine virt,gic-version=3
+  -cpu cortex-a72
+  -smp 1
+  -m "${VIRT_RAM_MB}"
+  -nographic
+  -serial mon:stdio
+  -kernel "${BUILD_DIR}/kernel.elf"
+  -d guest_errors,unimp
+  -D "${TRACE_LOG}"
+)
+
+echo "[irq-lab] Launching QEMU with 10s timeout..."
+set +e
+timeout 10s "${CMD[@]}" 2>&1 | tee "${LOG_PATH}"
+status=${PIPESTATUS[0]}
+set -e
+
+if [[ ${status} -eq 124 ]]; then
+  echo "[irq-lab] QEMU terminated after timeout (expected for lab)."
+  status=0
+fi
+if [[ ${status} -ne 0 ]]; then
+  echo "[irq-lab] QEMU exited with status ${status}."
+  exit "${status}"
+fi
+
+if [[ -s "${TRACE_LOG}" ]] && grep -Eq '(^unimp([[:space:]:]|$)|unimp:|unimplemented|guest[_[:space:]]+error|guest_errors)' "${TRACE_LOG}"; then
+  echo "::error ::QEMU produced guest_errors/unimp logs (see ${TRACE_LOG})"
+  tail -n 50 "${TRACE_LOG}" || true
+  exit 1
+fi
+
+if grep -qF "[EXC]" "${LOG_PATH}"; then
+  echo "::error ::Unexpected exception in IRQ lab log; see ${LOG_PATH}"
+  exit 1
+fi
+
+case "${IRQ_LAB_MODE}" in
+  1)
+    required=("[irq-lab] softirq overflow to ksoftirqd ok" "[irq-lab] work queued=1 requeue=0 ran=1" "[irq-lab] result PASS")
+    ;;
+  2)
+    required=("[irq-lab] nest high depth=2 inside_low=1 peer depth=1 inside_low=0" "[irq-lab] result PASS")
+    ;;
+  3)
+    required=("[irq-lab] irqsave nmi=1 masked=0 after_restore masked=1" "[irq-lab] irqsave+restore avg cycles=" "[irq-lab] result PASS")
+    ;;
+  4)
+    required=("[irq-lab] ipi calls ran=4 in_irq=4 sgis=1 fifo=1 busy_rc=1 local_masked=1" "[irq-lab] ipi resched=1 tlb batches=2 pages=3 full=1" "[irq-lab] result PASS")
+    ;;
+  5)
+    required=("[irq-lat] cpu=0 timer n=" "[irq-lat] cpu=0 entry n=" "[irq-lab] latency histograms ok" "[irq-lab] result PASS")
+    ;;
+  6)
+    required=("[irq-lab] lockfree pool thread_allocs=" "[irq-lab] lockfree pool dups=0 available=32/32" "[irq-lab] result PASS")
+    ;;
+  7)
+    required=("[irq-lab] ring spsc pushed=2000 popped=2000 gaps=0 drops=0" "[irq-lab] ring mpmc popped=4000/4000 sum ok" "[irq-lab] result PASS")
+    ;;
+  *)
+    echo "::error ::Unknown IRQ_LAB_MODE=${IRQ_LAB_MODE} for script expectations"
+    exit 2
+    ;;
+esac
+
+for needle in "${required[@]}"; do
+  if ! grep -qF "${needle}" "${LOG_PATH}"; then
+    echo "::error ::Missing expected IRQ lab output: ${needle}"
+    tail -n 160 "${LOG_PATH}" || true
+    exit 1
+  fi
+done
+
+echo "[irq-lab] All lab checks passed."
@@ -14,6 +14,8 @@ BUILD_DIR="${REPO_ROOT}/build"
 LOG_PATH="${BUILD_DIR}/qemu-lock-lab.log"
 TRACE_LOG="${BUILD_DIR}/qemu-lock-lab-trace.log"
 
+export VIRT_RAM_MB="${VIRT_RAM_MB:-512}"
+
 LOCK_LAB_MODE="${LOCK_LAB_MODE:-1}"
 
 echo "[lock-lab] Building kernel (SCHED_POLICY=PRIO LOCK_LAB_MODE=${LOCK_LAB_MODE})..."
@@ -23,6 +25,9 @@ if ! make -j \
   MEM_LAB_MODE=0 \
   SYNC_LAB_MODE=0 \
   STACK_LAB_MODE=0 \
+  IPC_LAB_MODE=0 \
+  IRQ_LAB_MODE=0 \
+  BENCH_LAB_MODE=0 \
   LOCK_LAB_MODE="${LOCK_LAB_MODE}" \
   SCHED_POLICY=PRIO; then
   echo "::error ::Kernel build failed; see make output above"
@@ -39,7 +44,7 @@ CMD=(
   -machine virt,gic-version=3
   -cpu cortex-a72
   -smp 1
-  -m 512
+  -m "${VIRT_RAM_MB}"
   -nographic
   -serial mon:stdio
   -kernel "${BUILD_DIR}/kernel.elf"
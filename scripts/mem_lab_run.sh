@@ -14,16 +14,23 @@ BUILD_DIR="${REPO_ROOT}/build"
 LOG_PATH="${BUILD_DIR}/qemu-mem-lab.log"
 TRACE_LOG="${BUILD_DIR}/qemu-mem-lab-trace.log"
 
+export VIRT_RAM_MB="${VIRT_RAM_MB:-512}"
+
 MEM_LAB_MODE="${MEM_LAB_MODE:-1}"
+KMALLOC_TLSF="${KMALLOC_TLSF:-0}"
 
-echo "[mem-lab] Building kernel (MEM_LAB_MODE=${MEM_LAB_MODE})..."
+echo "[mem-lab] Building kernel (MEM_LAB_MODE=${MEM_LAB_MODE} KMALLOC_TLSF=${KMALLOC_TLSF})..."
 make clean
 if ! make -j \
   DMA_LAB_MODE=0 \
   SYNC_LAB_MODE=0 \
   STACK_LAB_MODE=0 \
   LOCK_LAB_MODE=0 \
+  IPC_LAB_MODE=0 \
+  IRQ_LAB_MODE=0 \
+  BENCH_LAB_MODE=0 \
   SCHED_POLICY=RR \
+  KMALLOC_TLSF="${KMALLOC_TLSF}" \
   MEM_LAB_MODE="${MEM_LAB_MODE}"; then
   echo "::error ::Kernel build failed; see make output above"
   exit 1
@@ -39,7 +46,7 @@ CMD=(
   -machine virt,gic-version=3
   -cpu cortex-a72
   -smp 1
-  -m 512
+  -m "${VIRT_RAM_MB}"
   -nographic
   -serial mon:stdio
   -kernel "${BUILD_DIR}/kernel.elf"
@@ -73,11 +80,56 @@ if grep -qF "[EXC]" "${LOG_PATH}"; then
   exit 1
 fi
 
-required=(
-  "[mem-lab][pool] internal_frag_pct="
-  "[mem-lab][malloc] external_frag_pct="
-  "big alloc FAILED (fragmentation)"
-)
+if [[ "${MEM_LAB_MODE}" == "2" ]]; then
+  required=(
+    "[page] range="
+    "[mem-lab][page] coalesced back to the initial free lists"
+    "[mem-lab][page] kmem refilled from pages"
+    "[mem-lab][page] PASS"
+  )
+elif [[ "${MEM_LAB_MODE}" == "8" ]]; then
+  required=(
+    "[mem-lab][arena] every request rewound to empty"
+    "[mem-lab][arena] pages returned on release"
+    "[mem-lab][arena] PASS"
+  )
+elif [[ "${MEM_LAB_MODE}" == "7" ]]; then
+  required=(
+    "[mem-lab][static] handles round-trip"
+    "[mem-lab][static] handle to a reused slot rejected"
+    "[static_pool] lab_msg obj=64 cap=8"
+    "[mem-lab][static] PASS"
+  )
+elif [[ "${MEM_LAB_MODE}" == "6" ]]; then
+  required=(
+    "[mem-lab][tlsf] report"
+    "[mem-lab][tlsf] heap coalesced back to one block"
+    "[mem-lab][tlsf] PASS"
+  )
+elif [[ "${MEM_LAB_MODE}" == "5" ]]; then
+  required=(
+    "[mem-lab][cache] slab colors spread first objects"
+    "[mem-lab][cache] reused object kept its constructed state"
+    "[mem-lab][cache] PASS"
+  )
+elif [[ "${MEM_LAB_MODE}" == "4" ]]; then
+  required=(
+    "[mem-lab][mag] drain returned every block"
+    "[mem-lab][mag] PASS"
+  )
+elif [[ "${MEM_LAB_MODE}" == "3" ]]; then
+  required=(
+    "[mem-lab][kmalloc] double free rejected"
+    "[mem-lab][kmalloc] slabs shrank back to the spare"
+    "[mem-lab][kmalloc] PASS"
+  )
+else
+  required=(
+    "[mem-lab][pool] internal_frag_pct="
+    "[mem-lab][malloc] external_frag_pct="
+    "big alloc FAILED (fragmentation)"
+  )
+fi
 for needle in "${required[@]}"; do
   if ! grep -qF "${needle}" "${LOG_PATH}"; then
     echo "::error ::Missing expected memory lab output: ${needle}"
@@ -14,6 +14,10 @@ BUILD_DIR="${REPO_ROOT}/build"
 LOG_PATH="${BUILD_DIR}/qemu-smoke.log"
 TRACE_LOG="${BUILD_DIR}/qemu-trace.log"
 
+export VIRT_RAM_MB="${VIRT_RAM_MB:-512}"
+
+IRQSOFF_TRACE="${IRQSOFF_TRACE:-0}"
+
 echo "[smoke] Building kernel (make clean && make -j)..."
 make clean
 SMOKE_MAKE_ARGS=(
@@ -22,6 +26,10 @@ SMOKE_MAKE_ARGS=(
   SYNC_LAB_MODE=0
   STACK_LAB_MODE=0
   LOCK_LAB_MODE=0
+  IPC_LAB_MODE=0
+  IRQ_LAB_MODE=0
+  BENCH_LAB_MODE=0
+  IRQSOFF_TRACE="${IRQSOFF_TRACE}"
   SCHED_POLICY=RR
 )
 if ! make -j "${SMOKE_MAKE_ARGS[@]}"; then
@@ -80,7 +88,7 @@ CMD=(
   -machine virt,gic-version=3
   -cpu cortex-a72
   -smp 1
-  -m 512
+  -m "${VIRT_RAM_MB}"
   -nographic
   -serial mon:stdio
   -kernel "${BUILD_DIR}/kernel.elf"
@@ -182,4 +190,22 @@ if ! grep -qF "[DMA OK]" "${LOG_PATH}"; then
 fi
 echo "[smoke] DMA OK."
 
+# irqsoff/preemptoff tracer: report the longest sections with their call sites.
+if [[ "${IRQSOFF_TRACE}" != "0" ]]; then
+  for kind in irqsoff preemptoff; do
+    line=$(tr -d '\r' <"${LOG_PATH}" | grep -F "[irqsoff] cpu=0 ${kind} " | tail -n 1 || true)
+    if [[ -z "${line}" ]]; then
+      echo "::error ::Missing irqsoff tracer output for ${kind}"
+      exit 1
+    fi
+    echo "[smoke] ${line}"
+    ADDR2LINE=$(command -v llvm-addr2line || command -v addr2line || true)
+    if [[ -n "${ADDR2LINE}" ]]; then
+      for ip in $(printf '%s\n' "${line}" | grep -oE '(start|end)=0x[0-9a-f]+' | cut -d= -f2); do
+        echo "[smoke]   ${ip} $("${ADDR2LINE}" -f -C -e "${BUILD_DIR}/kernel.elf" "${ip}" | paste -sd' ' -)"
+      done
+    fi
+  done
+fi
+
 echo "[smoke] All checks passed."
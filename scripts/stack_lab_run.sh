@@ -14,6 +14,8 @@ BUILD_DIR="${REPO_ROOT}/build"
 LOG_PATH="${BUILD_DIR}/qemu-stack-lab.log"
 TRACE_LOG="${BUILD_DIR}/qemu-stack-lab-trace.log"
 
+export VIRT_RAM_MB="${VIRT_RAM_MB:-512}"
+
 STACK_LAB_MODE="${STACK_LAB_MODE:-1}"
 
 echo "[stack-lab] Building kernel (STACK_LAB_MODE=${STACK_LAB_MODE})..."
@@ -23,6 +25,9 @@ if ! make -j \
   MEM_LAB_MODE=0 \
   SYNC_LAB_MODE=0 \
   LOCK_LAB_MODE=0 \
+  IPC_LAB_MODE=0 \
+  IRQ_LAB_MODE=0 \
+  BENCH_LAB_MODE=0 \
   SCHED_POLICY=RR \
   STACK_LAB_MODE="${STACK_LAB_MODE}"; then
   echo "::error ::Kernel build failed; see make output above"
@@ -39,7 +44,7 @@ CMD=(
   -machine virt,gic-version=3
   -cpu cortex-a72
   -smp 1
-  -m 512
+  -m "${VIRT_RAM_MB}"
   -nographic
   -serial mon:stdio
   -kernel "${BUILD_DIR}/kernel.elf"
@@ -15,6 +15,12 @@ extern "C" void cpu_local_boot_init(void) {
   cpu0.need_resched = 0u;
   cpu0.ticks = 0ul;
   cpu0.irq_depth = 0u;
+  cpu0.handoff_next = nullptr;
+  cpu0.softirq_pending = 0u;
+  cpu0.in_softirq = 0u;
+  cpu0.cpu_id = 0u;
+  cpu0.irq_entry_cnt = 0u;
+  cpu0.irq_eret_cnt = 0u;
   uintptr_t p = (uintptr_t)&cpu0;
   asm volatile("msr tpidr_el1, %0" :: "r"(p));
   asm volatile("isb");
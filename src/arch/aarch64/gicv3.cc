@@ -54,6 +54,70 @@ inline void gicr_wake() {
   }
 }
 
+// Distributor register offsets (SPI banks; SGI/PPI banks live in GICR_SGI_BASE
+// at the same offsets).
+constexpr uint64_t kGicdCtlr       = 0x0000;
+constexpr uint64_t kGicdTyper      = 0x0004;
+constexpr uint64_t kGicdIgroupr    = 0x0080;
+constexpr uint64_t kGicdIsenabler  = 0x0100;
+constexpr uint64_t kGicdIcenabler  = 0x0180;
+constexpr uint64_t kGicdIpriorityr = 0x0400;
+constexpr uint64_t kGicdIcfgr      = 0x0C00;
+constexpr uint64_t kGicdIgrpmodr   = 0x0D00;
+constexpr uint64_t kGicdIrouter    = 0x6000;
+
+constexpr uint32_t kGicdCtlrEnableGrp1NS = 1u << 1;
+constexpr uint32_t kGicdCtlrAreNS        = 1u << 4;
+constexpr uint32_t kGicdCtlrRwp          = 1u << 31;
+
+uint32_t g_num_intids = GIC_SPI_BASE;
+
+inline void gicd_wait_rwp() {
+  while (mmio_r32(GICD_BASE + kGicdCtlr) & kGicdCtlrRwp) {
+  }
+}
+
+inline void gicr_wait_rwp() {
+  while (mmio_r32(GICR_BASE + 0x0000) & (1u << 3)) {  // GICR_CTLR.RWP
+  }
+}
+
+// Frame holding the banked registers for |intid|.
+inline uint64_t gic_frame(uint32_t intid) {
+  return (intid < GIC_SPI_BASE) ? GICR_SGI_BASE : GICD_BASE;
+}
+
+inline uint64_t mpidr_affinity() {
+  uint64_t mpidr = 0;
+  asm volatile("mrs %0, mpidr_el1" : "=r"(mpidr));
+  // IROUTER layout: Aff3[39:32] Aff2[23:16] Aff1[15:8] Aff0[7:0], IRM=0.
+  return (mpidr & 0x00FFFFFFull) | (((mpidr >> 32) & 0xFFull) << 32);
+}
+
+void gicd_init_spis() {
+  const uint32_t typer = mmio_r32(GICD_BASE + kGicdTyper);
+  uint32_t n = 32u * ((typer & 0x1Fu) + 1u);
+  if (n > GIC_MAX_INTID) n = GIC_MAX_INTID;
+  g_num_intids = n;
+
+  // Disable first, then: all SPIs Non-secure Group1, level, default priority.
+  for (uint32_t i = GIC_SPI_BASE; i < n; i += 32u) {
+    mmio_w32(GICD_BASE + kGicdIcenabler + (i / 32u) * 4u, 0xFFFFFFFFu);
+  }
+  gicd_wait_rwp();
+  for (uint32_t i = GIC_SPI_BASE; i < n; i += 32u) {
+    mmio_w32(GICD_BASE + kGicdIgroupr + (i / 32u) * 4u, 0xFFFFFFFFu);
+    mmio_w32(GICD_BASE + kGicdIgrpmodr + (i / 32u) * 4u, 0u);
+  }
+  for (uint32_t i = GIC_SPI_BASE; i < n; i += 16u) {
+    mmio_w32(GICD_BASE + kGicdIcfgr + (i / 16u) * 4u, 0u);
+  }
+  volatile uint8_t* prio = (volatile uint8_t*)(GICD_BASE + kGicdIpriorityr);
+  for (uint32_t i = GIC_SPI_BASE; i < n; ++i) {
+    prio[i] = GIC_PRIO_DEFAULT;
+  }
+}
+
 inline uint64_t read_icc_pmr() {
   uint64_t v = 0;
   asm volatile("mrs %0, ICC_PMR_EL1" : "=r"(v));
@@ -67,6 +131,12 @@ inline uint64_t read_icc_igrpen1() {
 }
 }  // namespace
 
+void gic_cpuif_early_init() {
+  enable_sre_el1();
+  asm volatile("msr ICC_PMR_EL1, %0" :: "r"(0xFFull));
+  asm volatile("isb");
+}
+
 void gic_init() {
   gicr_wake();
 
@@ -78,21 +148,23 @@ void gic_init() {
   // Level-triggered for PPIs: **GICR_ICFGR1 is at 0x0C04 (NOT 0x00C4)**
   mmio_w32(GICR_SGI_BASE + 0x0C04, 0x00000000u); // GICR_ICFGR1
 
-  // Enable SGI #1 plus the selected timer PPI
-#if USE_CNTP
-  mmio_w32(GICR_SGI_BASE + 0x0100, (1u << 1) | (1u << 30));
-#else
-  mmio_w32(GICR_SGI_BASE + 0x0100, (1u << 1) | (1u << 27));
-#endif
-
-  // Priority for INTIDs 1/27/30 (one byte per INTID from 0..31)
-  volatile uint8_t* prio = (volatile uint8_t*)(GICR_SGI_BASE + 0x0400);
-  prio[1]  = 0x80;
-  prio[27] = 0x80;
-  prio[30] = 0x80;
+  // Everything starts disabled at the default priority; devices (including
+  // the timer PPI) are enabled through irq_register(). SGI #1 stays enabled
+  // for diagnostics.
+  mmio_w32(GICR_SGI_BASE + kGicdIcenabler, 0xFFFFFFFFu);  // GICR_ICENABLER0
+  gicr_wait_rwp();
+  volatile uint8_t* prio = (volatile uint8_t*)(GICR_SGI_BASE + kGicdIpriorityr);
+  for (uint32_t i = 0; i < GIC_SPI_BASE; ++i) {
+    prio[i] = GIC_PRIO_DEFAULT;
+  }
+  mmio_w32(GICR_SGI_BASE + kGicdIsenabler, (1u << 1));
 
-  // Distributor: enable Group1NS
-  mmio_w32(GICD_BASE + 0x0000, (1u << 1)); // GICD_CTLR.EnableGrp1NS
+  // Distributor: affinity routing + Group1NS, SPIs configured but disabled.
+  mmio_w32(GICD_BASE + kGicdCtlr, 0u);
+  gicd_wait_rwp();
+  gicd_init_spis();
+  mmio_w32(GICD_BASE + kGicdCtlr, kGicdCtlrAreNS | kGicdCtlrEnableGrp1NS);
+  gicd_wait_rwp();
 
   // CPU interface: sysregs path
   enable_sre_el1();
@@ -110,7 +182,8 @@ void gic_init() {
   uart_puts("\n");
 
   const uint32_t ctlr = mmio_r32(GICD_BASE + 0x0000);
-  uart_puts("[gicd] ctlr=0x"); uart_puthex32(ctlr); uart_puts("\n");
+  uart_puts("[gicd] ctlr=0x"); uart_puthex32(ctlr);
+  uart_puts(" intids=0x");     uart_puthex32(g_num_intids); uart_puts("\n");
 
   const uint64_t pmr  = read_icc_pmr();
   const uint64_t grp1 = read_icc_igrpen1();
@@ -131,3 +204,74 @@ void gic_eoi(uint32_t iar) {
   asm volatile("msr ICC_EOIR1_EL1, %0" :: "r"((uint64_t)iar));
   asm volatile("msr ICC_DIR_EL1, %0"   :: "r"((uint64_t)iar));
 }
+
+uint32_t gic_num_intids() {
+  return g_num_intids;
+}
+
+int gic_irq_set_priority(uint32_t intid, uint8_t prio) {
+  if (intid >= g_num_intids) return -1;
+  ((volatile uint8_t*)(gic_frame(intid) + kGicdIpriorityr))[intid] = prio;
+  return 0;
+}
+
+int gic_irq_config(uint32_t intid, uint8_t prio, int edge) {
+  if (gic_irq_set_priority(intid, prio) != 0) return -1;
+  const uint64_t frame = gic_frame(intid);
+
+  // SGIs are always edge-triggered; ICFGR has 2 bits per INTID (bit 1 = edge).
+  if (intid >= 16u) {
+    const uint64_t cfg = frame + kGicdIcfgr + (intid / 16u) * 4u;
+    const uint32_t bit = 2u << ((intid % 16u) * 2u);
+    uint32_t v = mmio_r32(cfg);
+    v = edge ? (v | bit) : (v & ~bit);
+    mmio_w32(cfg, v);
+  }
+  if (intid >= GIC_SPI_BASE) {
+    mmio_w64(GICD_BASE + kGicdIrouter + intid * 8u, mpidr_affinity());
+  }
+  return 0;
+}
+
+void gic_irq_enable(uint32_t intid) {
+  if (intid >= g_num_intids) return;
+  mmio_w32(gic_frame(intid) + kGicdIsenabler + (intid / 32u) * 4u, 1u << (intid % 32u));
+}
+
+void gic_irq_disable(uint32_t intid) {
+  if (intid >= g_num_intids) return;
+  mmio_w32(gic_frame(intid) + kGicdIcenabler + (intid / 32u) * 4u, 1u << (intid % 32u));
+  if (intid < GIC_SPI_BASE) {
+    gicr_wait_rwp();
+  } else {
+    gicd_wait_rwp();
+  }
+}
+
+void gic_send_sgi(uint32_t sgi, uint16_t targets) {
+  if (targets == 0) return;
+  uint64_t mpidr = 0;
+  asm volatile("mrs %0, mpidr_el1" : "=r"(mpidr));
+  const uint64_t aff1 = (mpidr >> 8) & 0xFFull;
+  const uint64_t aff2 = (mpidr >> 16) & 0xFFull;
+  const uint64_t aff3 = (mpidr >> 32) & 0xFFull;
+  // TargetList[15:0] selects Aff0 within the 16-CPU range RS[47:44] (0 here).
+  const uint64_t v = (uint64_t)targets | (aff1 << 16) | ((uint64_t)(sgi & 0xFu) << 24) |
+                     (aff2 << 32) | (aff3 << 48);
+  asm volatile("msr ICC_SGI1R_EL1, %0" :: "r"(v));
+  asm volatile("isb");
+}
+
+void gic_send_sgi_self(uint32_t sgi) {
+  uint64_t mpidr = 0;
+  asm volatile("mrs %0, mpidr_el1" : "=r"(mpidr));
+  const uint64_t aff0 = mpidr & 0xFFull;
+  const uint64_t aff1 = (mpidr >> 8) & 0xFFull;
+  const uint64_t aff2 = (mpidr >> 16) & 0xFFull;
+  const uint64_t aff3 = (mpidr >> 32) & 0xFFull;
+  // TargetList[15:0] selects Aff0 within the 16-CPU range RS[47:44].
+  const uint64_t v = (1ull << (aff0 & 0xFu)) | (aff1 << 16) | ((uint64_t)(sgi & 0xFu) << 24) |
+                     (aff2 << 32) | ((aff0 >> 4) << 44) | (aff3 << 48);
+  asm volatile("msr ICC_SGI1R_EL1, %0" :: "r"(v));
+  asm volatile("isb");
+}
@@ -73,6 +73,16 @@ inline uint64_t read_cntv_ctl() {
   return value;
 }
 
+inline uint64_t read_timer_cval() {
+  uint64_t value = 0;
+#if USE_CNTP
+  asm volatile("mrs %0, cntp_cval_el0" : "=r"(value));
+#else
+  asm volatile("mrs %0, cntv_cval_el0" : "=r"(value));
+#endif
+  return value;
+}
+
 inline void write_timer_tval(uint64_t value) {
 #if USE_CNTP
   write_cntp_tval(value);
@@ -101,6 +111,8 @@ inline uint64_t read_timer_ctl() {
 bool g_timer_diag_once = false;
 #endif
 
+uint64_t g_last_deadline = 0;
+
 uint64_t compute_ticks(uint32_t hz) {
   uint64_t freq = read_cntfrq();
   uint64_t ticks = (hz == 0) ? 0 : (freq / hz);
@@ -148,10 +160,19 @@ void timer_init_hz(uint32_t hz) {
   }
 }
 
+uint64_t timer_deadline() {
+  return read_timer_cval();
+}
+
+uint64_t timer_last_deadline() {
+  return g_last_deadline;
+}
+
 void timer_irq() {
   static unsigned heartbeat = 0;
 
   const uint64_t ticks = compute_ticks(1000u);
+  g_last_deadline = read_timer_cval();
   write_timer_tval(ticks);
 
   uart_putc('.');
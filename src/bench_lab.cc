@@ -0,0 +1,309 @@
+#include "bench_lab.h"
+
+#include <stdint.h>
+
+#include "arch/counter.h"
+#include "arch/cpu_local.h"
+#include "arch/irqflags.h"
+#include "arch/timer.h"
+#include "drivers/uart_pl011.h"
+#include "dma.h"
+#include "spinlock.h"
+#include "sync.h"
+#include "thread.h"
+
+#ifndef BENCH_THREADS
+#define BENCH_THREADS 4
+#endif
+#ifndef BENCH_LOOPS
+#define BENCH_LOOPS 500
+#endif
+#ifndef BENCH_INTERVAL_TICKS
+#define BENCH_INTERVAL_TICKS 2
+#endif
+#ifndef BENCH_HOGS
+#define BENCH_HOGS 2
+#endif
+#ifndef BENCH_LOCKERS
+#define BENCH_LOCKERS 2
+#endif
+#ifndef BENCH_DMA_THREADS
+#define BENCH_DMA_THREADS 1
+#endif
+// Histogram resolution; the last bucket also counts everything above it.
+#ifndef BENCH_BUCKET_US
+#define BENCH_BUCKET_US 10
+#endif
+
+namespace {
+constexpr unsigned kMaxThreads = 8;
+static_assert(BENCH_THREADS >= 1 && BENCH_THREADS <= kMaxThreads, "BENCH_THREADS must be 1..8");
+static_assert(BENCH_INTERVAL_TICKS >= 1, "BENCH_INTERVAL_TICKS must be at least one tick");
+
+constexpr uint32_t kTickHz = 1000;  // matches timer_init_hz() in kmain
+constexpr unsigned kBuckets = 100;
+
+// Measurement threads sit below ksoftirqd (28) and step down by two, so
+// thread 1 shares DMA_IRQ_THREAD_PRIO (24) with the DMA completion thread.
+constexpr int kReportPrio = 30;
+constexpr int kTopPrio = 26;
+constexpr int kPrioStep = 2;
+constexpr int kDmaPrio = 12;
+constexpr int kLoadPrio = 8;   // hogs and lockers round-robin at one level
+constexpr int kIdlePrio = 0;
+
+constexpr unsigned kHogSpin = 200000;
+constexpr unsigned kMutexHoldSpin = 50000;
+constexpr unsigned kSpinHoldSpin = 20000;  // IRQs masked for this long
+constexpr size_t kDmaLen = 8 * 1024;
+constexpr unsigned kDmaBatch = 4;
+
+struct bench_stats {
+  uint64_t samples;
+  uint64_t sum_ns;
+  uint64_t min_ns;
+  uint64_t max_ns;
+  uint64_t early;     // woke before the deadline tick was due (a bug)
+  uint32_t hist[kBuckets];
+};
+
+bench_stats g_stats[kMaxThreads];
+semaphore g_done;
+unsigned g_mode = 0;
+
+mutex g_lock;
+spinlock g_spin;
+
+semaphore g_dma_sem;
+uint8_t* g_dma_src = nullptr;
+uint8_t* g_dma_dst = nullptr;
+volatile uint64_t g_dma_copies = 0;
+volatile uint64_t g_dma_submit_failed = 0;
+unsigned g_dmas = 0;
+uint64_t g_start_tick = 0;
+
+static inline void spin(unsigned n) {
+  for (volatile unsigned i = 0; i < n; i++) {
+  }
+}
+
+static void bench_hang() {
+  while (1) {
+    asm volatile("wfe");
+  }
+}
+
+static void stats_add(bench_stats* s, uint64_t ns) {
+  if (s->samples == 0 || ns < s->min_ns) s->min_ns = ns;
+  if (ns > s->max_ns) s->max_ns = ns;
+  s->samples++;
+  s->sum_ns += ns;
+  uint64_t b = ns / (BENCH_BUCKET_US * 1000ull);
+  if (b >= kBuckets) b = kBuckets - 1;
+  s->hist[b]++;
+}
+
+// Upper edge of the bucket holding the 99th percentile, capped at the max.
+static uint64_t stats_p99(const bench_stats* s) {
+  const uint64_t want = s->samples - s->samples / 100u;
+  uint64_t seen = 0;
+  for (unsigned b = 0; b < kBuckets; ++b) {
+    seen += s->hist[b];
+    if (seen >= want) {
+      const uint64_t edge = (b + 1ull) * BENCH_BUCKET_US * 1000ull;
+      return edge < s->max_ns ? edge : s->max_ns;
+    }
+  }
+  return s->max_ns;
+}
+
+// Lateness of the current thread against absolute tick |deadline|. The tick
+// counter and the latched compare value move together in the tick handler,
+// so with IRQs masked the deadline tick's compare value is exactly
+// |tick_periods| periods before the latest one.
+static void bench_measure(bench_stats* s, uint64_t deadline, uint64_t period) {
+  auto* cpu = cpu_local();
+  unsigned long flags = local_irq_save();
+  const uint64_t now = arch_counter_read();
+  const uint64_t tick = cpu->ticks;
+  const uint64_t last = timer_last_deadline();
+  local_irq_restore(flags);
+
+  const uint64_t tick_periods = (tick > deadline) ? tick - deadline : 0;
+  const uint64_t due = last - tick_periods * period;
+  if (now < due) {
+    s->early++;
+    stats_add(s, 0);
+    return;
+  }
+  stats_add(s, arch_counter_to_ns(now - due));
+}
+
+static void bench_rt_thread(void* arg) {
+  const unsigned idx = static_cast<unsigned>(reinterpret_cast<uintptr_t>(arg));
+  const uint64_t interval = BENCH_INTERVAL_TICKS + idx;
+  const uint64_t period = arch_counter_freq() / kTickHz;
+  bench_stats* s = &g_stats[idx];
+
+  // Fixed grid like cyclictest: an overrun shows up as lateness on the next
+  // sample instead of shifting every later deadline.
+  uint64_t next = cpu_local()->ticks + interval;
+  for (unsigned n = 0; n < BENCH_LOOPS; ++n) {
+    thread_sleep_until(next);
+    bench_measure(s, next, period);
+    next += interval;
+  }
+  sem_up(&g_done);
+  while (1) {
+    thread_sleep_until(TIMEOUT_FOREVER);
+  }
+}
+
+static void bench_hog(void*) {
+  while (1) {
+    spin(kHogSpin);
+  }
+}
+
+static void bench_locker(void*) {
+  while (1) {
+    mutex_lock(&g_lock);
+    spin(kMutexHoldSpin);
+    mutex_unlock(&g_lock);
+
+    unsigned long flags = spin_lock_irqsave(&g_spin);
+    spin(kSpinHoldSpin);
+    spin_unlock_irqrestore(&g_spin, flags);
+  }
+}
+
+static void bench_dma_done(void*, int) {
+  g_dma_copies = g_dma_copies + 1;
+  sem_up(&g_dma_sem);
+}
+
+static void bench_dma(void*) {
+  while (1) {
+    unsigned queued = 0;
+    for (unsigned i = 0; i < kDmaBatch; ++i) {
+      if (dma_submit_memcpy(g_dma_dst, g_dma_src, kDmaLen, bench_dma_done, nullptr) == 0) {
+        ++queued;
+      } else {
+        g_dma_submit_failed = g_dma_submit_failed + 1;
+      }
+    }
+    for (unsigned i = 0; i < queued; ++i) {
+      sem_down(&g_dma_sem);
+    }
+    thread_sleep_until(cpu_local()->ticks + 1);
+  }
+}
+
+// Lowest priority: keeps sleeping measurement threads from idling inside
+// their own block loop.
+static void bench_idle(void*) {
+  while (1) {
+    asm volatile("wfi");
+  }
+}
+
+static void bench_report(void*) {
+  for (unsigned i = 0; i < BENCH_THREADS; ++i) {
+    sem_down(&g_done);
+  }
+
+  bool ok = true;
+  // Each DMA thread queues a batch per tick at most; a fraction of that
+  // means the load quietly stopped (e.g. descriptors ran out).
+  const uint64_t elapsed = cpu_local()->ticks - g_start_tick;
+  const uint64_t dma_expected = static_cast<uint64_t>(g_dmas) * kDmaBatch * elapsed / 4u;
+  uart_puts("[bench] done mode="); uart_print_u64(g_mode);
+  uart_puts(" threads="); uart_print_u64(BENCH_THREADS);
+  uart_puts(" loops="); uart_print_u64(BENCH_LOOPS);
+  uart_puts(" bucket_us="); uart_print_u64(BENCH_BUCKET_US);
+  uart_puts(" dma_copies="); uart_print_u64(g_dma_copies);
+  uart_puts(" dma_min="); uart_print_u64(dma_expected);
+  uart_puts(" dma_submit_failed="); uart_print_u64(g_dma_submit_failed);
+  uart_puts(" elapsed_ticks="); uart_print_u64(elapsed);
+  uart_puts("\n");
+  if (g_dma_submit_failed || g_dma_copies < dma_expected) {
+    ok = false;
+  }
+  for (unsigned i = 0; i < BENCH_THREADS; ++i) {
+    const bench_stats* s = &g_stats[i];
+    const uint64_t avg = s->samples ? s->sum_ns / s->samples : 0;
+    uart_puts("[bench] t="); uart_print_u64(i);
+    uart_puts(" prio="); uart_print_u64(static_cast<uint64_t>(kTopPrio - kPrioStep * static_cast<int>(i)));
+    uart_puts(" interval_ticks="); uart_print_u64(BENCH_INTERVAL_TICKS + i);
+    uart_puts(" n="); uart_print_u64(s->samples);
+    uart_puts(" min_ns="); uart_print_u64(s->min_ns);
+    uart_puts(" avg_ns="); uart_print_u64(avg);
+    uart_puts(" max_ns="); uart_print_u64(s->max_ns);
+    uart_puts(" p99_ns="); uart_print_u64(stats_p99(s));
+    uart_puts(" early="); uart_print_u64(s->early);
+    uart_puts("\n");
+    for (unsigned b = 0; b < kBuckets; ++b) {
+      if (!s->hist[b]) continue;
+      uart_puts("[bench] hist t="); uart_print_u64(i);
+      uart_puts(" us="); uart_print_u64(b * BENCH_BUCKET_US);
+      uart_puts(" n="); uart_print_u64(s->hist[b]);
+      uart_puts("\n");
+    }
+    if (s->samples != BENCH_LOOPS || s->early || s->min_ns > avg || avg > s->max_ns) {
+      ok = false;
+    }
+  }
+  uart_puts(ok ? "[bench] result PASS\n" : "[bench] result FAIL\n");
+  bench_hang();
+}
+
+static void bench_spawn(void (*fn)(void*), void* arg, int prio) {
+  Thread* t = thread_create_prio(fn, arg, 16 * 1024, prio);
+  if (!t) {
+    uart_puts("[bench] thread_create failed\n");
+    bench_hang();
+  }
+  sched_add(t);
+}
+}  // namespace
+
+extern "C" void bench_lab_setup(unsigned mode) {
+  if (mode < 1u || mode > 4u) {
+    uart_puts("[bench] unknown mode\n");
+    bench_hang();
+  }
+  g_mode = mode;
+  sem_init(&g_done, 0);
+  mutex_init(&g_lock);
+  spin_init(&g_spin);
+  sem_init(&g_dma_sem, 0);
+
+  unsigned hogs = 0, lockers = 0, dmas = 0;
+  if (mode >= 2u) hogs = BENCH_HOGS;
+  if (mode >= 3u) lockers = BENCH_LOCKERS;
+  if (mode >= 4u) dmas = BENCH_DMA_THREADS;
+  g_dmas = dmas;
+  if (dmas) {
+    g_dma_src = static_cast<uint8_t*>(dma_alloc_buffer(kDmaLen, 64));
+    g_dma_dst = static_cast<uint8_t*>(dma_alloc_buffer(kDmaLen, 64));
+    if (!g_dma_src || !g_dma_dst) {
+      uart_puts("[bench] dma buffer allocation failed\n");
+      bench_hang();
+    }
+  }
+  uart_puts("[bench] setup hogs="); uart_print_u64(hogs);
+  uart_puts(" lockers="); uart_print_u64(lockers);
+  uart_puts(" dma="); uart_print_u64(dmas);
+  uart_puts("\n");
+
+  g_start_tick = cpu_local()->ticks;
+  bench_spawn(bench_report, nullptr, kReportPrio);
+  for (unsigned i = 0; i < BENCH_THREADS; ++i) {
+    bench_spawn(bench_rt_thread, reinterpret_cast<void*>(static_cast<uintptr_t>(i)),
+                kTopPrio - kPrioStep * static_cast<int>(i));
+  }
+  for (unsigned i = 0; i < dmas; ++i) bench_spawn(bench_dma, nullptr, kDmaPrio);
+  for (unsigned i = 0; i < lockers; ++i) bench_spawn(bench_locker, nullptr, kLoadPrio);
+  for (unsigned i = 0; i < hogs; ++i) bench_spawn(bench_hog, nullptr, kLoadPrio);
+  bench_spawn(bench_idle, nullptr, kIdlePrio);
+}
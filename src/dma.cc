@@ -3,14 +3,21 @@
 #include <stddef.h>
 #include <stdint.h>
 #include "arch/barrier.h"
+#include "arch/gicv3.h"
 #include "arch/irqflags.h"
 #include "drivers/uart_pl011.h"
+#include "irq.h"
 
 extern "C" char __dma_nc_start[];
 extern "C" char __dma_nc_end[];
 
+#ifndef DMA_IRQ_THREAD_PRIO
+#define DMA_IRQ_THREAD_PRIO 24
+#endif
+
 namespace {
 constexpr char kHexDigits[] = "0123456789abcdef";
+volatile int g_dma_doorbell = 0;
 static void puthex64(uint64_t v){
   if (!v){ uart_putc('0'); return; }
   char b[16]; int i=0; while(v && i<16){ b[i++]=kHexDigits[v&0xF]; v>>=4; }
@@ -132,16 +139,39 @@ static void dma_memcpy(void* dst, const void* src, size_t len){
   for(size_t i=0;i<len;i++){ d[i]=s[i]; }
 }
 
+// Completed descriptors are recycled through g_desc_free (linked by ->next),
+// so a steady submit/complete stream never exhausts the window; the bump
+// pointer only moves when every descriptor handed out is still in flight.
+static dma_desc* g_desc_free = nullptr;
+
 static dma_desc* dma_alloc_desc(void){
+  unsigned long flags=local_irq_save();
+  dma_desc* desc=g_desc_free;
+  if (desc){
+    g_desc_free=desc->next;
+    local_irq_restore(flags);
+    return desc;
+  }
   uintptr_t raw=(uintptr_t)g_dma_desc_next;
   constexpr uintptr_t align=alignof(dma_desc);
   raw=(raw+align-1u)&~(align-1u);
   char* aligned=(char*)raw;
-  if (aligned + sizeof(dma_desc) > g_dma_buf_end){ return nullptr; }
+  if (aligned + sizeof(dma_desc) > g_dma_buf_end){
+    local_irq_restore(flags);
+    return nullptr;
+  }
   g_dma_desc_next = aligned + sizeof(dma_desc);
+  local_irq_restore(flags);
   return (dma_desc*)aligned;
 }
 
+static void dma_free_desc(dma_desc* desc){
+  unsigned long flags=local_irq_save();
+  desc->next=g_desc_free;
+  g_desc_free=desc;
+  local_irq_restore(flags);
+}
+
 extern "C" void* dma_alloc_buffer(size_t len, size_t align) {
   if (len == 0) return nullptr;
   if (align == 0) align = 1;
@@ -183,6 +213,9 @@ extern "C" int dma_submit_memcpy(void* dst, const void* src, size_t len, dma_cb_
   if (prev_tail) {
     dma_prepare_to_device(prev_tail, sizeof(*prev_tail));
   }
+  if (g_dma_doorbell) {
+    gic_send_sgi_self(DMA_DOORBELL_SGI);
+  }
 
   uart_puts("[DMA] queued desc=0x"); puthex64((uint64_t)(uintptr_t)desc);
   uart_puts(" next=0x"); puthex64((uint64_t)(uintptr_t)desc->next);
@@ -194,11 +227,17 @@ extern "C" int dma_submit_memcpy(void* dst, const void* src, size_t len, dma_cb_
 }
 
 extern "C" void dma_poll_complete(void){
-  while (g_pending_head){
+  for (;;){
+    // Runs in the DMA IRQ thread: only the unlink needs IRQs masked.
+    unsigned long flags=local_irq_save();
     dma_desc* desc=g_pending_head;
-    g_pending_head=desc->next;
-    if (!g_pending_head){ g_pending_tail=nullptr; }
-    desc->next=nullptr;
+    if (desc){
+      g_pending_head=desc->next;
+      if (!g_pending_head){ g_pending_tail=nullptr; }
+      desc->next=nullptr;
+    }
+    local_irq_restore(flags);
+    if (!desc){ break; }
 
     void* dst=(void*)(uintptr_t)desc->dst;
     const void* src=(const void*)(uintptr_t)desc->src;
@@ -233,5 +272,24 @@ extern "C" void dma_poll_complete(void){
 
     uart_puts("[DMA] done\n");
     if (desc->cb){ desc->cb(desc->user, 0); }
+    dma_free_desc(desc);
+  }
+}
+
+namespace {
+static void dma_irq_thread(uint32_t, void*){
+  dma_poll_complete();
+}
+}  // namespace
+
+extern "C" int dma_irq_init(void){
+  if (irq_register_threaded(DMA_DOORBELL_SGI, nullptr, dma_irq_thread, nullptr,
+                            IRQF_TRIGGER_EDGE | IRQF_PRIO(IRQ_PRIO_BULK), DMA_IRQ_THREAD_PRIO) != 0){
+    uart_puts("[DMA] doorbell registration failed\n");
+    return -1;
   }
+  g_dma_doorbell=1;
+  // Anything queued before the doorbell existed.
+  if (g_pending_head){ gic_send_sgi_self(DMA_DOORBELL_SGI); }
+  return 0;
 }
@@ -0,0 +1,159 @@
+#include "event.h"
+
+#include "arch/cpu_local.h"
+#include "arch/irqflags.h"
+#include "mailbox.h"
+#include "preempt.h"
+#include "waitq.h"
+
+namespace {
+static inline uint64_t event_deadline(uint64_t timeout) {
+  if (timeout == TIMEOUT_FOREVER) return TIMEOUT_FOREVER;
+  auto* cpu = cpu_local();
+  return (cpu ? cpu->ticks : 0) + timeout;
+}
+
+static bool event_may_block(uint64_t timeout, uint64_t deadline) {
+  auto* cpu = cpu_local();
+  if (timeout == TIMEOUT_NO_WAIT || !cpu || !cpu->current_thread || cpu->irq_depth) {
+    return false;
+  }
+  return deadline == TIMEOUT_FOREVER || cpu->ticks < deadline;
+}
+
+static event_poller** source_pollers(const event_source* src) {
+  if (src->type == EVENT_SRC_NOTIFY) {
+    return &static_cast<notification*>(src->obj)->pollers;
+  }
+  return &static_cast<mailbox*>(src->obj)->pollers;
+}
+
+static bool source_ready(const event_source* src) {
+  if (src->type == EVENT_SRC_NOTIFY) {
+    const auto* n = static_cast<const notification*>(src->obj);
+    return (__atomic_load_n(&n->bits, __ATOMIC_SEQ_CST) & src->mask) != 0;
+  }
+  return mbox_count(static_cast<const mailbox*>(src->obj)) != 0;
+}
+
+static void poller_unlink(event_poller** head, event_poller* p) {
+  for (event_poller** link = head; *link; link = &(*link)->next) {
+    if (*link == p) {
+      *link = p->next;
+      return;
+    }
+  }
+}
+}  // namespace
+
+extern "C" void event_pollers_wake(event_poller** head, uint64_t bits) {
+  if (!head) return;
+  for (event_poller* p = *head; p; p = p->next) {
+    if ((p->mask & bits) != 0) {
+      waitq_wake(p->thread);
+    }
+  }
+}
+
+extern "C" void notify_init(notification* n) {
+  if (!n) return;
+  n->bits = 0;
+  n->pollers = nullptr;
+}
+
+extern "C" void notify_signal(notification* n, uint64_t bits) {
+  if (!n || bits == 0) return;
+  __atomic_fetch_or(&n->bits, bits, __ATOMIC_SEQ_CST);
+  // Waiters scan |bits| and link their pollers in one IRQ-masked,
+  // non-preemptible section, so on this single-CPU kernel an empty poller
+  // list here means nobody missed this OR.
+  if (!__atomic_load_n(&n->pollers, __ATOMIC_SEQ_CST)) return;
+
+  preempt_disable();
+  unsigned long flags = local_irq_save();
+  event_pollers_wake(&n->pollers, bits);
+  local_irq_restore(flags);
+  preempt_enable();
+}
+
+extern "C" uint64_t notify_take(notification* n, uint64_t mask) {
+  if (!n) return 0;
+  return __atomic_fetch_and(&n->bits, ~mask, __ATOMIC_SEQ_CST) & mask;
+}
+
+extern "C" uint64_t notify_peek(const notification* n) {
+  return n ? __atomic_load_n(&n->bits, __ATOMIC_SEQ_CST) : 0;
+}
+
+extern "C" uint64_t notify_wait(notification* n, uint64_t mask, uint64_t timeout_ticks) {
+  if (!n || mask == 0) return 0;
+  const uint64_t deadline = event_deadline(timeout_ticks);
+  const event_source src = {EVENT_SRC_NOTIFY, n, mask};
+  for (;;) {
+    const uint64_t got = notify_take(n, mask);
+    if (got) return got;
+    uint64_t left = TIMEOUT_FOREVER;
+    if (deadline != TIMEOUT_FOREVER) {
+      auto* cpu = cpu_local();
+      const uint64_t now = cpu ? cpu->ticks : deadline;
+      left = (now < deadline) ? deadline - now : TIMEOUT_NO_WAIT;
+    }
+    if (event_wait_any(&src, 1, left) < 0) {
+      return notify_take(n, mask);
+    }
+  }
+}
+
+extern "C" int event_wait_any(const event_source* srcs, unsigned n, uint64_t timeout_ticks) {
+  if (!srcs || n == 0 || n > EVENT_WAIT_MAX) return -1;
+  for (unsigned i = 0; i < n; ++i) {
+    if (!srcs[i].obj || (srcs[i].type != EVENT_SRC_NOTIFY && srcs[i].type != EVENT_SRC_MBOX)) {
+      return -1;
+    }
+  }
+  const uint64_t deadline = event_deadline(timeout_ticks);
+  event_poller pollers[EVENT_WAIT_MAX];
+
+  preempt_disable();
+  unsigned long flags = local_irq_save();
+  int ready = -1;
+  for (;;) {
+    for (unsigned i = 0; i < n; ++i) {
+      if (source_ready(&srcs[i])) {
+        ready = static_cast<int>(i);
+        break;
+      }
+    }
+    if (ready >= 0 || !event_may_block(timeout_ticks, deadline)) break;
+
+    // Nothing can become ready between the scan above and the linking
+    // below: IRQs are masked and preemption is off, and there is no other
+    // CPU to signal. Any source, or the timeout, makes us runnable again;
+    // then unlink and rescan.
+    auto* cpu = cpu_local();
+    Thread* cur = cpu->current_thread;
+    for (unsigned i = 0; i < n; ++i) {
+      event_poller** head = source_pollers(&srcs[i]);
+      pollers[i].thread = cur;
+      pollers[i].mask = (srcs[i].type == EVENT_SRC_NOTIFY) ? srcs[i].mask : ~0ull;
+      pollers[i].next = *head;
+      *head = &pollers[i];
+    }
+    if (deadline != TIMEOUT_FOREVER) {
+      sched_timeout_arm(cur, deadline, nullptr);
+    }
+    sched_block_current();
+    cpu->need_resched = 1;
+    local_irq_restore(flags);
+    preempt_enable();
+    preempt_disable();
+    flags = local_irq_save();
+
+    for (unsigned i = 0; i < n; ++i) {
+      poller_unlink(source_pollers(&srcs[i]), &pollers[i]);
+    }
+  }
+  local_irq_restore(flags);
+  preempt_enable();
+  return ready;
+}
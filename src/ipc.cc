@@ -0,0 +1,138 @@
+#include "ipc.h"
+
+#include "arch/cpu_local.h"
+#include "preempt.h"
+#include "sync.h"
+#include "waitq.h"
+
+namespace {
+static inline void ipc_copy(ipc_msg* dst, const ipc_msg* src) {
+  if (!dst || !src) return;
+  for (unsigned i = 0; i < IPC_MSG_WORDS; ++i) {
+    dst->mr[i] = src->mr[i];
+  }
+}
+
+// The busy server runs at the highest priority among its current client and
+// the callers queued behind it, so a high-priority caller stuck in the queue
+// is not starved by a medium-priority thread preempting a low-priority
+// request. The donation is one more input to thread_recompute_priority(),
+// next to PI waiters, so mutex unlocks while serving keep it.
+static void ipc_update_donation(ipc_endpoint* ep, Thread* server) {
+  int prio = waitq_max_priority(ep->callers);
+  Thread* client = server->ipc_partner;
+  if (client) {
+    const int p = thread_effective_priority(client);
+    if (p > prio) prio = p;
+  }
+  server->ipc_donated_prio = prio;
+  thread_recompute_priority(server);
+}
+
+// The server also takes over the client's time slice.
+static void ipc_donate(ipc_endpoint* ep, Thread* client, Thread* server) {
+  server->ipc_saved_budget = server->budget;
+  server->ipc_partner = client;
+  ipc_update_donation(ep, server);
+  server->budget = client->budget;
+}
+
+// Undo ipc_donate() once the client has been answered (ipc_partner cleared):
+// the server keeps only what the queued callers donate. Returns what is left
+// of the donated slice so it can be handed back to the client.
+static int ipc_undonate(ipc_endpoint* ep, Thread* server) {
+  const int left = server->budget > 0 ? server->budget : 1;
+  server->budget = server->ipc_saved_budget;
+  ipc_update_donation(ep, server);
+  return left;
+}
+}  // namespace
+
+extern "C" void ipc_endpoint_init(ipc_endpoint* ep) {
+  if (!ep) return;
+  ep->server = nullptr;
+  ep->busy = nullptr;
+  ep->callers = nullptr;
+}
+
+extern "C" int ipc_call(ipc_endpoint* ep, ipc_msg* msg) {
+  if (!ep || !msg) return -1;
+  preempt_disable();
+  auto* cpu = cpu_local();
+  Thread* cur = cpu ? cpu->current_thread : nullptr;
+  if (!cur) {
+    preempt_enable();
+    return -1;
+  }
+
+  cur->ipc_buf = msg;
+  cur->waiting_on = nullptr;
+  sched_block_current();
+
+  Thread* srv = ep->server;
+  if (srv) {
+    // Fast path: server is waiting; deliver and switch to it directly.
+    ep->server = nullptr;
+    ep->busy = srv;
+    ipc_copy(static_cast<ipc_msg*>(srv->ipc_buf), msg);
+    srv->ipc_buf = nullptr;
+    sched_handoff(srv);
+    ipc_donate(ep, cur, srv);
+  } else {
+    // Server busy: queue; it picks the message up from our ipc_buf. Our
+    // priority reaches the server right away, not when it dequeues us.
+    waitq_append(&ep->callers, cur);
+    if (ep->busy) ipc_update_donation(ep, ep->busy);
+    cpu->need_resched = 1;
+  }
+
+  // Switches away here; returns once the reply has been copied into |msg|.
+  preempt_enable();
+  return 0;
+}
+
+extern "C" int ipc_reply_wait(ipc_endpoint* ep, const ipc_msg* reply, ipc_msg* recv) {
+  if (!ep || !recv) return -1;
+  preempt_disable();
+  auto* cpu = cpu_local();
+  Thread* cur = cpu ? cpu->current_thread : nullptr;
+  if (!cur) {
+    preempt_enable();
+    return -1;
+  }
+
+  Thread* client = cur->ipc_partner;
+  cur->ipc_partner = nullptr;
+  int left = 0;
+  if (client) {
+    ipc_copy(static_cast<ipc_msg*>(client->ipc_buf), reply);
+    client->ipc_buf = nullptr;
+    left = ipc_undonate(ep, cur);
+  }
+
+  Thread* next = waitq_pop_highest(&ep->callers);
+  if (next) {
+    // More requests queued: release the client and keep serving.
+    if (client) {
+      waitq_wake(client);
+      client->budget = left;
+    }
+    ipc_copy(recv, static_cast<const ipc_msg*>(next->ipc_buf));
+    ipc_donate(ep, next, cur);
+    preempt_enable();
+    return 0;
+  }
+
+  cur->ipc_buf = recv;
+  ep->server = cur;
+  ep->busy = nullptr;
+  sched_block_current();
+  if (client) {
+    sched_handoff(client);
+    client->budget = left;
+  } else {
+    cpu->need_resched = 1;
+  }
+  preempt_enable();
+  return 0;
+}
@@ -0,0 +1,483 @@
+#include "ipc_lab.h"
+
+#include <stdint.h>
+
+#include "arch/counter.h"
+#include "arch/cpu_local.h"
+#include "drivers/uart_pl011.h"
+#include "event.h"
+#include "ipc.h"
+#include "mailbox.h"
+#include "sync.h"
+#include "thread.h"
+
+namespace {
+constexpr unsigned kWarmup = 16;
+constexpr unsigned kIters = 1000;
+
+ipc_endpoint g_ep;
+semaphore g_req;
+semaphore g_rsp;
+volatile uint64_t g_sem_val = 0;
+
+// Mailbox lab state (1 driver / 3 readers).
+constexpr unsigned kMboxDepth = 4;
+constexpr unsigned kMboxReaders = 3;
+constexpr uint64_t kMboxTimeoutTicks = 10;
+
+struct mbox_item {
+  uint32_t seq;
+  uint32_t tag;
+};
+
+mailbox g_mb;
+uint8_t g_mb_storage[MBOX_STORAGE_BYTES(sizeof(mbox_item), kMboxDepth)];
+semaphore g_mb_done;
+volatile unsigned g_mb_blocked = 0;
+volatile uint32_t g_mb_seen_mask = 0;
+
+// Wait-for-multiple lab state (1 server multiplexing a notification and a
+// mailbox; 1 lower-priority producer).
+constexpr uint64_t kEvWatched = 0x3u;
+constexpr uint64_t kEvUnwatched = 1ull << 5;
+
+notification g_ev_note;
+semaphore g_ev_go;
+
+// Queued-caller donation lab state: a low- and a high-priority client share
+// one slow server while a medium-priority hog competes for the CPU.
+constexpr int kDonDriverPrio = 25;
+constexpr int kDonHighPrio = 20;
+constexpr int kDonHogPrio = 15;
+constexpr int kDonLowPrio = 10;
+constexpr int kDonServerPrio = 5;
+constexpr uint64_t kDonServeTicks = 20;
+constexpr uint64_t kDonHogTicks = 100;
+
+semaphore g_don_low_go;
+semaphore g_don_high_go;
+semaphore g_don_hog_go;
+semaphore g_don_done;
+volatile int g_don_served_prio[2] = {-1, -1};
+volatile unsigned g_don_served = 0;
+volatile uint64_t g_don_high_tick = 0;
+volatile uint64_t g_don_hog_tick = 0;
+
+struct rt_stats {
+  uint64_t min;
+  uint64_t max;
+  uint64_t sum;
+};
+
+static void stats_reset(rt_stats* s) {
+  s->min = ~0ull;
+  s->max = 0;
+  s->sum = 0;
+}
+
+static void stats_add(rt_stats* s, uint64_t v) {
+  if (v < s->min) s->min = v;
+  if (v > s->max) s->max = v;
+  s->sum += v;
+}
+
+static void stats_print(const char* name, const rt_stats* s, uint64_t counter_ticks) {
+  uart_puts("[ipc-lab] "); uart_puts(name);
+  uart_puts(" round-trip cycles avg="); uart_print_u64(s->sum / kIters);
+  uart_puts(" min="); uart_print_u64(s->min);
+  uart_puts(" max="); uart_print_u64(s->max);
+  uart_puts(" avg_ns="); uart_print_u64(arch_counter_to_ns(counter_ticks) / kIters);
+  uart_puts("\n");
+}
+
+// Echo server: replies with mr[0] + 1 and the remaining words unchanged.
+static void ipc_server(void*) {
+  ipc_msg m;
+  (void)ipc_reply_wait(&g_ep, nullptr, &m);
+  while (1) {
+    m.mr[0] += 1u;
+    (void)ipc_reply_wait(&g_ep, &m, &m);
+  }
+}
+
+// Baseline: the same exchange built from two semaphores (wake + runqueue pick
+// on each side, no donation).
+static void sem_server(void*) {
+  while (1) {
+    sem_down(&g_req);
+    g_sem_val = g_sem_val + 1u;
+    sem_up(&g_rsp);
+  }
+}
+
+static void ipc_client(void*) {
+  arch_cycles_enable();
+  bool ok = true;
+
+  ipc_msg m;
+  for (unsigned i = 0; i < kWarmup; ++i) {
+    m.mr[0] = i;
+    (void)ipc_call(&g_ep, &m);
+  }
+
+  rt_stats ipc;
+  stats_reset(&ipc);
+  uint64_t c0 = arch_counter_read();
+  for (unsigned i = 0; i < kIters; ++i) {
+    m.mr[0] = i;
+    m.mr[1] = 0xC0FFEEull;
+    m.mr[3] = ~static_cast<uint64_t>(i);
+    const uint64_t t0 = arch_cycles_read();
+    if (ipc_call(&g_ep, &m) != 0) ok = false;
+    stats_add(&ipc, arch_cycles_read() - t0);
+    if (m.mr[0] != i + 1u || m.mr[1] != 0xC0FFEEull || m.mr[3] != ~static_cast<uint64_t>(i)) {
+      ok = false;
+    }
+  }
+  const uint64_t ipc_ticks = arch_counter_read() - c0;
+
+  rt_stats sem;
+  stats_reset(&sem);
+  c0 = arch_counter_read();
+  for (unsigned i = 0; i < kIters; ++i) {
+    const uint64_t before = g_sem_val;
+    const uint64_t t0 = arch_cycles_read();
+    sem_up(&g_req);
+    sem_down(&g_rsp);
+    stats_add(&sem, arch_cycles_read() - t0);
+    if (g_sem_val != before + 1u) ok = false;
+  }
+  const uint64_t sem_ticks = arch_counter_read() - c0;
+
+  stats_print("ipc_call", &ipc, ipc_ticks);
+  stats_print("sem_pingpong", &sem, sem_ticks);
+  uart_puts(ok ? "[ipc-lab] result PASS\n" : "[ipc-lab] result FAIL\n");
+
+  while (1) {
+    asm volatile("wfe");
+  }
+}
+
+static uint64_t now_ticks() {
+  auto* cpu = cpu_local();
+  return cpu ? cpu->ticks : 0;
+}
+
+static void mbox_reader(void*) {
+  mbox_item m;
+  g_mb_blocked = g_mb_blocked + 1u;
+  if (mbox_recv(&g_mb, &m, nullptr) == 0) {
+    g_mb_seen_mask = g_mb_seen_mask | (1u << (m.seq & 31u));
+  }
+  sem_up(&g_mb_done);
+  while (1) {
+    asm volatile("wfe");
+  }
+}
+
+static void mbox_driver(void*) {
+  bool ok = true;
+  mbox_item m;
+  unsigned lane = 0;
+
+  // 1) Priority lanes: an urgent message overtakes queued normal ones.
+  for (uint32_t i = 0; i < 3; ++i) {
+    m.seq = i;
+    m.tag = 0;
+    if (mbox_trysend(&g_mb, &m, MBOX_LANE_NORMAL) != 0) ok = false;
+  }
+  m.seq = 100;
+  m.tag = 1;
+  if (mbox_trysend(&g_mb, &m, MBOX_LANE_URGENT) != 0) ok = false;
+  const uint32_t expect[4] = {100, 0, 1, 2};
+  for (unsigned i = 0; i < 4; ++i) {
+    if (mbox_tryrecv(&g_mb, &m, &lane) != 0 || m.seq != expect[i]) ok = false;
+    if (lane != (i == 0 ? MBOX_LANE_URGENT : MBOX_LANE_NORMAL)) ok = false;
+  }
+  uart_puts(ok ? "[ipc-lab] mbox lanes ok\n" : "[ipc-lab] mbox lanes BAD\n");
+
+  // 2) Timed receive on an empty mailbox. Sleeping here also lets the
+  //    lower-priority readers run and block in mbox_recv().
+  uint64_t t0 = now_ticks();
+  const int rc = mbox_recv_timeout(&g_mb, &m, nullptr, kMboxTimeoutTicks);
+  uint64_t waited = now_ticks() - t0;
+  uart_puts("[ipc-lab] mbox recv timed out waited_ticks="); uart_print_u64(waited); uart_puts("\n");
+  if (rc != -1 || waited < kMboxTimeoutTicks) ok = false;
+
+  // 3) Multi-reader wakeup: all readers are blocked; each posted message
+  //    releases exactly one of them.
+  if (g_mb_blocked != kMboxReaders) ok = false;
+  for (uint32_t i = 0; i < kMboxReaders; ++i) {
+    m.seq = i;
+    if (mbox_trysend(&g_mb, &m, MBOX_LANE_NORMAL) != 0) ok = false;
+  }
+  for (unsigned i = 0; i < kMboxReaders; ++i) {
+    sem_down(&g_mb_done);
+  }
+  uart_puts("[ipc-lab] mbox readers woken="); uart_print_u64(__builtin_popcount(g_mb_seen_mask)); uart_puts("\n");
+  if (g_mb_seen_mask != (1u << kMboxReaders) - 1u || mbox_count(&g_mb) != 0) ok = false;
+
+  // 4) Full lane (no readers left): trysend fails, timed send times out.
+  for (uint32_t i = 0; i < kMboxDepth; ++i) {
+    m.seq = i;
+    if (mbox_trysend(&g_mb, &m, MBOX_LANE_NORMAL) != 0) ok = false;
+  }
+  if (mbox_trysend(&g_mb, &m, MBOX_LANE_NORMAL) == 0) ok = false;
+  t0 = now_ticks();
+  if (mbox_send_timeout(&g_mb, &m, MBOX_LANE_NORMAL, kMboxTimeoutTicks) == 0) ok = false;
+  waited = now_ticks() - t0;
+  if (waited < kMboxTimeoutTicks) ok = false;
+  uart_puts("[ipc-lab] mbox full send timed out waited_ticks="); uart_print_u64(waited); uart_puts("\n");
+
+  uart_puts(ok ? "[ipc-lab] result PASS\n" : "[ipc-lab] result FAIL\n");
+  while (1) {
+    asm volatile("wfe");
+  }
+}
+// Every signal/post preempts us straight back into the server, except the
+// unwatched bit, which must not wake it.
+static void ev_producer(void*) {
+  sem_down(&g_ev_go);
+  mbox_item m = {0, 0};
+  notify_signal(&g_ev_note, kEvUnwatched);
+  notify_signal(&g_ev_note, 1u << 0);
+  m.seq = 1;
+  (void)mbox_trysend(&g_mb, &m, MBOX_LANE_NORMAL);
+  notify_signal(&g_ev_note, 1u << 1);
+  m.seq = 2;
+  (void)mbox_trysend(&g_mb, &m, MBOX_LANE_NORMAL);
+  while (1) {
+    asm volatile("wfe");
+  }
+}
+
+static void ev_server(void*) {
+  bool ok = true;
+  const event_source srcs[2] = {
+      {EVENT_SRC_NOTIFY, &g_ev_note, kEvWatched},
+      {EVENT_SRC_MBOX, &g_mb, 0},
+  };
+
+  const uint64_t t0 = now_ticks();
+  if (event_wait_any(srcs, 2, kMboxTimeoutTicks) != -1) ok = false;
+  const uint64_t waited = now_ticks() - t0;
+  uart_puts("[ipc-lab] event wait timed out waited_ticks="); uart_print_u64(waited); uart_puts("\n");
+  if (waited < kMboxTimeoutTicks) ok = false;
+
+  sem_up(&g_ev_go);
+  uint64_t bits = 0;
+  unsigned msgs = 0;
+  unsigned wakeups = 0;
+  while (bits != kEvWatched || msgs != 2u) {
+    const int idx = event_wait_any(srcs, 2, 100);
+    if (idx < 0) {
+      ok = false;
+      break;
+    }
+    wakeups++;
+    if (idx == 0) {
+      bits |= notify_take(&g_ev_note, kEvWatched);
+    } else {
+      mbox_item m;
+      while (mbox_tryrecv(&g_mb, &m, nullptr) == 0) msgs++;
+    }
+  }
+
+  uart_puts("[ipc-lab] event served bits="); uart_print_u64(bits);
+  uart_puts(" msgs="); uart_print_u64(msgs);
+  uart_puts(" wakeups="); uart_print_u64(wakeups); uart_puts("\n");
+  if (wakeups != 4u || notify_peek(&g_ev_note) != kEvUnwatched) ok = false;
+  if (notify_wait(&g_ev_note, kEvUnwatched, TIMEOUT_NO_WAIT) != kEvUnwatched) ok = false;
+
+  uart_puts(ok ? "[ipc-lab] result PASS\n" : "[ipc-lab] result FAIL\n");
+  while (1) {
+    asm volatile("wfe");
+  }
+}
+
+// Busy for |n| ticks without blocking.
+static void spin_ticks(uint64_t n) {
+  auto* cpu = cpu_local();
+  const volatile unsigned long* ticks = &cpu->ticks;
+  const uint64_t end = *ticks + n;
+  while (*ticks < end) {
+  }
+}
+
+// Records the priority it ends each request at: the first request is the low
+// client's, so anything above kDonLowPrio came from the queued high client.
+static void don_server(void*) {
+  ipc_msg m;
+  (void)ipc_reply_wait(&g_ep, nullptr, &m);
+  while (1) {
+    spin_ticks(kDonServeTicks);
+    const unsigned n = g_don_served;
+    if (n < 2u) g_don_served_prio[n] = thread_effective_priority(cpu_local()->current_thread);
+    g_don_served = n + 1u;
+    m.mr[0] += 1u;
+    (void)ipc_reply_wait(&g_ep, &m, &m);
+  }
+}
+
+static void don_low(void*) {
+  sem_down(&g_don_low_go);
+  ipc_msg m = {{1, 0, 0, 0}};
+  (void)ipc_call(&g_ep, &m);
+  thread_exit();
+}
+
+static void don_high(void*) {
+  sem_down(&g_don_high_go);
+  ipc_msg m = {{2, 0, 0, 0}};
+  (void)ipc_call(&g_ep, &m);
+  g_don_high_tick = now_ticks();
+  sem_up(&g_don_done);
+  thread_exit();
+}
+
+static void don_hog(void*) {
+  sem_down(&g_don_hog_go);
+  spin_ticks(kDonHogTicks);
+  g_don_hog_tick = now_ticks();
+  sem_up(&g_don_done);
+  thread_exit();
+}
+
+// Gets the server into ipc_reply_wait() and busy with the low client's
+// request, then releases the high client (which queues) and the hog. Without
+// donation from the queue the server stays at the low priority, the hog
+// starves it, and the high client waits out the whole hog.
+static void don_driver(void*) {
+  bool ok = true;
+  thread_sleep_until(now_ticks() + 2);
+  if (!g_ep.server) ok = false;
+  sem_up(&g_don_low_go);
+  thread_sleep_until(now_ticks() + 2);
+  if (!g_ep.busy || g_don_served != 0u) ok = false;
+
+  const uint64_t t0 = now_ticks();
+  sem_up(&g_don_high_go);
+  sem_up(&g_don_hog_go);
+  sem_down(&g_don_done);
+  sem_down(&g_don_done);
+
+  uart_puts("[ipc-lab] queued donation served_prio=");
+  uart_print_u64(static_cast<uint64_t>(g_don_served_prio[0]));
+  uart_puts(",");
+  uart_print_u64(static_cast<uint64_t>(g_don_served_prio[1]));
+  uart_puts(" high_ticks="); uart_print_u64(g_don_high_tick - t0);
+  uart_puts(" hog_ticks="); uart_print_u64(g_don_hog_tick - t0);
+  uart_puts("\n");
+  if (g_don_served_prio[0] != kDonHighPrio || g_don_served_prio[1] != kDonHighPrio) ok = false;
+  if (g_don_high_tick >= g_don_hog_tick) ok = false;
+
+  uart_puts(ok ? "[ipc-lab] result PASS\n" : "[ipc-lab] result FAIL\n");
+  while (1) {
+    asm volatile("wfe");
+  }
+}
+}  // namespace
+
+extern "C" void ipc_lab_setup(unsigned mode) {
+  if (mode == 4u) {
+    uart_puts("[ipc-lab] queued donation setup\n");
+    ipc_endpoint_init(&g_ep);
+    sem_init(&g_don_low_go, 0);
+    sem_init(&g_don_high_go, 0);
+    sem_init(&g_don_hog_go, 0);
+    sem_init(&g_don_done, 0);
+
+    struct {
+      void (*fn)(void*);
+      int prio;
+    } const threads[] = {
+        {don_driver, kDonDriverPrio}, {don_high, kDonHighPrio}, {don_hog, kDonHogPrio},
+        {don_low, kDonLowPrio},       {don_server, kDonServerPrio},
+    };
+    for (const auto& t : threads) {
+      Thread* th = thread_create_prio(t.fn, nullptr, 16 * 1024, t.prio);
+      if (!th) {
+        uart_puts("[ipc-lab] thread_create failed\n");
+        while (1) {
+          asm volatile("wfe");
+        }
+      }
+      sched_add(th);
+    }
+    return;
+  }
+
+  if (mode == 3u) {
+    uart_puts("[ipc-lab] event setup\n");
+    (void)mbox_init(&g_mb, g_mb_storage, sizeof(mbox_item), kMboxDepth);
+    notify_init(&g_ev_note);
+    sem_init(&g_ev_go, 0);
+
+    Thread* s = thread_create_prio(ev_server, nullptr, 16 * 1024, /*prio=*/20);
+    Thread* p = thread_create_prio(ev_producer, nullptr, 16 * 1024, /*prio=*/10);
+    if (!s || !p) {
+      uart_puts("[ipc-lab] thread_create failed\n");
+      while (1) {
+        asm volatile("wfe");
+      }
+    }
+    sched_add(s);
+    sched_add(p);
+    return;
+  }
+
+  if (mode == 2u) {
+    uart_puts("[ipc-lab] mailbox setup\n");
+    (void)mbox_init(&g_mb, g_mb_storage, sizeof(mbox_item), kMboxDepth);
+    sem_init(&g_mb_done, 0);
+    g_mb_blocked = 0;
+    g_mb_seen_mask = 0;
+
+    Thread* d = thread_create_prio(mbox_driver, nullptr, 16 * 1024, /*prio=*/20);
+    if (!d) {
+      uart_puts("[ipc-lab] thread_create failed\n");
+      while (1) {
+        asm volatile("wfe");
+      }
+    }
+    sched_add(d);
+    for (unsigned i = 0; i < kMboxReaders; ++i) {
+      Thread* r = thread_create_prio(mbox_reader, nullptr, 16 * 1024, /*prio=*/15);
+      if (!r) {
+        uart_puts("[ipc-lab] thread_create failed\n");
+        while (1) {
+          asm volatile("wfe");
+        }
+      }
+      sched_add(r);
+    }
+    return;
+  }
+
+  if (mode != 1u) {
+    uart_puts("[ipc-lab] unknown mode\n");
+    return;
+  }
+
+  uart_puts("[ipc-lab] setup\n");
+  ipc_endpoint_init(&g_ep);
+  sem_init(&g_req, 0);
+  sem_init(&g_rsp, 0);
+  g_sem_val = 0;
+
+  // Servers run below the client so every reply must come back through
+  // donation/handoff (ipc) or a priority wake (semaphores).
+  Thread* c = thread_create_prio(ipc_client, nullptr, 16 * 1024, /*prio=*/20);
+  Thread* s = thread_create_prio(ipc_server, nullptr, 16 * 1024, /*prio=*/10);
+  Thread* e = thread_create_prio(sem_server, nullptr, 16 * 1024, /*prio=*/10);
+  if (!c || !s || !e) {
+    uart_puts("[ipc-lab] thread_create failed\n");
+    while (1) {
+      asm volatile("wfe");
+    }
+  }
+
+  sched_add(c);
+  sched_add(s);
+  sched_add(e);
+}
@@ -1,38 +1,276 @@
 #include <stdint.h>
 #include "drivers/uart_pl011.h"
+#include "arch/counter.h"
 #include "arch/cpu_local.h"
 #include "arch/gicv3.h"
 #include "arch/irq.h"
+#include "arch/irqflags.h"
 #include "arch/timer.h"
-#include "preempt.h"
+#include "irq.h"
+#include "irq_latency.h"
+#include "softirq.h"
+#include "static_pool.h"
+#include "sync.h"
 #include "thread.h"
-#include "dma.h"
 
 #ifndef LOCK_LAB_MODE
 #define LOCK_LAB_MODE 0
 #endif
+#ifndef USE_CNTP
+#define USE_CNTP 0
+#endif
 
 #if LOCK_LAB_MODE
 #include "lock_lab.h"
 #endif
 
+static_assert(IRQ_PRIO_NMI < GIC_PMR_IRQOFF && IRQ_PRIO_HIGH >= GIC_PMR_IRQOFF,
+              "only IRQF_NMI may pass the PMR IRQ-off mask");
+
 namespace {
 unsigned g_irq_diag_count = 0;
 unsigned g_irq_entry_budget = 8;
 unsigned g_irq_timer_budget = 8;
+
+struct irq_desc {
+  irq_handler_t handler;
+  void*         ctx;
+  uint64_t      count;
+  uint32_t      flags;
+};
+
+irq_desc g_irq_table[IRQ_NR];
+uint64_t g_irq_spurious = 0;
+unsigned g_irq_max_depth = 0;
+
+constexpr uint32_t kTimerIntid = USE_CNTP ? 30u : 27u;
+
+constexpr size_t kIrqThreadStack = 8 * 1024;
+
+struct irq_thread {
+  irq_hard_handler_t hard;
+  irq_thread_fn_t    fn;
+  void*              ctx;
+  uint32_t           intid;
+  uint32_t           flags;
+  volatile uint32_t  pending;   // set by the top half, cleared by the thread
+  semaphore          wake;
+  uint64_t           runs;
+};
+
+// Threaded handlers are registered by drivers at boot and never torn down.
+constexpr size_t kMaxIrqThreads = 16;
+StaticPool<irq_thread, kMaxIrqThreads> g_irq_threads;
+
+static void irq_thread_top(uint32_t intid, void* p) {
+  auto* it = static_cast<irq_thread*>(p);
+  const irq_return r = it->hard ? it->hard(intid, it->ctx) : IRQ_WAKE_THREAD;
+  if (r != IRQ_WAKE_THREAD) return;
+  if (it->flags & IRQF_ONESHOT) {
+    gic_irq_disable(intid);
+  }
+  if (!it->pending) {
+    it->pending = 1;
+    sem_up(&it->wake);
+  }
+}
+
+static void irq_thread_main(void* p) {
+  auto* it = static_cast<irq_thread*>(p);
+  while (1) {
+    sem_down(&it->wake);
+    it->pending = 0;
+    it->fn(it->intid, it->ctx);
+    it->runs++;
+    if (it->flags & IRQF_ONESHOT) {
+      gic_irq_enable(it->intid);
+    }
+  }
+}
+
+static void timer_tick_handler(uint32_t intid, void*) {
+  auto* cpu = cpu_local();
+  if (g_irq_timer_budget != 0) {
+    uart_putc(intid == 30u ? 'P' : ':');
+    --g_irq_timer_budget;
+  }
+  timer_irq();
+  cpu->ticks++;
+#if LOCK_LAB_MODE
+  lock_lab_irq_tick();
+#endif
+  sched_on_tick();
+}
+}  // namespace
+
+extern "C" int irq_register(uint32_t intid, irq_handler_t handler, void* ctx, uint32_t flags) {
+  if (intid >= IRQ_NR || intid >= gic_num_intids() || !handler) return -1;
+  unsigned long irqf = local_irq_save();
+  irq_desc* d = &g_irq_table[intid];
+  if (d->handler) {
+    local_irq_restore(irqf);
+    return -1;
+  }
+  if (flags & IRQF_NMI) {
+    flags = (flags & ~IRQF_PRIO_MASK) | IRQF_PRIO(IRQ_PRIO_NMI) | IRQF_NO_NEST;
+  }
+  const uint32_t prio = (flags & IRQF_PRIO_MASK) ? ((flags & IRQF_PRIO_MASK) >> 8) : GIC_PRIO_DEFAULT;
+  if (gic_irq_config(intid, static_cast<uint8_t>(prio), (flags & IRQF_TRIGGER_EDGE) != 0) != 0) {
+    local_irq_restore(irqf);
+    return -1;
+  }
+  d->ctx = ctx;
+  d->flags = flags;
+  d->handler = handler;
+  if (!(flags & IRQF_NO_ENABLE)) {
+    gic_irq_enable(intid);
+  }
+  local_irq_restore(irqf);
+  return 0;
+}
+
+extern "C" int irq_register_threaded(uint32_t intid, irq_hard_handler_t hard, irq_thread_fn_t thread_fn,
+                                     void* ctx, uint32_t flags, int prio) {
+  if (!thread_fn || intid >= IRQ_NR || intid >= gic_num_intids() || g_irq_table[intid].handler) {
+    return -1;
+  }
+  irq_thread* it = g_irq_threads.alloc();
+  if (!it) return -1;
+  it->hard = hard;
+  it->fn = thread_fn;
+  it->ctx = ctx;
+  it->intid = intid;
+  it->flags = flags;
+  it->pending = 0;
+  it->runs = 0;
+  sem_init(&it->wake, 0);
+
+  // Own the INTID before starting the thread; it stays masked until the
+  // thread exists, so every failure below unwinds completely.
+  if (irq_register(intid, irq_thread_top, it, flags | IRQF_NO_ENABLE) != 0) {
+    g_irq_threads.free(it);
+    return -1;
+  }
+  Thread* t = thread_create_prio(irq_thread_main, it, kIrqThreadStack, prio);
+  if (!t) {
+    irq_unregister(intid);
+    g_irq_threads.free(it);
+    return -1;
+  }
+  sched_add(t);
+  if (!(flags & IRQF_NO_ENABLE)) {
+    irq_enable(intid);
+  }
+  return 0;
+}
+
+extern "C" int irq_unregister(uint32_t intid) {
+  if (intid >= IRQ_NR) return -1;
+  gic_irq_disable(intid);
+  unsigned long irqf = local_irq_save();
+  g_irq_table[intid].handler = nullptr;
+  g_irq_table[intid].ctx = nullptr;
+  g_irq_table[intid].flags = 0;
+  local_irq_restore(irqf);
+  return 0;
+}
+
+extern "C" void irq_enable(uint32_t intid) {
+  if (intid < IRQ_NR) gic_irq_enable(intid);
+}
+
+extern "C" void irq_disable(uint32_t intid) {
+  if (intid < IRQ_NR) gic_irq_disable(intid);
+}
+
+extern "C" int irq_set_priority(uint32_t intid, uint8_t prio) {
+  if (intid >= IRQ_NR) return -1;
+  unsigned long irqf = local_irq_save();
+  irq_desc* d = &g_irq_table[intid];
+  if (!d->handler || (d->flags & IRQF_NMI) || gic_irq_set_priority(intid, prio) != 0) {
+    local_irq_restore(irqf);
+    return -1;
+  }
+  d->flags = (d->flags & ~IRQF_PRIO_MASK) | IRQF_PRIO(prio);
+  local_irq_restore(irqf);
+  return 0;
+}
+
+extern "C" uint64_t irq_count(uint32_t intid) {
+  return (intid < IRQ_NR) ? g_irq_table[intid].count : 0;
+}
+
+extern "C" void irq_dump_stats(void) {
+  uart_puts("[irq] stats spurious="); uart_print_u64(g_irq_spurious);
+  uart_puts(" max_depth="); uart_print_u64(g_irq_max_depth); uart_puts("\n");
+  for (uint32_t i = 0; i < IRQ_NR; ++i) {
+    if (g_irq_table[i].count == 0) continue;
+    uart_puts("[irq]   intid="); uart_print_u64(i);
+    uart_puts(" count="); uart_print_u64(g_irq_table[i].count);
+    uart_puts(" prio="); uart_print_u64((g_irq_table[i].flags & IRQF_PRIO_MASK) >> 8);
+    uart_puts(g_irq_table[i].handler ? "\n" : " (unhandled)\n");
+  }
+  static_pool_stats ps;
+  g_irq_threads.stats(&ps);
+  if (ps.allocs) static_pool_print("irq_thread", &ps);
+}
+
+extern "C" void irq_init(void) {
+  // The tick updates scheduler state that is not IRQ-safe, so it never nests;
+  // its priority still lets it preempt bulk completions.
+  const uint32_t flags = IRQF_TRIGGER_LEVEL | IRQF_NO_NEST | IRQF_PRIO(IRQ_PRIO_TIMER);
+  if (irq_register(kTimerIntid, timer_tick_handler, nullptr, flags) != 0) {
+    uart_puts("[irq] timer registration failed\n");
+  }
 }
 
 extern "C" void irq_handler_el1(struct irq_frame* frame) {
+  auto* cpu = cpu_local();
+  (void)frame;  // only the PMR and tracer paths look at the interrupted state
+#if IRQ_LATENCY_TRACE
+  // Read before the diagnostics below, and before a nested IRQ can overwrite it.
+  const uint64_t lat_entry = cpu->irq_entry_cnt;
+#endif
   if (g_irq_entry_budget != 0) {
     uart_putc('!');
     --g_irq_entry_budget;
   }
 
-  auto* cpu = cpu_local();
   cpu->irq_depth++;
+  if (cpu->irq_depth > g_irq_max_depth) {
+    g_irq_max_depth = cpu->irq_depth;
+  }
+#if IRQ_PMR_MASKING
+  frame->pmr = arch_irq_pmr_read();
+#endif
 
   uint32_t iar = gic_ack();
   uint32_t intid = iar & 0x3FFu;
+#if IRQ_LATENCY_TRACE
+  const uint64_t lat_acked = arch_counter_read();
+  const uint64_t lat_cval = (intid == kTimerIntid) ? timer_deadline() : 0;
+#endif
+
+  if (intid >= IRQ_NR) {  // 1020..1023: spurious / special
+    ++g_irq_spurious;
+    cpu->irq_depth--;
+    return;
+  }
+
+  irq_desc* d = &g_irq_table[intid];
+  if (d->flags & IRQF_NMI) {
+    // May have hit an IRQ-off section: stay masked, no diagnostics, no
+    // softirqs, no preemption.
+    d->count++;
+    d->handler(intid, d->ctx);
+    gic_eoi(iar);
+    cpu->irq_depth--;
+    return;
+  }
+#if IRQSOFF_TRACE
+  // The exception masked IRQs at the interrupted instruction.
+  trace_irqs_off(frame->elr);
+#endif
 
   if (g_irq_diag_count < 8u) {
     uart_puts("[irq] intid=");
@@ -41,54 +279,73 @@ extern "C" void irq_handler_el1(struct irq_frame* frame) {
     ++g_irq_diag_count;
   }
 
-  switch (intid) {
-    case 27u:  // virtual timer
-      if (g_irq_timer_budget != 0) {
-        uart_putc(':');
-        --g_irq_timer_budget;
-      }
-      timer_irq();
-      cpu->ticks++;
-#if LOCK_LAB_MODE
-      lock_lab_irq_tick();
+#if IRQ_PMR_MASKING
+  // Normal IRQs only arrive with PMR open. Mask them through PMR and clear
+  // DAIF.I so pseudo-NMIs can reach the rest of this handler.
+  local_irq_disable();
+  asm volatile("msr daifclr, #2" ::: "memory");
 #endif
-      sched_on_tick();
-      dma_poll_complete();
-      if (cpu->current_thread && cpu->preempt_cnt == 0 && cpu->need_resched) {
-        frame->elr = reinterpret_cast<uint64_t>(&preempt_return);
-      }
-      break;
-    case 30u:  // physical timer
-      if (g_irq_timer_budget != 0) {
-        uart_putc('P');
-        --g_irq_timer_budget;
-      }
-      timer_irq();
-      cpu->ticks++;
-#if LOCK_LAB_MODE
-      lock_lab_irq_tick();
+
+  d->count++;
+  if (d->handler) {
+    // After the ack the CPU interface runs at this INTID's priority, so
+    // unmasking only lets strictly more urgent interrupts in.
+    const bool nest = IRQ_NESTING && !(d->flags & IRQF_NO_NEST);
+    if (nest) local_irq_enable();
+    d->handler(intid, d->ctx);
+    if (nest) local_irq_disable();
+  } else if (intid < 16u) {
+    uart_putc('^');
+  } else {
+    uart_puts("[irq] unexpected intid\n");
+  }
+#if IRQ_LATENCY_TRACE
+  const uint64_t lat_handled = arch_counter_read();
 #endif
-      sched_on_tick();
-      dma_poll_complete();
-      if (cpu->current_thread && cpu->preempt_cnt == 0 && cpu->need_resched) {
-        frame->elr = reinterpret_cast<uint64_t>(&preempt_return);
-      }
-      break;
-    case 1023u:  // spurious
-      cpu->irq_depth--;
-      return;
-    default:
-      if (intid < 16u) {
-        uart_putc('^');
-      } else {
-        uart_puts("[irq] unexpected intid\n");
-      }
-      break;
-  }
-
-  if (intid != 1023u) {
-    gic_eoi(iar);
+
+  gic_eoi(iar);
+
+  // Softirqs only on the outermost exit; a nested exit returns to the handler
+  // it interrupted. Preemption follows in irq_exit_schedule().
+  if (cpu->irq_depth == 1u) {
+    softirq_irq_exit();
   }
 
+#if IRQ_LATENCY_TRACE
+  irq_latency_record(lat_entry, lat_cval, lat_acked, lat_handled);
+#endif
+#if IRQSOFF_TRACE
+  // eret unmasks; the PMR restore below then finds the section closed.
+  trace_irqs_on(irqflags_ip());
+#endif
+#if IRQ_PMR_MASKING
+  asm volatile("msr daifset, #2" ::: "memory");
+  local_irq_restore(frame->pmr);
+#endif
   cpu->irq_depth--;
 }
+
+extern "C" void irq_exit_schedule(void) {
+  auto* cpu = cpu_local();
+  // Any handler (or softirq) may have woken a higher-priority thread.
+  if (!cpu->current_thread || cpu->preempt_cnt || !cpu->need_resched) return;
+#if IRQ_PMR_MASKING
+  // Threads keep DAIF.I clear, so mask through PMR like any thread-context
+  // section; the thread switched to restores its own PMR.
+  const unsigned long pmr = local_irq_save();
+  asm volatile("msr daifclr, #2" ::: "memory");
+#elif IRQSOFF_TRACE
+  trace_irqs_off(irqflags_ip());
+#endif
+  // We come back here once this thread is picked again; a wakeup in between
+  // may have asked for another switch.
+  while (cpu->preempt_cnt == 0 && cpu->need_resched) {
+    sched_resched_from_irq_tail();
+  }
+#if IRQ_PMR_MASKING
+  asm volatile("msr daifset, #2" ::: "memory");
+  local_irq_restore(pmr);
+#elif IRQSOFF_TRACE
+  trace_irqs_on(irqflags_ip());
+#endif
+}
@@ -0,0 +1,711 @@
+#include "irq_lab.h"
+
+#include <stdint.h>
+
+#include "arch/counter.h"
+#include "arch/cpu_local.h"
+#include "arch/gicv3.h"
+#include "arch/irqflags.h"
+#include "drivers/uart_pl011.h"
+#include "irq.h"
+#include "irq_latency.h"
+#include "mailbox.h"
+#include "mem_pool_lf.h"
+#include "ringbuf.h"
+#include "smp.h"
+#include "softirq.h"
+#include "sync.h"
+#include "thread.h"
+#include "tlb.h"
+#include "workqueue.h"
+
+namespace {
+constexpr uint32_t kLabSgi = 3u;
+// One raise from the SGI plus this many self re-raises; more than
+// SOFTIRQ_MAX_RESTART so the IRQ exit has to hand off to ksoftirqd.
+constexpr unsigned kRearms = 50;
+constexpr uint64_t kWorkSleepTicks = 5;
+
+volatile unsigned g_rearm = 0;
+volatile unsigned g_runs_irq = 0;
+volatile unsigned g_runs_thread = 0;
+semaphore g_softirq_done;
+
+work_struct g_work;
+int g_queue_rc[2];
+volatile unsigned g_work_ran = 0;
+volatile unsigned g_work_in_thread = 0;
+volatile uint64_t g_work_slept = 0;
+semaphore g_work_done;
+
+mailbox g_sleep_mb;
+uint8_t g_sleep_storage[MBOX_STORAGE_BYTES(sizeof(uint32_t), 1)];
+
+// Nesting lab: a bulk-priority handler raises a high-priority and an
+// equal-priority SGI and spins; only the first may run inside it.
+constexpr uint32_t kNestLowSgi = 4u;
+constexpr uint32_t kNestHighSgi = 5u;
+constexpr uint32_t kNestPeerSgi = 6u;
+constexpr unsigned kNestSpin = 200000;
+
+volatile unsigned g_low_active = 0;
+volatile unsigned g_high_depth = 0;
+volatile unsigned g_high_inside_low = 0;
+volatile unsigned g_peer_depth = 0;
+volatile unsigned g_peer_inside_low = 0;
+semaphore g_nest_done;
+
+// Pseudo-NMI lab: inside local_irq_save() only the IRQF_NMI SGI may land.
+constexpr uint32_t kNmiSgi = 7u;
+constexpr uint32_t kMaskedSgi = 8u;
+constexpr unsigned kNmiSpin = 1000000;
+constexpr unsigned kIrqsaveIters = 1000;
+
+volatile unsigned g_nmi_hits = 0;
+volatile unsigned g_masked_hits = 0;
+
+// IPI lab (single CPU): calls are queued to ourselves through the IPI path.
+constexpr unsigned kIpiCalls = 4;
+
+call_single_data g_ipi_csd[kIpiCalls];
+volatile unsigned g_ipi_order[kIpiCalls];
+volatile unsigned g_ipi_ran = 0;
+volatile unsigned g_ipi_in_irq = 0;
+volatile unsigned g_local_call_masked = 0;
+
+// Lock-free pool lab: a thread and an SGI handler share one mem_pool_lf with
+// no masking. The handler pops a burst and pushes it back in another order,
+// so a thread pop it interrupts sees the same head index with a new next.
+constexpr uint32_t kLfSgi = 9u;
+constexpr unsigned kLfBlocks = 32;
+constexpr unsigned kLfBurst = 4;
+constexpr unsigned kLfIters = 20000;
+
+mem_pool_lf g_lf_pool;
+alignas(16) uint8_t g_lf_storage[kLfBlocks * 64];
+uint8_t g_lf_owner[kLfBlocks];   // 1 while a context holds the block
+volatile unsigned g_lf_dups = 0;
+volatile unsigned g_lf_irq_allocs = 0;
+volatile unsigned g_lf_irqs = 0;
+
+// Ring lab: an SGI handler feeds sequence numbers into a BlockingRing over an
+// SpscRing (alternating push and push_bulk) for a higher-priority consumer
+// thread; then producer and consumer threads share an MpmcRing in batches.
+constexpr uint32_t kRingSgi = 10u;
+constexpr unsigned kRingSgis = 500;
+constexpr unsigned kRingBurst = 4;
+constexpr unsigned kRingItems = kRingSgis * kRingBurst;
+constexpr unsigned kMpmcThreads = 2;       // producers, and as many consumers
+constexpr unsigned kMpmcPerProducer = 2000;
+constexpr unsigned kMpmcBatch = 8;
+
+BlockingRing<SpscRing<uint32_t, 64>> g_seq_ring;
+volatile uint32_t g_seq_next = 0;          // next value the handler pushes
+volatile unsigned g_seq_drops = 0;
+volatile unsigned g_seq_popped = 0;
+volatile unsigned g_seq_gaps = 0;
+semaphore g_seq_done;
+
+MpmcRing<uint32_t, 64> g_mp_ring;
+volatile unsigned g_mp_popped = 0;
+uint64_t g_mp_sum = 0;                     // updated atomically by consumers
+semaphore g_mp_done;
+
+// Latency lab: let the tick run for a while, then dump the histograms.
+constexpr uint64_t kLatWarmupTicks = 50;
+constexpr uint64_t kLatRunTicks = 2000;
+
+static void lab_hi_softirq(void) {
+  auto* cpu = cpu_local();
+  if (cpu->irq_depth) {
+    g_runs_irq++;
+  } else {
+    g_runs_thread++;
+  }
+  if (g_rearm) {
+    g_rearm--;
+    raise_softirq(SOFTIRQ_HI);
+  } else {
+    sem_up(&g_softirq_done);
+  }
+}
+
+// Runs on a system_wq worker: block on an empty mailbox until the timeout.
+static void lab_work_fn(work_struct*) {
+  auto* cpu = cpu_local();
+  g_work_in_thread = (cpu->irq_depth == 0 && cpu->current_thread) ? 1u : 0u;
+  const uint64_t t0 = cpu->ticks;
+  uint32_t msg = 0;
+  if (mbox_recv_timeout(&g_sleep_mb, &msg, nullptr, kWorkSleepTicks) != 0) {
+    g_work_slept = cpu->ticks - t0;
+  }
+  g_work_ran++;
+  sem_up(&g_work_done);
+}
+
+static void lab_sgi_handler(uint32_t, void*) {
+  raise_softirq(SOFTIRQ_HI);
+  g_queue_rc[0] = schedule_work(&g_work);
+  g_queue_rc[1] = schedule_work(&g_work);  // still pending: must not queue twice
+}
+
+static void nest_low_handler(uint32_t, void*) {
+  g_low_active = 1;
+  gic_send_sgi_self(kNestPeerSgi);
+  gic_send_sgi_self(kNestHighSgi);
+  for (volatile unsigned i = 0; i < kNestSpin && !g_high_depth; ++i) {
+  }
+  g_low_active = 0;
+}
+
+static void nest_high_handler(uint32_t, void*) {
+  g_high_depth = cpu_local()->irq_depth;
+  g_high_inside_low = g_low_active;
+}
+
+static void nest_peer_handler(uint32_t, void*) {
+  g_peer_depth = cpu_local()->irq_depth;
+  g_peer_inside_low = g_low_active;
+  sem_up(&g_nest_done);
+}
+
+static void irq_lab_nest_driver(void*) {
+  if (irq_register(kNestLowSgi, nest_low_handler, nullptr, IRQF_TRIGGER_EDGE | IRQF_PRIO(IRQ_PRIO_BULK)) != 0 ||
+      irq_register(kNestHighSgi, nest_high_handler, nullptr, IRQF_TRIGGER_EDGE | IRQF_PRIO(IRQ_PRIO_HIGH)) != 0 ||
+      irq_register(kNestPeerSgi, nest_peer_handler, nullptr, IRQF_TRIGGER_EDGE | IRQF_PRIO(IRQ_PRIO_BULK)) != 0) {
+    uart_puts("[irq-lab] irq_register failed\n");
+    uart_puts("[irq-lab] result FAIL\n");
+    while (1) {
+      asm volatile("wfe");
+    }
+  }
+  gic_send_sgi_self(kNestLowSgi);
+  sem_down(&g_nest_done);
+
+  uart_puts("[irq-lab] nest high depth="); uart_print_u64(g_high_depth);
+  uart_puts(" inside_low="); uart_print_u64(g_high_inside_low);
+  uart_puts(" peer depth="); uart_print_u64(g_peer_depth);
+  uart_puts(" inside_low="); uart_print_u64(g_peer_inside_low);
+  uart_puts("\n");
+  irq_dump_stats();
+  const bool ok = g_high_inside_low && g_high_depth == 2u && !g_peer_inside_low && g_peer_depth == 1u;
+  uart_puts(ok ? "[irq-lab] result PASS\n" : "[irq-lab] result FAIL\n");
+  while (1) {
+    sem_down(&g_nest_done);
+  }
+}
+
+static void lab_nmi_handler(uint32_t, void*) {
+  g_nmi_hits++;
+}
+
+static void lab_masked_handler(uint32_t, void*) {
+  g_masked_hits++;
+}
+
+static void irq_lab_nmi_driver(void*) {
+  if (!IRQ_PMR_MASKING) {
+    uart_puts("[irq-lab] requires IRQ_PMR_MASKING=1\n");
+    uart_puts("[irq-lab] result FAIL\n");
+    while (1) {
+      asm volatile("wfe");
+    }
+  }
+  if (irq_register(kNmiSgi, lab_nmi_handler, nullptr, IRQF_TRIGGER_EDGE | IRQF_NMI) != 0 ||
+      irq_register(kMaskedSgi, lab_masked_handler, nullptr, IRQF_TRIGGER_EDGE | IRQF_PRIO(IRQ_PRIO_HIGH)) != 0) {
+    uart_puts("[irq-lab] irq_register failed\n");
+    uart_puts("[irq-lab] result FAIL\n");
+    while (1) {
+      asm volatile("wfe");
+    }
+  }
+
+  unsigned long flags = local_irq_save();
+  gic_send_sgi_self(kMaskedSgi);
+  gic_send_sgi_self(kNmiSgi);
+  for (volatile unsigned i = 0; i < kNmiSpin && !g_nmi_hits; ++i) {
+  }
+  const unsigned nmi_inside = g_nmi_hits;
+  const unsigned masked_inside = g_masked_hits;
+  local_irq_restore(flags);
+  for (volatile unsigned i = 0; i < kNmiSpin && !g_masked_hits; ++i) {
+  }
+  uart_puts("[irq-lab] irqsave nmi="); uart_print_u64(nmi_inside);
+  uart_puts(" masked="); uart_print_u64(masked_inside);
+  uart_puts(" after_restore masked="); uart_print_u64(g_masked_hits);
+  uart_puts("\n");
+
+  // Cost of one save/restore pair in the configured masking mode.
+  arch_cycles_enable();
+  const uint64_t t0 = arch_cycles_read();
+  for (unsigned i = 0; i < kIrqsaveIters; ++i) {
+    unsigned long f = local_irq_save();
+    local_irq_restore(f);
+  }
+  const uint64_t cycles = arch_cycles_read() - t0;
+  uart_puts("[irq-lab] irqsave+restore avg cycles="); uart_print_u64(cycles / kIrqsaveIters);
+  uart_puts("\n");
+
+  const bool ok = nmi_inside == 1u && masked_inside == 0u && g_masked_hits == 1u;
+  uart_puts(ok ? "[irq-lab] result PASS\n" : "[irq-lab] result FAIL\n");
+  while (1) {
+    asm volatile("wfe");
+  }
+}
+
+static void ipi_lab_call(void* info) {
+  const unsigned idx = static_cast<unsigned>(reinterpret_cast<uintptr_t>(info));
+  if (g_ipi_ran < kIpiCalls) g_ipi_order[g_ipi_ran] = idx;
+  g_ipi_ran++;
+  if (cpu_local()->irq_depth) g_ipi_in_irq++;
+}
+
+static void ipi_lab_local_call(void*) {
+  const unsigned long outer = local_irq_save();
+  const unsigned long inner = local_irq_save();
+  g_local_call_masked = (outer == inner) ? 1u : 0u;  // already masked by the caller
+  local_irq_restore(outer);
+}
+
+static void irq_lab_ipi_driver(void*) {
+  const unsigned self = smp_processor_id();
+
+  // Local target: runs synchronously with IRQs masked.
+  (void)smp_call_function_single(self, ipi_lab_local_call, nullptr, /*wait=*/1);
+
+  // Burst of queued calls: one SGI, FIFO execution in IRQ context.
+  const uint64_t ipis0 = smp_ipi_count(IPI_SGI_CALL_FUNC);
+  unsigned long flags = local_irq_save();
+  for (unsigned i = 0; i < kIpiCalls; ++i) {
+    g_ipi_csd[i].func = ipi_lab_call;
+    g_ipi_csd[i].info = reinterpret_cast<void*>(static_cast<uintptr_t>(i));
+    g_ipi_csd[i].flags = 0;
+    (void)smp_call_function_single_async(self, &g_ipi_csd[i]);
+  }
+  const int busy = smp_call_function_single_async(self, &g_ipi_csd[0]);  // still queued
+  local_irq_restore(flags);
+  for (volatile unsigned spin = 0; spin < kNmiSpin && g_ipi_ran < kIpiCalls; ++spin) {
+  }
+  const uint64_t call_ipis = smp_ipi_count(IPI_SGI_CALL_FUNC) - ipis0;
+  bool fifo = true;
+  for (unsigned i = 0; i < kIpiCalls; ++i) {
+    if (g_ipi_order[i] != i) fifo = false;
+  }
+
+  const uint64_t resched0 = smp_ipi_count(IPI_SGI_RESCHEDULE);
+  smp_send_reschedule(self);
+  for (volatile unsigned spin = 0; spin < kNmiSpin && smp_ipi_count(IPI_SGI_RESCHEDULE) == resched0; ++spin) {
+  }
+  const uint64_t resched_ipis = smp_ipi_count(IPI_SGI_RESCHEDULE) - resched0;
+
+  // TLB batches: a few pages, then an overflowing one.
+  tlb_batch b;
+  tlb_batch_init(&b);
+  for (unsigned i = 0; i < 3; ++i) {
+    tlb_batch_add(&b, reinterpret_cast<uintptr_t>(&g_ipi_csd[0]) + i * 4096u);
+  }
+  tlb_batch_flush(&b);
+  for (unsigned i = 0; i < TLB_BATCH_MAX + 1u; ++i) {
+    tlb_batch_add(&b, reinterpret_cast<uintptr_t>(&g_ipi_csd[0]) + i * 4096u);
+  }
+  tlb_batch_flush(&b);
+  tlb_stats ts;
+  tlb_get_stats(&ts);
+
+  uart_puts("[irq-lab] ipi calls ran="); uart_print_u64(g_ipi_ran);
+  uart_puts(" in_irq="); uart_print_u64(g_ipi_in_irq);
+  uart_puts(" sgis="); uart_print_u64(call_ipis);
+  uart_puts(fifo ? " fifo=1" : " fifo=0");
+  uart_puts(" busy_rc="); uart_print_u64(busy == -1 ? 1u : 0u);
+  uart_puts(" local_masked="); uart_print_u64(g_local_call_masked);
+  uart_puts("\n");
+  uart_puts("[irq-lab] ipi resched="); uart_print_u64(resched_ipis);
+  uart_puts(" tlb batches="); uart_print_u64(ts.batches);
+  uart_puts(" pages="); uart_print_u64(ts.pages);
+  uart_puts(" full="); uart_print_u64(ts.full);
+  uart_puts(" remote_ipis="); uart_print_u64(ts.ipis);
+  uart_puts("\n");
+
+  const bool ok = g_ipi_ran == kIpiCalls && g_ipi_in_irq == kIpiCalls && call_ipis == 1u && fifo &&
+                  busy == -1 && g_local_call_masked && resched_ipis == 1u && ts.batches == 2u &&
+                  ts.pages == 3u && ts.full == 1u;
+  uart_puts(ok ? "[irq-lab] result PASS\n" : "[irq-lab] result FAIL\n");
+  while (1) {
+    asm volatile("wfe");
+  }
+}
+
+static void* lf_take() {
+  void* p = mem_pool_lf_alloc(&g_lf_pool);
+  if (p) {
+    const size_t i = static_cast<size_t>(static_cast<uint8_t*>(p) - g_lf_pool.base) / g_lf_pool.block_size;
+    if (__atomic_exchange_n(&g_lf_owner[i], 1u, __ATOMIC_RELAXED)) g_lf_dups++;
+  }
+  return p;
+}
+
+static void lf_give(void* p) {
+  const size_t i = static_cast<size_t>(static_cast<uint8_t*>(p) - g_lf_pool.base) / g_lf_pool.block_size;
+  __atomic_store_n(&g_lf_owner[i], 0u, __ATOMIC_RELAXED);
+  if (mem_pool_lf_free(&g_lf_pool, p) != 0) g_lf_dups++;
+}
+
+static void lab_lf_handler(uint32_t, void*) {
+  g_lf_irqs++;
+  void* got[kLfBurst] = {};
+  unsigned n = 0;
+  while (n < kLfBurst && (got[n] = lf_take()) != nullptr) n++;
+  g_lf_irq_allocs += n;
+  // Oldest first: the block that was on top ends up back on top.
+  for (unsigned i = 0; i < n; ++i) lf_give(got[i]);
+}
+
+static void irq_lab_lf_driver(void*) {
+  if (irq_register(kLfSgi, lab_lf_handler, nullptr, IRQF_TRIGGER_EDGE) != 0) {
+    uart_puts("[irq-lab] irq_register failed\n");
+    uart_puts("[irq-lab] result FAIL\n");
+    while (1) {
+      asm volatile("wfe");
+    }
+  }
+  // IRQs stay enabled throughout; the SGI lands a varying distance into the
+  // next alloc/free pair.
+  unsigned thread_allocs = 0;
+  const uint64_t t0 = arch_counter_read();
+  for (unsigned it = 0; it < kLfIters; ++it) {
+    if ((it & 3u) == 0) gic_send_sgi_self(kLfSgi);
+    for (volatile unsigned d = 0; d < (it % 7u); ++d) {
+    }
+    void* a = lf_take();
+    void* b = lf_take();
+    if (a) thread_allocs++;
+    if (b) thread_allocs++;
+    if (a) lf_give(a);
+    if (b) lf_give(b);
+  }
+  const uint64_t ns = arch_counter_to_ns(arch_counter_read() - t0);
+
+  uart_puts("[irq-lab] lockfree pool thread_allocs="); uart_print_u64(thread_allocs);
+  uart_puts(" irqs="); uart_print_u64(g_lf_irqs);
+  uart_puts(" irq_allocs="); uart_print_u64(g_lf_irq_allocs);
+  uart_puts(" cas_retries="); uart_print_u64(__atomic_load_n(&g_lf_pool.cas_retries, __ATOMIC_RELAXED));
+  uart_puts(" ns/pair="); uart_print_u64(ns / kLfIters);
+  uart_puts("\n");
+  uart_puts("[irq-lab] lockfree pool dups="); uart_print_u64(g_lf_dups);
+  uart_puts(" available="); uart_print_u64(mem_pool_lf_available(&g_lf_pool));
+  uart_puts("/"); uart_print_u64(mem_pool_lf_capacity(&g_lf_pool));
+  uart_puts("\n");
+
+  const bool ok = g_lf_dups == 0 && g_lf_irq_allocs > 0 &&
+                  mem_pool_lf_available(&g_lf_pool) == mem_pool_lf_capacity(&g_lf_pool);
+  uart_puts(ok ? "[irq-lab] result PASS\n" : "[irq-lab] result FAIL\n");
+  while (1) {
+    asm volatile("wfe");
+  }
+}
+
+static void lab_ring_handler(uint32_t, void*) {
+  uint32_t v[kRingBurst];
+  for (unsigned i = 0; i < kRingBurst; ++i) v[i] = g_seq_next + i;
+  size_t k = 0;
+  if ((g_seq_next / kRingBurst) & 1u) {
+    k = g_seq_ring.push_bulk(v, kRingBurst);
+  } else {
+    while (k < kRingBurst && g_seq_ring.push(v[k])) k++;
+  }
+  g_seq_drops += kRingBurst - static_cast<unsigned>(k);
+  g_seq_next += kRingBurst;
+}
+
+static void ring_seq_consumer(void*) {
+  uint32_t buf[16];
+  uint32_t expect = 0;
+  while (g_seq_popped + g_seq_drops < kRingItems) {
+    const size_t k = g_seq_ring.pop_bulk_wait(buf, 16);
+    for (size_t i = 0; i < k; ++i) {
+      if (buf[i] != expect) g_seq_gaps++;
+      expect = buf[i] + 1u;
+    }
+    g_seq_popped += static_cast<unsigned>(k);
+  }
+  sem_up(&g_seq_done);
+  thread_exit();
+}
+
+// Producer p pushes p * kMpmcPerProducer + 1 .. (p + 1) * kMpmcPerProducer.
+static void ring_mp_producer(void* arg) {
+  const uint32_t base = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(arg)) * kMpmcPerProducer + 1u;
+  uint32_t batch[kMpmcBatch];
+  unsigned sent = 0;
+  while (sent < kMpmcPerProducer) {
+    unsigned n = kMpmcPerProducer - sent;
+    if (n > kMpmcBatch) n = kMpmcBatch;
+    for (unsigned i = 0; i < n; ++i) batch[i] = base + sent + i;
+    const size_t k = g_mp_ring.push_bulk(batch, n);
+    sent += static_cast<unsigned>(k);
+    if (k < n) thread_yield();
+  }
+  sem_up(&g_mp_done);
+  thread_exit();
+}
+
+static void ring_mp_consumer(void*) {
+  constexpr unsigned kTotal = kMpmcThreads * kMpmcPerProducer;
+  uint32_t batch[kMpmcBatch];
+  while (__atomic_load_n(&g_mp_popped, __ATOMIC_RELAXED) < kTotal) {
+    const size_t k = g_mp_ring.pop_bulk(batch, kMpmcBatch);
+    if (k == 0) {
+      thread_yield();
+      continue;
+    }
+    uint64_t sum = 0;
+    for (size_t i = 0; i < k; ++i) sum += batch[i];
+    __atomic_fetch_add(&g_mp_sum, sum, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&g_mp_popped, static_cast<unsigned>(k), __ATOMIC_RELAXED);
+  }
+  sem_up(&g_mp_done);
+  thread_exit();
+}
+
+static void irq_lab_ring_driver(void*) {
+  if (irq_register(kRingSgi, lab_ring_handler, nullptr, IRQF_TRIGGER_EDGE) != 0) {
+    uart_puts("[irq-lab] irq_register failed\n");
+    uart_puts("[irq-lab] result FAIL\n");
+    while (1) {
+      asm volatile("wfe");
+    }
+  }
+  // The consumer outranks us, so each SGI's push wakes it and it drains the
+  // ring before the next SGI is raised.
+  for (unsigned i = 0; i < kRingSgis; ++i) {
+    gic_send_sgi_self(kRingSgi);
+    for (volatile unsigned d = 0; d < (i % 5u) * 50u; ++d) {
+    }
+  }
+  sem_down(&g_seq_done);
+  uart_puts("[irq-lab] ring spsc pushed="); uart_print_u64(kRingItems - g_seq_drops);
+  uart_puts(" popped="); uart_print_u64(g_seq_popped);
+  uart_puts(" gaps="); uart_print_u64(g_seq_gaps);
+  uart_puts(" drops="); uart_print_u64(g_seq_drops);
+  uart_puts("\n");
+  const bool spsc_ok = g_seq_popped == kRingItems && g_seq_gaps == 0 && g_seq_drops == 0;
+
+  for (unsigned p = 0; p < kMpmcThreads; ++p) {
+    Thread* prod = thread_create_prio(ring_mp_producer, reinterpret_cast<void*>(static_cast<uintptr_t>(p)),
+                                      8 * 1024, /*prio=*/10);
+    Thread* cons = thread_create_prio(ring_mp_consumer, nullptr, 8 * 1024, /*prio=*/10);
+    if (!prod || !cons) {
+      uart_puts("[irq-lab] thread_create failed\n");
+      uart_puts("[irq-lab] result FAIL\n");
+      while (1) {
+        asm volatile("wfe");
+      }
+    }
+    sched_add(prod);
+    sched_add(cons);
+  }
+  for (unsigned i = 0; i < 2u * kMpmcThreads; ++i) sem_down(&g_mp_done);
+
+  constexpr uint64_t kTotal = uint64_t{kMpmcThreads} * kMpmcPerProducer;
+  const uint64_t want_sum = kTotal * (kTotal + 1u) / 2u;
+  const bool sum_ok = __atomic_load_n(&g_mp_sum, __ATOMIC_RELAXED) == want_sum;
+  uart_puts("[irq-lab] ring mpmc popped="); uart_print_u64(g_mp_popped);
+  uart_puts("/"); uart_print_u64(kTotal);
+  uart_puts(sum_ok ? " sum ok\n" : " sum mismatch\n");
+  uint32_t extra;
+  const bool mpmc_ok = g_mp_popped == kTotal && sum_ok && !g_mp_ring.pop(&extra);
+
+  uart_puts((spsc_ok && mpmc_ok) ? "[irq-lab] result PASS\n" : "[irq-lab] result FAIL\n");
+  while (1) {
+    asm volatile("wfe");
+  }
+}
+
+static void lat_sleep(uint64_t ticks) {
+  uint32_t msg = 0;
+  (void)mbox_recv_timeout(&g_sleep_mb, &msg, nullptr, ticks);
+}
+
+static void irq_lab_lat_driver(void*) {
+  if (!IRQ_LATENCY_TRACE) {
+    uart_puts("[irq-lab] requires IRQ_LATENCY_TRACE=1\n");
+    uart_puts("[irq-lab] result FAIL\n");
+    while (1) {
+      asm volatile("wfe");
+    }
+  }
+  lat_sleep(kLatWarmupTicks);
+  irq_latency_reset();
+  lat_sleep(kLatRunTicks);
+  irq_latency_dump();
+
+  bool ok = true;
+  for (unsigned k = 0; k < IRQ_LAT_NR; ++k) {
+    irq_lat_summary sum;
+    if (irq_latency_summary(smp_processor_id(), k, &sum) != 0 || sum.samples == 0 ||
+        sum.min_ns > sum.avg_ns || sum.avg_ns > sum.max_ns || sum.p99_ns > sum.max_ns) {
+      ok = false;
+    }
+  }
+  uart_puts(ok ? "[irq-lab] latency histograms ok\n" : "[irq-lab] latency histograms missing\n");
+  uart_puts(ok ? "[irq-lab] result PASS\n" : "[irq-lab] result FAIL\n");
+  while (1) {
+    asm volatile("wfe");
+  }
+}
+
+static void irq_lab_driver(void*) {
+  // Registered here rather than in setup: gic_init() runs after the lab setup.
+  if (irq_register(kLabSgi, lab_sgi_handler, nullptr, IRQF_TRIGGER_EDGE) != 0) {
+    uart_puts("[irq-lab] irq_register failed\n");
+    uart_puts("[irq-lab] result FAIL\n");
+    while (1) {
+      asm volatile("wfe");
+    }
+  }
+  uart_puts("[irq-lab] raising SGI "); uart_print_u64(kLabSgi); uart_puts("\n");
+  gic_send_sgi_self(kLabSgi);
+
+  sem_down(&g_softirq_done);
+  const unsigned in_irq = g_runs_irq;
+  const unsigned in_thread = g_runs_thread;
+  uart_puts("[irq-lab] softirq runs="); uart_print_u64(in_irq + in_thread);
+  uart_puts(" irq_exit="); uart_print_u64(in_irq);
+  uart_puts(" ksoftirqd="); uart_print_u64(in_thread);
+  uart_puts("\n");
+  const bool softirq_ok = (in_irq + in_thread == kRearms + 1u) && in_irq >= 1u && in_thread >= 1u;
+  if (softirq_ok) {
+    uart_puts("[irq-lab] softirq overflow to ksoftirqd ok\n");
+  }
+
+  sem_down(&g_work_done);
+  uart_puts("[irq-lab] work queued="); uart_print_u64(static_cast<uint64_t>(g_queue_rc[0]));
+  uart_puts(" requeue="); uart_print_u64(static_cast<uint64_t>(g_queue_rc[1]));
+  uart_puts(" ran="); uart_print_u64(g_work_ran);
+  uart_puts(" slept_ticks="); uart_print_u64(g_work_slept);
+  uart_puts("\n");
+  const bool work_ok = g_queue_rc[0] == 1 && g_queue_rc[1] == 0 && g_work_ran == 1u && g_work_in_thread &&
+                       g_work_slept >= kWorkSleepTicks;
+
+  uart_puts("[irq-lab] HI vector count="); uart_print_u64(softirq_count(SOFTIRQ_HI));
+  uart_puts(" TIMER vector count="); uart_print_u64(softirq_count(SOFTIRQ_TIMER));
+  uart_puts("\n");
+  uart_puts((softirq_ok && work_ok) ? "[irq-lab] result PASS\n" : "[irq-lab] result FAIL\n");
+  while (1) {
+    sem_down(&g_work_done);
+  }
+}
+}  // namespace
+
+extern "C" void irq_lab_setup(unsigned mode) {
+  if (mode == 7u) {
+    uart_puts("[irq-lab] ring setup\n");
+    g_seq_ring.init();
+    g_mp_ring.init();
+    sem_init(&g_seq_done, 0);
+    sem_init(&g_mp_done, 0);
+    Thread* c = thread_create_prio(ring_seq_consumer, nullptr, 8 * 1024, /*prio=*/30);
+    Thread* d = thread_create_prio(irq_lab_ring_driver, nullptr, 16 * 1024, /*prio=*/20);
+    if (!c || !d) {
+      uart_puts("[irq-lab] thread_create failed\n");
+      while (1) {
+        asm volatile("wfe");
+      }
+    }
+    sched_add(c);
+    sched_add(d);
+    return;
+  }
+
+  if (mode == 6u) {
+    uart_puts("[irq-lab] lock-free pool setup\n");
+    if (mem_pool_lf_init(&g_lf_pool, g_lf_storage, sizeof(g_lf_storage), 64) != 0) {
+      uart_puts("[irq-lab] mem_pool_lf_init failed\n");
+      while (1) {
+        asm volatile("wfe");
+      }
+    }
+    Thread* d = thread_create_prio(irq_lab_lf_driver, nullptr, 16 * 1024, /*prio=*/20);
+    if (!d) {
+      uart_puts("[irq-lab] thread_create failed\n");
+      while (1) {
+        asm volatile("wfe");
+      }
+    }
+    sched_add(d);
+    return;
+  }
+
+  if (mode == 5u) {
+    uart_puts("[irq-lab] latency setup\n");
+    (void)mbox_init(&g_sleep_mb, g_sleep_storage, sizeof(uint32_t), 1);
+    Thread* d = thread_create_prio(irq_lab_lat_driver, nullptr, 16 * 1024, /*prio=*/20);
+    if (!d) {
+      uart_puts("[irq-lab] thread_create failed\n");
+      while (1) {
+        asm volatile("wfe");
+      }
+    }
+    sched_add(d);
+    return;
+  }
+
+  if (mode == 4u) {
+    uart_puts("[irq-lab] ipi setup\n");
+    Thread* d = thread_create_prio(irq_lab_ipi_driver, nullptr, 16 * 1024, /*prio=*/20);
+    if (!d) {
+      uart_puts("[irq-lab] thread_create failed\n");
+      while (1) {
+        asm volatile("wfe");
+      }
+    }
+    sched_add(d);
+    return;
+  }
+
+  if (mode == 3u) {
+    uart_puts("[irq-lab] pseudo-NMI setup\n");
+    Thread* d = thread_create_prio(irq_lab_nmi_driver, nullptr, 16 * 1024, /*prio=*/20);
+    if (!d) {
+      uart_puts("[irq-lab] thread_create failed\n");
+      while (1) {
+        asm volatile("wfe");
+      }
+    }
+    sched_add(d);
+    return;
+  }
+
+  if (mode == 2u) {
+    uart_puts("[irq-lab] nesting setup\n");
+    sem_init(&g_nest_done, 0);
+    Thread* d = thread_create_prio(irq_lab_nest_driver, nullptr, 16 * 1024, /*prio=*/20);
+    if (!d) {
+      uart_puts("[irq-lab] thread_create failed\n");
+      while (1) {
+        asm volatile("wfe");
+      }
+    }
+    sched_add(d);
+    return;
+  }
+
+  uart_puts("[irq-lab] softirq/workqueue setup\n");
+  g_rearm = kRearms;
+  g_runs_irq = 0;
+  g_runs_thread = 0;
+  sem_init(&g_softirq_done, 0);
+  sem_init(&g_work_done, 0);
+  work_init(&g_work, lab_work_fn);
+  (void)mbox_init(&g_sleep_mb, g_sleep_storage, sizeof(uint32_t), 1);
+  open_softirq(SOFTIRQ_HI, lab_hi_softirq);
+
+  Thread* d = thread_create_prio(irq_lab_driver, nullptr, 16 * 1024, /*prio=*/20);
+  if (!d) {
+    uart_puts("[irq-lab] thread_create failed\n");
+    while (1) {
+      asm volatile("wfe");
+    }
+  }
+  sched_add(d);
+}
@@ -0,0 +1,123 @@
+#include "irq_latency.h"
+
+#include "arch/counter.h"
+#include "arch/cpu_local.h"
+#include "arch/irqflags.h"
+#include "drivers/uart_pl011.h"
+#include "smp.h"
+
+namespace {
+struct lat_hist {
+  uint64_t samples;
+  uint64_t sum;
+  uint64_t min;
+  uint64_t max;
+  uint32_t bucket[IRQ_LAT_BUCKETS];
+};
+
+struct cpu_lat {
+  lat_hist hist[IRQ_LAT_NR];
+  uint64_t last_handled;   // handler-done stamp waiting for its eret stamp
+};
+
+cpu_lat g_lat[SMP_MAX_CPUS];
+
+const char* const kLatNames[IRQ_LAT_NR] = {"timer", "entry", "handler", "exit"};
+
+static void hist_add(lat_hist* h, uint64_t ticks) {
+  if (h->samples == 0 || ticks < h->min) h->min = ticks;
+  if (ticks > h->max) h->max = ticks;
+  h->samples++;
+  h->sum += ticks;
+  uint64_t b = ticks / IRQ_LAT_BUCKET_TICKS;
+  if (b >= IRQ_LAT_BUCKETS) b = IRQ_LAT_BUCKETS - 1;
+  h->bucket[b]++;
+}
+
+static void hist_reset(lat_hist* h) {
+  h->samples = 0;
+  h->sum = 0;
+  h->min = 0;
+  h->max = 0;
+  for (unsigned i = 0; i < IRQ_LAT_BUCKETS; ++i) {
+    h->bucket[i] = 0;
+  }
+}
+}  // namespace
+
+extern "C" void irq_latency_record(uint64_t entry, uint64_t cval, uint64_t acked, uint64_t handled) {
+  auto* cpu = cpu_local();
+  if (cpu->cpu_id >= SMP_MAX_CPUS) return;
+  cpu_lat* c = &g_lat[cpu->cpu_id];
+
+  // The previous IRQ's eret stamp is only known now; nested exits pair up
+  // the same way because each one reads the pair before overwriting it.
+  if (c->last_handled && cpu->irq_eret_cnt > c->last_handled) {
+    hist_add(&c->hist[IRQ_LAT_EXIT], cpu->irq_eret_cnt - c->last_handled);
+  }
+  if (cval && entry >= cval) {
+    hist_add(&c->hist[IRQ_LAT_TIMER], entry - cval);
+  }
+  if (entry && acked >= entry) {
+    hist_add(&c->hist[IRQ_LAT_ENTRY], acked - entry);
+  }
+  if (handled >= acked) {
+    hist_add(&c->hist[IRQ_LAT_HANDLER], handled - acked);
+  }
+  c->last_handled = handled;
+}
+
+extern "C" void irq_latency_reset(void) {
+  unsigned long flags = local_irq_save();
+  for (unsigned cpu = 0; cpu < SMP_MAX_CPUS; ++cpu) {
+    for (unsigned k = 0; k < IRQ_LAT_NR; ++k) {
+      hist_reset(&g_lat[cpu].hist[k]);
+    }
+    g_lat[cpu].last_handled = 0;
+  }
+  local_irq_restore(flags);
+}
+
+extern "C" int irq_latency_summary(unsigned cpu, unsigned kind, irq_lat_summary* out) {
+  if (cpu >= SMP_MAX_CPUS || kind >= IRQ_LAT_NR || !out) return -1;
+  unsigned long flags = local_irq_save();
+  const lat_hist* h = &g_lat[cpu].hist[kind];
+  out->samples = h->samples;
+  out->min_ns = arch_counter_to_ns(h->min);
+  out->max_ns = arch_counter_to_ns(h->max);
+  out->avg_ns = h->samples ? arch_counter_to_ns(h->sum / h->samples) : 0;
+  out->p99_ns = 0;
+  if (h->samples) {
+    const uint64_t target = h->samples - h->samples / 100u;  // ceil(0.99 * n)
+    uint64_t seen = 0;
+    for (unsigned b = 0; b < IRQ_LAT_BUCKETS; ++b) {
+      seen += h->bucket[b];
+      if (seen >= target) {
+        const uint64_t edge = (b == IRQ_LAT_BUCKETS - 1) ? h->max : (b + 1ull) * IRQ_LAT_BUCKET_TICKS;
+        out->p99_ns = arch_counter_to_ns(edge < h->max ? edge : h->max);
+        break;
+      }
+    }
+  }
+  local_irq_restore(flags);
+  return 0;
+}
+
+extern "C" void irq_latency_dump(void) {
+  const cpumask_t online = smp_online_mask();
+  for (unsigned cpu = 0; cpu < SMP_MAX_CPUS; ++cpu) {
+    if (!(online & (1u << cpu))) continue;
+    for (unsigned k = 0; k < IRQ_LAT_NR; ++k) {
+      irq_lat_summary s;
+      if (irq_latency_summary(cpu, k, &s) != 0 || s.samples == 0) continue;
+      uart_puts("[irq-lat] cpu="); uart_print_u64(cpu);
+      uart_puts(" "); uart_puts(kLatNames[k]);
+      uart_puts(" n="); uart_print_u64(s.samples);
+      uart_puts(" min_ns="); uart_print_u64(s.min_ns);
+      uart_puts(" avg_ns="); uart_print_u64(s.avg_ns);
+      uart_puts(" max_ns="); uart_print_u64(s.max_ns);
+      uart_puts(" p99_ns="); uart_print_u64(s.p99_ns);
+      uart_puts("\n");
+    }
+  }
+}
@@ -0,0 +1,123 @@
+#include "irqsoff_trace.h"
+
+#include "arch/counter.h"
+#include "arch/cpu_local.h"
+#include "arch/irqflags.h"
+#include "drivers/uart_pl011.h"
+#include "smp.h"
+
+namespace {
+struct open_section {
+  uint64_t  start;      // CNTVCT when opened, 0 while closed
+  uintptr_t start_ip;
+};
+
+struct longest_section {
+  uint64_t  sections;
+  uint64_t  ticks;
+  uintptr_t start_ip;
+  uintptr_t end_ip;
+};
+
+struct cpu_trace {
+  open_section    cur[IRQSOFF_KIND_NR];
+  longest_section max[IRQSOFF_KIND_NR];
+};
+
+cpu_trace g_trace[SMP_MAX_CPUS];
+
+const char* const kKindNames[IRQSOFF_KIND_NR] = {"irqsoff", "preemptoff"};
+
+constexpr char kHexDigits[] = "0123456789abcdef";
+
+static void uart_puthex64(uint64_t value) {
+  if (value == 0) { uart_putc('0'); return; }
+  char buf[16]; int idx = 0;
+  while (value && idx < 16) { buf[idx++] = kHexDigits[value & 0xFu]; value >>= 4; }
+  while (idx--) uart_putc(buf[idx]);
+}
+
+// cpu_local() is unset until cpu_local_boot_init(); early masking is not traced.
+static cpu_trace* this_cpu_trace() {
+  auto* cpu = cpu_local();
+  if (!cpu || cpu->cpu_id >= SMP_MAX_CPUS) return nullptr;
+  return &g_trace[cpu->cpu_id];
+}
+
+static void section_open(unsigned kind, uintptr_t ip) {
+  cpu_trace* t = this_cpu_trace();
+  if (!t || t->cur[kind].start) return;
+  t->cur[kind].start_ip = ip;
+  t->cur[kind].start = arch_counter_read();
+}
+
+static void section_close(unsigned kind, uintptr_t ip) {
+  cpu_trace* t = this_cpu_trace();
+  if (!t || !t->cur[kind].start) return;
+  const uint64_t len = arch_counter_read() - t->cur[kind].start;
+  longest_section* m = &t->max[kind];
+  m->sections++;
+  if (len > m->ticks) {
+    m->ticks = len;
+    m->start_ip = t->cur[kind].start_ip;
+    m->end_ip = ip;
+  }
+  t->cur[kind].start = 0;
+}
+}  // namespace
+
+extern "C" void trace_irqs_off(uintptr_t ip) {
+  section_open(IRQSOFF_KIND_IRQ, ip);
+}
+
+extern "C" void trace_irqs_on(uintptr_t ip) {
+  section_close(IRQSOFF_KIND_IRQ, ip);
+}
+
+extern "C" void trace_preempt_off(uintptr_t ip) {
+  section_open(IRQSOFF_KIND_PREEMPT, ip);
+}
+
+extern "C" void trace_preempt_on(uintptr_t ip) {
+  section_close(IRQSOFF_KIND_PREEMPT, ip);
+}
+
+extern "C" void irqsoff_trace_reset(void) {
+  unsigned long flags = local_irq_save();
+  for (unsigned cpu = 0; cpu < SMP_MAX_CPUS; ++cpu) {
+    for (unsigned k = 0; k < IRQSOFF_KIND_NR; ++k) {
+      g_trace[cpu].max[k] = longest_section{};
+    }
+  }
+  local_irq_restore(flags);
+}
+
+extern "C" int irqsoff_trace_max(unsigned cpu, unsigned kind, irqsoff_max* out) {
+  if (cpu >= SMP_MAX_CPUS || kind >= IRQSOFF_KIND_NR || !out) return -1;
+  unsigned long flags = local_irq_save();
+  const longest_section m = g_trace[cpu].max[kind];
+  local_irq_restore(flags);
+  out->sections = m.sections;
+  out->max_ns = arch_counter_to_ns(m.ticks);
+  out->start_ip = m.start_ip;
+  out->end_ip = m.end_ip;
+  return 0;
+}
+
+extern "C" void irqsoff_trace_dump(void) {
+  const cpumask_t online = smp_online_mask();
+  for (unsigned cpu = 0; cpu < SMP_MAX_CPUS; ++cpu) {
+    if (!(online & (1u << cpu))) continue;
+    for (unsigned k = 0; k < IRQSOFF_KIND_NR; ++k) {
+      irqsoff_max m;
+      if (irqsoff_trace_max(cpu, k, &m) != 0 || m.sections == 0) continue;
+      uart_puts("[irqsoff] cpu="); uart_print_u64(cpu);
+      uart_puts(" "); uart_puts(kKindNames[k]);
+      uart_puts(" n="); uart_print_u64(m.sections);
+      uart_puts(" max_ns="); uart_print_u64(m.max_ns);
+      uart_puts(" start=0x"); uart_puthex64(m.start_ip);
+      uart_puts(" end=0x"); uart_puthex64(m.end_ip);
+      uart_puts("\n");
+    }
+  }
+}
@@ -3,17 +3,27 @@
 #include "arch/cpu_local.h"
 #include "arch/timer.h"
 #include "arch/irqflags.h"
+#include "arch/gicv3.h"
 #include "arch/ctx.h"
 #include "arch/mmu.h"
 #include "kmem.h"
+#include "page_alloc.h"
 #include "platform.h"
 #include "thread.h"
 #include "preempt.h"
 #include "dma.h"
+#include "irq.h"
+#include "smp.h"
+#include "irqsoff_trace.h"
+#include "softirq.h"
+#include "workqueue.h"
 #include "dma_lab.h"
 #include "mem_lab.h"
 #include "sync_lab.h"
 #include "lock_lab.h"
+#include "ipc_lab.h"
+#include "irq_lab.h"
+#include "bench_lab.h"
 #include "stack_lab.h"
 
 extern "C" {
@@ -50,8 +60,20 @@ extern "C" {
 #define LOCK_LAB_MODE 0
 #endif
 
-#if ((DMA_LAB_MODE != 0) + (SYNC_LAB_MODE != 0) + (MEM_LAB_MODE != 0) + (STACK_LAB_MODE != 0) + (LOCK_LAB_MODE != 0)) > 1
-#error "Enable only one lab mode (DMA_LAB_MODE, SYNC_LAB_MODE, MEM_LAB_MODE, STACK_LAB_MODE, LOCK_LAB_MODE)"
+#ifndef IPC_LAB_MODE
+#define IPC_LAB_MODE 0
+#endif
+
+#ifndef IRQ_LAB_MODE
+#define IRQ_LAB_MODE 0
+#endif
+
+#ifndef BENCH_LAB_MODE
+#define BENCH_LAB_MODE 0
+#endif
+
+#if ((DMA_LAB_MODE != 0) + (SYNC_LAB_MODE != 0) + (MEM_LAB_MODE != 0) + (STACK_LAB_MODE != 0) + (LOCK_LAB_MODE != 0) + (IPC_LAB_MODE != 0) + (IRQ_LAB_MODE != 0) + (BENCH_LAB_MODE != 0)) > 1
+#error "Enable only one lab mode (DMA_LAB_MODE, SYNC_LAB_MODE, MEM_LAB_MODE, STACK_LAB_MODE, LOCK_LAB_MODE, IPC_LAB_MODE, IRQ_LAB_MODE, BENCH_LAB_MODE)"
 #endif
 
 namespace {
@@ -98,6 +120,9 @@ extern "C" void kmain() {
   platform_early_init();
   uart_init();
   uart_puts("[BOOT] UART ready\n");
+#if IRQ_PMR_MASKING
+  gic_cpuif_early_init();  // local_irq_save() uses ICC_PMR_EL1 from here on
+#endif
 
   uart_puts("[mmu] enabling...\n");
   mmu_init(true);
@@ -118,6 +143,7 @@ extern "C" void kmain() {
   uart_puts("[diag] kmem_init begin\n");
   kmem_init();
   uart_puts("[diag] kmem_init end\n");
+  page_alloc_init();
 
   // Build fingerprint (timestamp)
   uart_puts("[build] "); uart_puts(__DATE__); uart_puts(" "); uart_puts(__TIME__); uart_puts("\n");
@@ -196,6 +222,8 @@ extern "C" void kmain() {
   // ==============================
   uart_puts("[diag] sched_init\n");
   sched_init();
+  softirq_init();
+  workqueue_init();
 
 #if SYNC_LAB_MODE
 #if !defined(SCHED_POLICY_PRIO)
@@ -210,6 +238,27 @@ extern "C" void kmain() {
   while (1) { asm volatile("wfe"); }
 #endif
   lock_lab_setup(static_cast<unsigned>(LOCK_LAB_MODE));
+#elif IPC_LAB_MODE
+#if !defined(SCHED_POLICY_PRIO)
+  uart_puts("[ipc-lab] requires SCHED_POLICY=PRIO\n");
+  while (1) { asm volatile("wfe"); }
+#endif
+  uart_puts("[ipc-lab] mode="); uart_print_u64(static_cast<unsigned long long>(IPC_LAB_MODE)); uart_puts("\n");
+  ipc_lab_setup(static_cast<unsigned>(IPC_LAB_MODE));
+#elif IRQ_LAB_MODE
+#if !defined(SCHED_POLICY_PRIO)
+  uart_puts("[irq-lab] requires SCHED_POLICY=PRIO\n");
+  while (1) { asm volatile("wfe"); }
+#endif
+  uart_puts("[irq-lab] mode="); uart_print_u64(static_cast<unsigned long long>(IRQ_LAB_MODE)); uart_puts("\n");
+  irq_lab_setup(static_cast<unsigned>(IRQ_LAB_MODE));
+#elif BENCH_LAB_MODE
+#if !defined(SCHED_POLICY_PRIO)
+  uart_puts("[bench] requires SCHED_POLICY=PRIO\n");
+  while (1) { asm volatile("wfe"); }
+#endif
+  uart_puts("[bench] mode="); uart_print_u64(static_cast<unsigned long long>(BENCH_LAB_MODE)); uart_puts("\n");
+  bench_lab_setup(static_cast<unsigned>(BENCH_LAB_MODE));
 #elif STACK_LAB_MODE
   uart_puts("[stack-lab] mode="); uart_print_u64(static_cast<unsigned long long>(STACK_LAB_MODE)); uart_puts("\n");
   stack_lab_setup(static_cast<unsigned>(STACK_LAB_MODE));
@@ -229,6 +278,9 @@ extern "C" void kmain() {
 
   uart_puts("[diag] gic_init\n");
   platform_irq_init();
+  irq_init();
+  smp_init();
+  dma_irq_init();
 
   uart_puts("[diag] timer_init_hz\n");
   timer_init_hz(1000);
@@ -258,9 +310,19 @@ static void a(void* arg) {
 static void b(void* arg) {
   (void)arg;
   uart_puts("B");
+#if IRQSOFF_TRACE
+  unsigned rounds = 0;
+#endif
   while (1) {
     uart_puts("b");
     spin(120000);
+#if IRQSOFF_TRACE
+    // The longest sections so far; a's spin(50000) should top preemptoff.
+    if ((++rounds & 63u) == 0u) {
+      uart_puts("\n");
+      irqsoff_trace_dump();
+    }
+#endif
   }
 }
 #endif
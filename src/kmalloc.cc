@@ -0,0 +1,320 @@
+#include "kmalloc.h"
+
+#include <stdint.h>
+
+#include "drivers/uart_pl011.h"
+#include "mem_pool.h"
+#include "page_alloc.h"
+#include "spinlock.h"
+#include "tlsf.h"
+
+#ifndef KMALLOC_TLSF
+#define KMALLOC_TLSF 0
+#endif
+
+extern "C" void* memset(void* dst, int c, size_t n);
+
+namespace {
+constexpr uint32_t kSlabMagic = 0x736c6162u;   // "slab"
+constexpr uint32_t kLargeMagic = 0x6c617267u;  // "larg"
+constexpr size_t kHeaderBytes = 112;
+
+constexpr size_t kClassSize[] = {16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024};
+constexpr unsigned kClasses = sizeof(kClassSize) / sizeof(kClassSize[0]);
+static_assert(kClassSize[kClasses - 1] == KMALLOC_MAX_SMALL, "last class must be KMALLOC_MAX_SMALL");
+
+// Sits at the start of every slab page and large block. The buddy allocator
+// reuses the first bytes of a free page as list links, which also wipes the
+// magic once the page is returned. Slabs track their objects in |alloc_bits|
+// so kfree() rejects double frees in O(1).
+struct page_header {
+  uint32_t     magic;
+  uint32_t     info;    // size class (slab) or order (large block)
+  page_header* next;    // partial list links (slabs only)
+  page_header* prev;
+  mem_pool     pool;
+  uint64_t     alloc_bits[MEM_POOL_BITMAP_WORDS(PAGE_SIZE / 16)];
+};
+static_assert(sizeof(page_header) <= kHeaderBytes, "page header overflows its slot");
+
+// A slab is on |partial| while it has both free and used objects. Full slabs
+// are reachable only through their objects; one empty slab is kept as |spare|.
+struct size_class {
+  spinlock     lock;
+  page_header* partial;
+  page_header* spare;
+  size_t       slabs;
+  size_t       in_use;
+};
+
+size_class g_classes[kClasses];
+
+spinlock g_large_lock;
+size_t g_large_allocs = 0;
+size_t g_large_pages = 0;
+
+// Size (in 16-byte steps) -> class index, so the common path never searches.
+struct class_lookup {
+  uint8_t idx[KMALLOC_MAX_SMALL / 16 + 1];
+  constexpr class_lookup() : idx() {
+    unsigned c = 0;
+    for (unsigned i = 0; i <= KMALLOC_MAX_SMALL / 16; ++i) {
+      while (kClassSize[c] < i * 16u) c++;
+      idx[i] = static_cast<uint8_t>(c);
+    }
+  }
+};
+constexpr class_lookup kLookup;
+
+static inline unsigned class_of(size_t size) {
+  return kLookup.idx[(size + 15u) >> 4];
+}
+
+static inline page_header* header_of(const void* p) {
+  return reinterpret_cast<page_header*>(reinterpret_cast<uintptr_t>(p) & ~(PAGE_SIZE - 1u));
+}
+
+static void partial_add(size_class* c, page_header* s) {
+  s->prev = nullptr;
+  s->next = c->partial;
+  if (s->next) s->next->prev = s;
+  c->partial = s;
+}
+
+static void partial_del(size_class* c, page_header* s) {
+  if (s->prev) {
+    s->prev->next = s->next;
+  } else {
+    c->partial = s->next;
+  }
+  if (s->next) s->next->prev = s->prev;
+  s->next = nullptr;
+  s->prev = nullptr;
+}
+
+static page_header* slab_create(unsigned cls) {
+  void* page = alloc_pages(0);
+  if (!page) return nullptr;
+  auto* s = static_cast<page_header*>(page);
+  s->magic = kSlabMagic;
+  s->info = cls;
+  s->next = nullptr;
+  s->prev = nullptr;
+  if (mem_pool_init(&s->pool, static_cast<uint8_t*>(page) + kHeaderBytes, PAGE_SIZE - kHeaderBytes,
+                    kClassSize[cls]) != 0 ||
+      mem_pool_attach_bitmap(&s->pool, s->alloc_bits, MEM_POOL_BITMAP_WORDS(PAGE_SIZE / 16)) != 0) {
+    free_pages(page, 0);
+    return nullptr;
+  }
+  return s;
+}
+
+static void* slab_alloc(unsigned cls) {
+  size_class* c = &g_classes[cls];
+  unsigned long flags = spin_lock_irqsave(&c->lock);
+  page_header* s = c->partial;
+  if (!s) {
+    s = c->spare;
+    c->spare = nullptr;
+    if (!s) {
+      s = slab_create(cls);
+      if (!s) {
+        spin_unlock_irqrestore(&c->lock, flags);
+        return nullptr;
+      }
+      c->slabs++;
+    }
+    partial_add(c, s);
+  }
+  void* p = mem_pool_alloc(&s->pool);
+  c->in_use++;
+  if (mem_pool_available(&s->pool) == 0) partial_del(c, s);
+  spin_unlock_irqrestore(&c->lock, flags);
+  return p;
+}
+
+static void slab_free(page_header* s, void* p) {
+  size_class* c = &g_classes[s->info];
+  page_header* release = nullptr;
+  unsigned long flags = spin_lock_irqsave(&c->lock);
+  const size_t was_free = mem_pool_available(&s->pool);
+  if (mem_pool_free(&s->pool, p) != 0) {
+    spin_unlock_irqrestore(&c->lock, flags);
+    uart_puts("[kmalloc] kfree of a free or non-object pointer ignored\n");
+    return;
+  }
+  c->in_use--;
+  if (was_free == 0) partial_add(c, s);
+  if (mem_pool_available(&s->pool) == mem_pool_capacity(&s->pool)) {
+    partial_del(c, s);
+    if (!c->spare) {
+      c->spare = s;
+    } else {
+      c->slabs--;
+      release = s;
+    }
+  }
+  spin_unlock_irqrestore(&c->lock, flags);
+  if (release) free_pages(release, 0);
+}
+
+static void* large_alloc(size_t size) {
+  const unsigned order = page_order_for(size + kHeaderBytes);
+  if (order > PAGE_ORDER_MAX) return nullptr;
+  void* block = alloc_pages(order);
+  if (!block) return nullptr;
+  auto* h = static_cast<page_header*>(block);
+  h->magic = kLargeMagic;
+  h->info = order;
+  unsigned long flags = spin_lock_irqsave(&g_large_lock);
+  g_large_allocs++;
+  g_large_pages += 1ul << order;
+  spin_unlock_irqrestore(&g_large_lock, flags);
+  return static_cast<uint8_t*>(block) + kHeaderBytes;
+}
+
+static void large_free(page_header* h) {
+  const unsigned order = h->info;
+  h->magic = 0;
+  if (free_pages(h, order) != 0) {
+    uart_puts("[kmalloc] large block rejected by the page allocator\n");
+    return;
+  }
+  unsigned long flags = spin_lock_irqsave(&g_large_lock);
+  g_large_allocs--;
+  g_large_pages -= 1ul << order;
+  spin_unlock_irqrestore(&g_large_lock, flags);
+}
+
+// KMALLOC_TLSF=1: one TLSF heap serves every size. It grows by a
+// PAGE_ORDER_MAX block whenever a request does not fit, up to
+// TLSF_MAX_POOLS blocks, and never shrinks. Requests a fresh block cannot
+// hold fail without growing.
+constexpr size_t kTlsfPoolBytes = PAGE_SIZE << PAGE_ORDER_MAX;
+spinlock g_tlsf_lock;
+tlsf_heap g_tlsf;
+bool g_tlsf_ready = false;
+
+static bool tlsf_grow() {
+  void* block = alloc_pages(PAGE_ORDER_MAX);
+  if (!block) return false;
+  const int rc = g_tlsf_ready ? tlsf_add_pool(&g_tlsf, block, kTlsfPoolBytes)
+                              : tlsf_init(&g_tlsf, block, kTlsfPoolBytes);
+  if (rc != 0) {
+    free_pages(block, PAGE_ORDER_MAX);
+    return false;
+  }
+  g_tlsf_ready = true;
+  return true;
+}
+
+static void* tlsf_kmalloc(size_t size) {
+  if (!tlsf_pool_fits(kTlsfPoolBytes, size)) return nullptr;
+  unsigned long flags = spin_lock_irqsave(&g_tlsf_lock);
+  void* p = g_tlsf_ready ? tlsf_malloc(&g_tlsf, size) : nullptr;
+  if (!p && tlsf_grow()) p = tlsf_malloc(&g_tlsf, size);
+  spin_unlock_irqrestore(&g_tlsf_lock, flags);
+  return p;
+}
+}  // namespace
+
+extern "C" void* kmalloc(size_t size, uint32_t flags) {
+  if (size == 0) return nullptr;
+  void* p;
+  if (KMALLOC_TLSF) {
+    p = tlsf_kmalloc(size);
+  } else {
+    p = (size <= KMALLOC_MAX_SMALL) ? slab_alloc(class_of(size)) : large_alloc(size);
+  }
+  if (p && (flags & KM_ZERO)) memset(p, 0, size);
+  return p;
+}
+
+extern "C" void kfree(void* p) {
+  if (!p) return;
+  if (KMALLOC_TLSF) {
+    unsigned long flags = spin_lock_irqsave(&g_tlsf_lock);
+    const uint64_t bad = g_tlsf.bad_frees;
+    tlsf_free(&g_tlsf, p);
+    const bool rejected = g_tlsf.bad_frees != bad;
+    spin_unlock_irqrestore(&g_tlsf_lock, flags);
+    if (rejected) uart_puts("[kmalloc] kfree of an unknown pointer ignored\n");
+    return;
+  }
+  page_header* h = header_of(p);
+  if (h->magic == kSlabMagic && h->info < kClasses) {
+    slab_free(h, p);
+  } else if (h->magic == kLargeMagic && p == reinterpret_cast<uint8_t*>(h) + kHeaderBytes) {
+    large_free(h);
+  } else {
+    uart_puts("[kmalloc] kfree of an unknown pointer ignored\n");
+  }
+}
+
+extern "C" size_t ksize(const void* p) {
+  if (!p) return 0;
+  if (KMALLOC_TLSF) return tlsf_block_size(p);
+  const page_header* h = header_of(p);
+  if (h->magic == kSlabMagic && h->info < kClasses) return kClassSize[h->info];
+  if (h->magic == kLargeMagic) return (PAGE_SIZE << h->info) - kHeaderBytes;
+  return 0;
+}
+
+extern "C" void kmalloc_stats_get(struct kmalloc_stats* out) {
+  if (!out) return;
+  if (KMALLOC_TLSF) {
+    unsigned long flags = spin_lock_irqsave(&g_tlsf_lock);
+    out->large_allocs = static_cast<size_t>(g_tlsf.mallocs - g_tlsf.frees);
+    out->large_pages = static_cast<size_t>(g_tlsf.nr_pools) << PAGE_ORDER_MAX;
+    spin_unlock_irqrestore(&g_tlsf_lock, flags);
+    out->classes = 0;
+    return;
+  }
+  unsigned long flags = spin_lock_irqsave(&g_large_lock);
+  out->large_allocs = g_large_allocs;
+  out->large_pages = g_large_pages;
+  spin_unlock_irqrestore(&g_large_lock, flags);
+  out->classes = kClasses;
+}
+
+extern "C" int kmalloc_class_stats_get(unsigned cls, struct kmalloc_class_stats* out) {
+  if (KMALLOC_TLSF || cls >= kClasses || !out) return -1;
+  size_class* c = &g_classes[cls];
+  unsigned long flags = spin_lock_irqsave(&c->lock);
+  out->obj_size = kClassSize[cls];
+  out->slabs = c->slabs;
+  out->in_use = c->in_use;
+  spin_unlock_irqrestore(&c->lock, flags);
+  return 0;
+}
+
+extern "C" void kmalloc_dump(void) {
+  if (KMALLOC_TLSF) {
+    tlsf_report r{};
+    unsigned long flags = spin_lock_irqsave(&g_tlsf_lock);
+    if (g_tlsf_ready) tlsf_report_get(&g_tlsf, &r);
+    spin_unlock_irqrestore(&g_tlsf_lock, flags);
+    uart_puts("[kmalloc] tlsf pools="); uart_print_u64(g_tlsf.nr_pools);
+    uart_puts(" used="); uart_print_u64(r.used_bytes);
+    uart_puts(" blocks="); uart_print_u64(r.used_blocks);
+    uart_puts(" free="); uart_print_u64(r.free_bytes);
+    uart_puts(" largest_free="); uart_print_u64(r.largest_free);
+    uart_puts(" frag_pct="); uart_print_u64(r.external_frag_pct);
+    uart_puts("\n");
+    return;
+  }
+  for (unsigned i = 0; i < kClasses; ++i) {
+    kmalloc_class_stats s;
+    kmalloc_class_stats_get(i, &s);
+    if (!s.slabs) continue;
+    uart_puts("[kmalloc] size="); uart_print_u64(s.obj_size);
+    uart_puts(" slabs="); uart_print_u64(s.slabs);
+    uart_puts(" in_use="); uart_print_u64(s.in_use);
+    uart_puts("\n");
+  }
+  kmalloc_stats l;
+  kmalloc_stats_get(&l);
+  uart_puts("[kmalloc] large n="); uart_print_u64(l.large_allocs);
+  uart_puts(" pages="); uart_print_u64(l.large_pages);
+  uart_puts("\n");
+}
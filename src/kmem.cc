@@ -1,9 +1,14 @@
 // Bump allocator for early boot; not IRQ/multi-CPU safe.
 // Alignment must be a power of two; we auto-round-up.
+// Starts on the linker heap; after kmem_handoff() an exhausted region is
+// replaced by a fresh chunk from the page allocator.
 #include <stdint.h>
 #include "kmem.h"
+#include "page_alloc.h"
 extern "C" char _heap_start[], _heap_end[];
 static uintptr_t cur, end;
+static bool handed_off;
+static constexpr unsigned kChunkOrder = 9;  // 2 MiB: one L2 block, keeps guard-page L3 tables few
 static inline uintptr_t align_up(uintptr_t v, uintptr_t a){ return (v + a - 1) & ~(a-1); }
 static inline bool is_pow2(uintptr_t a){ return a && ((a & (a - 1)) == 0); }
 static inline uintptr_t round_up_pow2(uintptr_t a){
@@ -19,10 +24,25 @@ static inline uintptr_t round_up_pow2(uintptr_t a){
 #endif
   return a + 1;
 }
-extern "C" void kmem_init(void){ cur=(uintptr_t)_heap_start; end=(uintptr_t)_heap_end; }
+// The rest of the old region is abandoned: bump allocations are permanent.
+static bool refill(size_t sz, size_t align){
+  if (!handed_off) return false;
+  unsigned order = page_order_for(sz + align);
+  if (order < kChunkOrder) order = kChunkOrder;
+  void* chunk = alloc_pages(order);
+  if (!chunk) return false;
+  cur = (uintptr_t)chunk; end = cur + (PAGE_SIZE << order);
+  return true;
+}
+extern "C" void kmem_init(void){ cur=(uintptr_t)_heap_start; end=(uintptr_t)_heap_end; handed_off=false; }
+extern "C" void kmem_handoff(void){ handed_off = true; }
 extern "C" void* kmem_alloc_aligned(size_t sz, size_t align){
   if (align < 16) align = 16;
   if (!is_pow2((uintptr_t)align)) align = (size_t)round_up_pow2((uintptr_t)align);
   uintptr_t p=align_up(cur, (uintptr_t)align);
-  if (p+sz > end) return nullptr; cur = p+sz; return (void*)p;
+  if (p+sz > end) {
+    if (!refill(sz, align)) return nullptr;
+    p = align_up(cur, (uintptr_t)align);
+  }
+  cur = p+sz; return (void*)p;
 }
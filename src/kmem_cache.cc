@@ -0,0 +1,223 @@
+#include "kmem_cache.h"
+
+#include <stdint.h>
+
+#include "drivers/uart_pl011.h"
+#include "kmalloc.h"
+#include "page_alloc.h"
+
+// Sits at the start of each slab block; slabs are aligned to their size, so
+// an object finds its slab by masking.
+struct kmem_slab {
+  uint32_t    magic;
+  uint32_t    color;     // byte offset of the first block
+  kmem_slab*  next;
+  kmem_slab*  prev;
+  kmem_cache* cache;
+  mem_pool    pool;
+};
+
+namespace {
+constexpr uint32_t kSlabMagic = 0x6b636163u;  // "kcac"
+constexpr size_t kCacheLine = 64;
+constexpr size_t kMinAlign = 16;              // mem_pool block alignment
+constexpr size_t kMinObjsPerSlab = 8;
+constexpr unsigned kPreferredMaxOrder = 3;    // grow past 32 KiB only for huge objects
+
+spinlock g_caches_lock;
+kmem_cache* g_caches = nullptr;
+
+static inline size_t align_up(size_t v, size_t a) {
+  return (v + a - 1u) & ~(a - 1u);
+}
+
+static inline size_t round_pow2(size_t v) {
+  size_t p = 1;
+  while (p < v) p <<= 1u;
+  return p;
+}
+
+static inline size_t slab_bytes(const kmem_cache* c) {
+  return PAGE_SIZE << c->slab_order;
+}
+
+// The slab header is followed by the pool's allocation bitmap.
+static inline size_t header_bytes_for(size_t per_slab, size_t align) {
+  return align_up(sizeof(kmem_slab) + MEM_POOL_BITMAP_WORDS(per_slab) * sizeof(uint64_t), align);
+}
+
+static inline uint64_t* slab_bitmap(kmem_slab* s) {
+  return reinterpret_cast<uint64_t*>(s + 1);
+}
+
+static void partial_add(kmem_cache* c, kmem_slab* s) {
+  s->prev = nullptr;
+  s->next = c->partial;
+  if (s->next) s->next->prev = s;
+  c->partial = s;
+}
+
+static void partial_del(kmem_cache* c, kmem_slab* s) {
+  if (s->prev) {
+    s->prev->next = s->next;
+  } else {
+    c->partial = s->next;
+  }
+  if (s->next) s->next->prev = s->prev;
+  s->next = nullptr;
+  s->prev = nullptr;
+}
+
+// Builds a slab with every object constructed. Runs without the cache lock so
+// constructors do not extend the IRQ-off section.
+static kmem_slab* slab_create(kmem_cache* c, size_t color_idx) {
+  void* block = alloc_pages(c->slab_order);
+  if (!block) return nullptr;
+  auto* s = static_cast<kmem_slab*>(block);
+  s->magic = kSlabMagic;
+  s->next = nullptr;
+  s->prev = nullptr;
+  s->cache = c;
+
+  const size_t step = (c->align > kCacheLine) ? c->align : kCacheLine;
+  s->color = static_cast<uint32_t>((color_idx % c->colors) * step);
+
+  uint8_t* first = static_cast<uint8_t*>(block) + c->header_bytes + s->color;
+  if (mem_pool_init(&s->pool, first, c->per_slab * c->stride, c->stride) != 0 ||
+      mem_pool_capacity(&s->pool) != c->per_slab ||
+      mem_pool_attach_bitmap(&s->pool, slab_bitmap(s), MEM_POOL_BITMAP_WORDS(c->per_slab)) != 0) {
+    free_pages(block, c->slab_order);
+    return nullptr;
+  }
+  if (c->ctor) {
+    for (size_t i = 0; i < c->per_slab; ++i) {
+      c->ctor(first + i * c->stride + c->link_bytes);
+    }
+  }
+  return s;
+}
+}  // namespace
+
+extern "C" struct kmem_cache* kmem_cache_create(const char* name, size_t size, size_t align,
+                                                kmem_ctor_t ctor) {
+  if (size == 0) return nullptr;
+  if (align < kMinAlign) align = kMinAlign;
+  align = round_pow2(align);
+
+  const size_t link = align_up(sizeof(void*), align);
+  const size_t stride = align_up(link + size, align);
+
+  unsigned order = 0;
+  size_t per_slab = 0;
+  size_t hdr = 0;
+  for (; order <= PAGE_ORDER_MAX; ++order) {
+    const size_t bytes = PAGE_SIZE << order;
+    // Size the bitmap for the objects that fit without it; the header can
+    // only shrink the count, so the bitmap stays large enough.
+    hdr = header_bytes_for(bytes / stride, align);
+    per_slab = (bytes > hdr) ? (bytes - hdr) / stride : 0;
+    if (per_slab >= kMinObjsPerSlab) break;
+    if (per_slab >= 1 && order >= kPreferredMaxOrder) break;
+  }
+  if (order > PAGE_ORDER_MAX || per_slab == 0) return nullptr;
+
+  auto* c = static_cast<kmem_cache*>(kmalloc(sizeof(kmem_cache), KM_ZERO));
+  if (!c) return nullptr;
+  c->name = name;
+  c->obj_size = size;
+  c->align = align;
+  c->ctor = ctor;
+  c->slab_order = order;
+  c->header_bytes = hdr;
+  c->link_bytes = link;
+  c->stride = stride;
+  c->per_slab = per_slab;
+  const size_t leftover = (PAGE_SIZE << order) - hdr - per_slab * stride;
+  const size_t step = (align > kCacheLine) ? align : kCacheLine;
+  c->colors = leftover / step + 1u;
+  spin_init(&c->lock);
+
+  unsigned long flags = spin_lock_irqsave(&g_caches_lock);
+  c->next = g_caches;
+  g_caches = c;
+  spin_unlock_irqrestore(&g_caches_lock, flags);
+  return c;
+}
+
+extern "C" void* kmem_cache_alloc(struct kmem_cache* c) {
+  if (!c) return nullptr;
+  unsigned long flags = spin_lock_irqsave(&c->lock);
+  kmem_slab* s = c->partial;
+  if (!s) {
+    s = c->spare;
+    c->spare = nullptr;
+    if (!s) {
+      const size_t color_idx = c->color_next++;
+      spin_unlock_irqrestore(&c->lock, flags);
+      s = slab_create(c, color_idx);
+      if (!s) return nullptr;
+      flags = spin_lock_irqsave(&c->lock);
+      c->slabs++;
+      if (c->ctor) c->ctor_calls += c->per_slab;
+    }
+    partial_add(c, s);
+  }
+  auto* block = static_cast<uint8_t*>(mem_pool_alloc(&s->pool));
+  c->in_use++;
+  if (mem_pool_available(&s->pool) == 0) partial_del(c, s);
+  spin_unlock_irqrestore(&c->lock, flags);
+  return block + c->link_bytes;
+}
+
+extern "C" int kmem_cache_free(struct kmem_cache* c, void* obj) {
+  if (!c || !obj) return -1;
+  const uintptr_t v = reinterpret_cast<uintptr_t>(obj);
+  auto* s = reinterpret_cast<kmem_slab*>(v & ~(slab_bytes(c) - 1u));
+  if (s->magic != kSlabMagic || s->cache != c) return -1;
+
+  kmem_slab* release = nullptr;
+  unsigned long flags = spin_lock_irqsave(&c->lock);
+  const size_t was_free = mem_pool_available(&s->pool);
+  if (mem_pool_free(&s->pool, static_cast<uint8_t*>(obj) - c->link_bytes) != 0) {
+    spin_unlock_irqrestore(&c->lock, flags);
+    return -1;
+  }
+  c->in_use--;
+  if (was_free == 0) partial_add(c, s);
+  if (mem_pool_available(&s->pool) == c->per_slab) {
+    partial_del(c, s);
+    if (!c->spare) {
+      c->spare = s;
+    } else {
+      c->slabs--;
+      s->magic = 0;
+      release = s;
+    }
+  }
+  spin_unlock_irqrestore(&c->lock, flags);
+  if (release) free_pages(release, c->slab_order);
+  return 0;
+}
+
+extern "C" void kmem_cache_dump(void) {
+  unsigned long flags = spin_lock_irqsave(&g_caches_lock);
+  kmem_cache* head = g_caches;
+  spin_unlock_irqrestore(&g_caches_lock, flags);
+  // Caches are never destroyed, so the list can be walked unlocked.
+  for (kmem_cache* c = head; c; c = c->next) {
+    flags = spin_lock_irqsave(&c->lock);
+    const size_t slabs = c->slabs, in_use = c->in_use;
+    const uint64_t ctors = c->ctor_calls;
+    spin_unlock_irqrestore(&c->lock, flags);
+    uart_puts("[kmem_cache] "); uart_puts(c->name ? c->name : "?");
+    uart_puts(" obj="); uart_print_u64(c->obj_size);
+    uart_puts(" stride="); uart_print_u64(c->stride);
+    uart_puts(" order="); uart_print_u64(c->slab_order);
+    uart_puts(" per_slab="); uart_print_u64(c->per_slab);
+    uart_puts(" colors="); uart_print_u64(c->colors);
+    uart_puts(" slabs="); uart_print_u64(slabs);
+    uart_puts(" in_use="); uart_print_u64(in_use);
+    uart_puts(" ctor_calls="); uart_print_u64(ctors);
+    uart_puts("\n");
+  }
+}
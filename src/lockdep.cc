@@ -0,0 +1,178 @@
+#include "lockdep.h"
+
+#include <stdint.h>
+
+#include "drivers/uart_pl011.h"
+
+namespace {
+// One bit per class in a uint64_t adjacency row keeps cycle detection to a
+// handful of word operations per BFS step.
+constexpr int kMaxClasses = 64;
+
+struct lock_class {
+  const void* key;
+  const char* name;
+};
+
+lock_class g_classes[kMaxClasses];
+uint64_t g_deps[kMaxClasses];  // g_deps[a] bit b => "b acquired while holding a"
+int g_class_count = 0;
+int g_lockdep_off = 0;
+
+unsigned long g_checks = 0;
+unsigned long g_edges = 0;
+
+static void lockdep_off(void) {
+  g_lockdep_off = 1;
+}
+
+// Free slots have a null key. A mutex caches its class index; the cache is
+// trusted only while that slot still holds the mutex's key, since
+// lockdep_free_key() may have recycled it.
+static int class_register(mutex* m) {
+  const void* key = m->lock_key ? m->lock_key : m;
+  if (m->lock_class >= 0 && m->lock_class < kMaxClasses && g_classes[m->lock_class].key == key) {
+    return m->lock_class;
+  }
+
+  int free_slot = -1;
+  for (int i = 0; i < kMaxClasses; ++i) {
+    if (g_classes[i].key == key) {
+      m->lock_class = i;
+      return i;
+    }
+    if (!g_classes[i].key && free_slot < 0) free_slot = i;
+  }
+  if (free_slot < 0) {
+    uart_puts("[lockdep] class table full; turning off\n");
+    lockdep_off();
+    return -1;
+  }
+
+  g_class_count++;
+  g_classes[free_slot].key = key;
+  g_classes[free_slot].name = m->lock_name;
+  g_deps[free_slot] = 0;
+  m->lock_class = free_slot;
+  return free_slot;
+}
+
+static void put_class(int c) {
+  uart_puts("#");
+  uart_print_u64(static_cast<unsigned long long>(c));
+  if (g_classes[c].name) {
+    uart_puts("(");
+    uart_puts(g_classes[c].name);
+    uart_puts(")");
+  }
+}
+
+// BFS over the dependency graph. Returns true if |to| is reachable from
+// |from|; |parent| receives the BFS tree so the chain can be printed.
+static bool reachable(int from, int to, int8_t* parent) {
+  for (int i = 0; i < kMaxClasses; ++i) parent[i] = -1;
+
+  uint64_t visited = 1ull << from;
+  uint64_t frontier = visited;
+  while (frontier) {
+    uint64_t next = 0;
+    for (uint64_t f = frontier; f; f &= f - 1u) {
+      const int c = __builtin_ctzll(f);
+      uint64_t out = g_deps[c] & ~visited;
+      for (uint64_t o = out; o; o &= o - 1u) {
+        parent[__builtin_ctzll(o)] = static_cast<int8_t>(c);
+      }
+      visited |= out;
+      next |= out;
+    }
+    if (visited & (1ull << to)) return true;
+    frontier = next;
+  }
+  return false;
+}
+
+static void report_cycle(Thread* cur, int held, int acquiring, const int8_t* parent) {
+  uart_puts("[lockdep] possible circular locking dependency detected\n");
+  uart_puts("[lockdep] tid=");
+  uart_print_u64(static_cast<unsigned long long>(cur ? cur->id : -1));
+  uart_puts(" acquiring ");
+  put_class(acquiring);
+  uart_puts(" while holding ");
+  put_class(held);
+  uart_puts("\n");
+
+  // Existing chain acquiring -> ... -> held, printed from the held end.
+  uart_puts("[lockdep] existing chain (reverse): ");
+  int c = held;
+  for (int n = 0; c >= 0 && n < kMaxClasses; ++n) {
+    put_class(c);
+    if (c == acquiring) break;
+    uart_puts(" <- ");
+    c = parent[c];
+  }
+  uart_puts("\n");
+
+#if SYNC_LAB_MODE == 5 || SYNC_LAB_MODE == 6
+  uart_puts("[lockdep] result PASS\n");
+  while (1) {
+    asm volatile("wfe");
+  }
+#endif
+}
+}  // namespace
+
+extern "C" void lockdep_acquire(Thread* cur, mutex* m) {
+  if (g_lockdep_off || !cur || !m) return;
+
+  const int cls = class_register(m);
+  if (cls < 0) return;
+  g_checks++;
+
+  for (mutex* h = cur->owned_mutexes; h; h = h->owner_next) {
+    const int hc = class_register(h);
+    if (hc < 0) return;
+    // Same-class nesting needs subclass annotations; not tracked yet.
+    if (hc == cls) continue;
+    // Fast path: dependency already validated.
+    if (g_deps[hc] & (1ull << cls)) continue;
+
+    int8_t parent[kMaxClasses];
+    if (reachable(cls, hc, parent)) {
+      report_cycle(cur, hc, cls, parent);
+      lockdep_off();
+      return;
+    }
+    g_deps[hc] |= 1ull << cls;
+    g_edges++;
+  }
+}
+
+extern "C" void lockdep_free_key(const void* key) {
+  if (!key) return;
+  for (int i = 0; i < kMaxClasses; ++i) {
+    if (g_classes[i].key != key) continue;
+    g_edges -= static_cast<unsigned long>(__builtin_popcountll(g_deps[i]));
+    g_deps[i] = 0;
+    const uint64_t bit = 1ull << i;
+    for (int j = 0; j < kMaxClasses; ++j) {
+      if (g_deps[j] & bit) {
+        g_deps[j] &= ~bit;
+        g_edges--;
+      }
+    }
+    g_classes[i].key = nullptr;
+    g_classes[i].name = nullptr;
+    g_class_count--;
+    return;
+  }
+}
+
+extern "C" void lockdep_dump_stats(void) {
+  uart_puts("[lockdep] classes=");
+  uart_print_u64(static_cast<unsigned long long>(g_class_count));
+  uart_puts(" edges=");
+  uart_print_u64(static_cast<unsigned long long>(g_edges));
+  uart_puts(" checks=");
+  uart_print_u64(static_cast<unsigned long long>(g_checks));
+  uart_puts(g_lockdep_off ? " state=off\n" : " state=on\n");
+}
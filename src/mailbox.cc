@@ -0,0 +1,156 @@
+#include "mailbox.h"
+
+#include "arch/cpu_local.h"
+#include "arch/irqflags.h"
+#include "preempt.h"
+#include "waitq.h"
+
+namespace {
+static void mbox_copy(void* dst, const void* src, size_t len) {
+  auto* d = static_cast<uint8_t*>(dst);
+  const auto* s = static_cast<const uint8_t*>(src);
+  for (size_t i = 0; i < len; ++i) {
+    d[i] = s[i];
+  }
+}
+
+static inline uint8_t* mbox_slot(mailbox* mb, unsigned lane, uint32_t idx) {
+  const size_t cell = static_cast<size_t>(lane) * mb->depth + (idx & (mb->depth - 1u));
+  return mb->storage + cell * mb->msg_size;
+}
+
+static inline uint64_t mbox_deadline(uint64_t timeout) {
+  if (timeout == TIMEOUT_FOREVER) return TIMEOUT_FOREVER;
+  auto* cpu = cpu_local();
+  return (cpu ? cpu->ticks : 0) + timeout;
+}
+
+// True if the caller may sleep: a thread, outside IRQ context, with time left.
+static bool mbox_may_block(uint64_t timeout, uint64_t deadline) {
+  auto* cpu = cpu_local();
+  if (timeout == TIMEOUT_NO_WAIT || !cpu || !cpu->current_thread || cpu->irq_depth) {
+    return false;
+  }
+  return deadline == TIMEOUT_FOREVER || cpu->ticks < deadline;
+}
+
+// Queue the current thread on |waitq| and mark it blocked. Called with
+// preemption disabled and IRQs masked; the switch happens at preempt_enable().
+static void mbox_block(Thread** waitq, uint64_t deadline) {
+  auto* cpu = cpu_local();
+  Thread* cur = cpu->current_thread;
+  waitq_append(waitq, cur);
+  if (deadline != TIMEOUT_FOREVER) {
+    sched_timeout_arm(cur, deadline, waitq);
+  }
+  sched_block_current();
+  cpu->need_resched = 1;
+}
+}  // namespace
+
+extern "C" int mbox_init(mailbox* mb, void* storage, size_t msg_size, unsigned depth) {
+  if (!mb || !storage || msg_size == 0 || depth == 0 || (depth & (depth - 1u)) != 0) {
+    return -1;
+  }
+  mb->storage = static_cast<uint8_t*>(storage);
+  mb->msg_size = static_cast<uint32_t>(msg_size);
+  mb->depth = depth;
+  for (unsigned i = 0; i < MBOX_LANES; ++i) {
+    mb->lanes[i].head = 0;
+    mb->lanes[i].tail = 0;
+    mb->senders[i] = nullptr;
+  }
+  mb->receivers = nullptr;
+  mb->pollers = nullptr;
+  return 0;
+}
+
+extern "C" int mbox_send_timeout(mailbox* mb, const void* msg, unsigned lane, uint64_t timeout_ticks) {
+  if (!mb || !msg || lane >= MBOX_LANES) return -1;
+  const uint64_t deadline = mbox_deadline(timeout_ticks);
+
+  preempt_disable();
+  unsigned long flags = local_irq_save();
+  for (;;) {
+    mbox_lane* l = &mb->lanes[lane];
+    if (l->tail - l->head < mb->depth) {
+      mbox_copy(mbox_slot(mb, lane, l->tail), msg, mb->msg_size);
+      l->tail++;
+      if (Thread* r = waitq_pop_highest(&mb->receivers)) {
+        waitq_wake(r);
+      }
+      event_pollers_wake(&mb->pollers, ~0ull);
+      local_irq_restore(flags);
+      preempt_enable();
+      return 0;
+    }
+    if (!mbox_may_block(timeout_ticks, deadline)) break;
+
+    mbox_block(&mb->senders[lane], deadline);
+    local_irq_restore(flags);
+    preempt_enable();
+    preempt_disable();
+    flags = local_irq_save();
+  }
+  local_irq_restore(flags);
+  preempt_enable();
+  return -1;
+}
+
+extern "C" int mbox_recv_timeout(mailbox* mb, void* msg, unsigned* lane, uint64_t timeout_ticks) {
+  if (!mb || !msg) return -1;
+  const uint64_t deadline = mbox_deadline(timeout_ticks);
+
+  preempt_disable();
+  unsigned long flags = local_irq_save();
+  for (;;) {
+    for (int i = MBOX_LANES - 1; i >= 0; --i) {
+      mbox_lane* l = &mb->lanes[i];
+      if (l->tail == l->head) continue;
+      mbox_copy(msg, mbox_slot(mb, static_cast<unsigned>(i), l->head), mb->msg_size);
+      l->head++;
+      if (lane) *lane = static_cast<unsigned>(i);
+      if (Thread* s = waitq_pop_highest(&mb->senders[i])) {
+        waitq_wake(s);
+      }
+      local_irq_restore(flags);
+      preempt_enable();
+      return 0;
+    }
+    if (!mbox_may_block(timeout_ticks, deadline)) break;
+
+    mbox_block(&mb->receivers, deadline);
+    local_irq_restore(flags);
+    preempt_enable();
+    preempt_disable();
+    flags = local_irq_save();
+  }
+  local_irq_restore(flags);
+  preempt_enable();
+  return -1;
+}
+
+extern "C" int mbox_send(mailbox* mb, const void* msg, unsigned lane) {
+  return mbox_send_timeout(mb, msg, lane, TIMEOUT_FOREVER);
+}
+
+extern "C" int mbox_trysend(mailbox* mb, const void* msg, unsigned lane) {
+  return mbox_send_timeout(mb, msg, lane, TIMEOUT_NO_WAIT);
+}
+
+extern "C" int mbox_recv(mailbox* mb, void* msg, unsigned* lane) {
+  return mbox_recv_timeout(mb, msg, lane, TIMEOUT_FOREVER);
+}
+
+extern "C" int mbox_tryrecv(mailbox* mb, void* msg, unsigned* lane) {
+  return mbox_recv_timeout(mb, msg, lane, TIMEOUT_NO_WAIT);
+}
+
+extern "C" unsigned mbox_count(const mailbox* mb) {
+  if (!mb) return 0;
+  unsigned n = 0;
+  for (unsigned i = 0; i < MBOX_LANES; ++i) {
+    n += mb->lanes[i].tail - mb->lanes[i].head;
+  }
+  return n;
+}
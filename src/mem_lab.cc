@@ -3,9 +3,21 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "arch/counter.h"
+#include "arch/irqflags.h"
 #include "drivers/uart_pl011.h"
+#include "kmalloc.h"
 #include "kmem.h"
+#include "kmem_cache.h"
+#include "mem_containers.h"
+#include "mem_magazine.h"
 #include "mem_pool.h"
+#include "mem_resource.h"
+#include "page_alloc.h"
+#include "static_pool.h"
+#include "tlsf.h"
+
+extern "C" char _heap_end[];
 
 namespace {
 static void put_u64(const char* label, uint64_t v) {
@@ -18,7 +30,7 @@ static inline size_t align_up(size_t v, size_t a) {
   return (v + a - 1u) & ~(a - 1u);
 }
 
-// ---------- Demo 1: fixed-size pool internal fragmentation ----------
+// ---------- Mode 1: fixed-size pool internal fragmentation ----------
 struct pool_alloc_rec {
   void*  p;
   size_t req;
@@ -84,7 +96,7 @@ static void demo_pool_internal_fragmentation() {
   put_u64("[mem-lab][pool] free_count=", mem_pool_available(&pool));
 }
 
-// ---------- Demo 2: "malloc" external fragmentation + variable cost ----------
+// ---------- Mode 1: "malloc" external fragmentation + variable cost ----------
 //
 // This is a deliberately tiny first-fit allocator used only for demonstration.
 // It is not wired into the kernel allocator path.
@@ -280,6 +292,674 @@ static void demo_malloc_external_fragmentation() {
   put_u64("[mem-lab][malloc] big_alloc_steps=", steps);
 }
 
+// ---------- Mode 2: buddy page allocator ----------
+static bool page_stats_equal(const page_alloc_stats& a, const page_alloc_stats& b) {
+  if (a.free_pages != b.free_pages) return false;
+  for (unsigned o = 0; o <= PAGE_ORDER_MAX; ++o) {
+    if (a.free_blocks[o] != b.free_blocks[o]) return false;
+  }
+  return true;
+}
+
+static bool demo_page_allocator() {
+  uart_puts("[mem-lab][page] buddy allocator demo\n");
+  bool ok = true;
+
+  page_alloc_stats before;
+  page_alloc_stats_get(&before);
+  put_u64("[mem-lab][page] total_pages=", before.total_pages);
+  put_u64("[mem-lab][page] free_pages=", before.free_pages);
+  if (before.total_pages == 0) {
+    uart_puts("[mem-lab][page] page allocator not initialized\n");
+    return false;
+  }
+
+  // One block of every order: natural alignment, touchable end to end.
+  void* blocks[PAGE_ORDER_MAX + 1] = {};
+  for (unsigned o = 0; o <= PAGE_ORDER_MAX; ++o) {
+    blocks[o] = alloc_pages(o);
+    const uintptr_t v = reinterpret_cast<uintptr_t>(blocks[o]);
+    if (!blocks[o] || (v & ((PAGE_SIZE << o) - 1u))) {
+      put_u64("[mem-lab][page] bad block order=", o);
+      ok = false;
+      continue;
+    }
+    auto* bytes = static_cast<volatile uint8_t*>(blocks[o]);
+    bytes[0] = static_cast<uint8_t>(o);
+    bytes[(PAGE_SIZE << o) - 1u] = static_cast<uint8_t>(o);
+  }
+  for (unsigned o = 0; o <= PAGE_ORDER_MAX; ++o) {
+    if (blocks[o] && free_pages(blocks[o], o) != 0) ok = false;
+  }
+
+  // Fragment 64 single pages, then free them in two interleaved passes: the
+  // first pass cannot merge, the second must rebuild the original blocks.
+  constexpr unsigned kPages = 64;
+  void* pages[kPages] = {};
+  for (unsigned i = 0; i < kPages; ++i) {
+    pages[i] = alloc_pages(0);
+    if (!pages[i]) ok = false;
+  }
+  for (unsigned i = 0; i < kPages; i += 2) {
+    if (pages[i] && free_pages(pages[i], 0) != 0) ok = false;
+  }
+  page_alloc_stats mid;
+  page_alloc_stats_get(&mid);
+  put_u64("[mem-lab][page] holes_order0=", mid.free_blocks[0]);
+  for (unsigned i = 1; i < kPages; i += 2) {
+    if (pages[i] && free_pages(pages[i], 0) != 0) ok = false;
+  }
+
+  page_alloc_stats after;
+  page_alloc_stats_get(&after);
+  if (page_stats_equal(before, after)) {
+    uart_puts("[mem-lab][page] coalesced back to the initial free lists\n");
+  } else {
+    uart_puts("[mem-lab][page] free lists differ after freeing everything\n");
+    page_alloc_dump();
+    ok = false;
+  }
+
+  // Misuse is rejected without corrupting the lists.
+  void* p = alloc_pages(1);
+  if (!p || free_pages(p, 0) != -1 || free_pages(p, 1) != 0 || free_pages(p, 1) != -1 ||
+      free_pages(_heap_end, 0) != -1) {
+    uart_puts("[mem-lab][page] misuse not rejected\n");
+    ok = false;
+  }
+
+  // After the handoff the boot heap outgrows its 1 MiB linker region.
+  constexpr size_t kBig = 512 * 1024;
+  void* a = kmem_alloc_aligned(kBig, 4096);
+  void* b = kmem_alloc_aligned(kBig, 4096);
+  void* c = kmem_alloc_aligned(kBig, 4096);
+  if (!a || !b || !c) {
+    uart_puts("[mem-lab][page] kmem refill failed\n");
+    ok = false;
+  } else if (reinterpret_cast<uintptr_t>(c) >= reinterpret_cast<uintptr_t>(_heap_end)) {
+    uart_puts("[mem-lab][page] kmem refilled from pages\n");
+  }
+  page_alloc_dump();
+
+  uart_puts(ok ? "[mem-lab][page] PASS\n" : "[mem-lab][page] FAIL\n");
+  return ok;
+}
+
+// ---------- Mode 3: size-class kmalloc ----------
+static bool demo_kmalloc() {
+  uart_puts("[mem-lab][kmalloc] size-class heap demo\n");
+  bool ok = true;
+
+  // Every request lands in the smallest class that holds it.
+  constexpr size_t kSizes[] = {1, 16, 17, 40, 64, 65, 100, 200, 300, 500, 700, 1000, 1024};
+  constexpr size_t kExpect[] = {16, 16, 32, 48, 64, 96, 128, 256, 384, 512, 768, 1024, 1024};
+  for (size_t i = 0; i < sizeof(kSizes) / sizeof(kSizes[0]); ++i) {
+    void* p = kmalloc(kSizes[i], KM_ZERO);
+    if (!p || ksize(p) != kExpect[i] || (reinterpret_cast<uintptr_t>(p) & 15u) ||
+        static_cast<uint8_t*>(p)[kSizes[i] - 1u] != 0) {
+      put_u64("[mem-lab][kmalloc] bad class for size=", kSizes[i]);
+      ok = false;
+    }
+    kfree(p);
+  }
+
+  // Double free: the slab's allocation bitmap rejects the second kfree.
+  void* once = kmalloc(40, 0);
+  kmalloc_class_stats held, after;
+  kmalloc_class_stats_get(2, &held);  // 48-byte class
+  kfree(once);
+  kfree(once);
+  kmalloc_class_stats_get(2, &after);
+  if (once && after.in_use + 1u == held.in_use) {
+    uart_puts("[mem-lab][kmalloc] double free rejected\n");
+  } else {
+    ok = false;
+  }
+
+  // Grow a class well past one slab, then free everything: all but the spare
+  // slab must go back to the page allocator.
+  page_alloc_stats pages_before;
+  page_alloc_stats_get(&pages_before);
+  constexpr unsigned kObjs = 256;
+  constexpr size_t kObjSize = 200;
+  void* objs[kObjs] = {};
+  for (unsigned i = 0; i < kObjs; ++i) {
+    objs[i] = kmalloc(kObjSize, 0);
+    if (!objs[i]) ok = false;
+  }
+  kmalloc_class_stats grown;
+  kmalloc_class_stats_get(7, &grown);  // 256-byte class
+  put_u64("[mem-lab][kmalloc] slabs_grown=", grown.slabs);
+  put_u64("[mem-lab][kmalloc] in_use=", grown.in_use);
+  for (unsigned i = 0; i < kObjs; ++i) kfree(objs[i]);
+  kmalloc_class_stats shrunk;
+  kmalloc_class_stats_get(7, &shrunk);
+  put_u64("[mem-lab][kmalloc] slabs_shrunk=", shrunk.slabs);
+  page_alloc_stats pages_after;
+  page_alloc_stats_get(&pages_after);
+  if (grown.slabs > 1 && shrunk.slabs == 1 && shrunk.in_use == 0 &&
+      pages_after.free_pages + 1 >= pages_before.free_pages) {
+    uart_puts("[mem-lab][kmalloc] slabs shrank back to the spare\n");
+  } else {
+    ok = false;
+  }
+
+  // Large path: own page block, returned whole on kfree.
+  void* big = kmalloc(64 * 1024, KM_ZERO);
+  kmalloc_stats ls;
+  kmalloc_stats_get(&ls);
+  if (!big || ksize(big) < 64 * 1024 || ls.large_allocs != 1) ok = false;
+  kfree(big);
+  kmalloc_stats_get(&ls);
+  if (ls.large_allocs != 0 || ls.large_pages != 0) ok = false;
+
+  kmalloc_dump();
+  uart_puts(ok ? "[mem-lab][kmalloc] PASS\n" : "[mem-lab][kmalloc] FAIL\n");
+  return ok;
+}
+
+// ---------- Mode 4: per-CPU magazines in front of a mem_pool ----------
+static bool demo_magazines() {
+  uart_puts("[mem-lab][mag] magazine cache demo\n");
+  bool ok = true;
+
+  constexpr size_t kBlocks = 256;
+  constexpr size_t kBlockSize = 64;
+  void* backing = kmalloc(kBlocks * kBlockSize, 0);
+  mem_pool pool;
+  if (!backing || mem_pool_init(&pool, backing, kBlocks * kBlockSize, kBlockSize) != 0) {
+    uart_puts("[mem-lab][mag] pool setup failed\n");
+    return false;
+  }
+
+  // Bulk ops move a whole batch in one pass.
+  void* batch[32] = {};
+  const size_t got = mem_pool_alloc_bulk(&pool, batch, 32);
+  const size_t back = mem_pool_free_bulk(&pool, batch, got);
+  put_u64("[mem-lab][mag] bulk_alloc=", got);
+  put_u64("[mem-lab][mag] bulk_free=", back);
+  if (got != 32 || back != 32 || mem_pool_available(&pool) != kBlocks) ok = false;
+
+  // Same burst pattern twice: a pool behind an irqsave lock on every call,
+  // then the magazine cache, which locks only when it trades magazines.
+  constexpr unsigned kRounds = 2000;
+  constexpr unsigned kBurst = 24;
+  void* objs[kBurst] = {};
+  spinlock lock;
+  spin_init(&lock);
+  uint64_t t0 = arch_counter_read();
+  for (unsigned r = 0; r < kRounds; ++r) {
+    for (unsigned i = 0; i < kBurst; ++i) {
+      unsigned long flags = spin_lock_irqsave(&lock);
+      objs[i] = mem_pool_alloc(&pool);
+      spin_unlock_irqrestore(&lock, flags);
+    }
+    for (unsigned i = 0; i < kBurst; ++i) {
+      unsigned long flags = spin_lock_irqsave(&lock);
+      mem_pool_free(&pool, objs[i]);
+      spin_unlock_irqrestore(&lock, flags);
+    }
+  }
+  const uint64_t locked_ns = arch_counter_to_ns(arch_counter_read() - t0);
+
+  mag_cache cache;
+  mag_cache_init(&cache, &pool);
+  t0 = arch_counter_read();
+  for (unsigned r = 0; r < kRounds; ++r) {
+    for (unsigned i = 0; i < kBurst; ++i) {
+      objs[i] = mag_cache_alloc(&cache);
+      if (!objs[i]) ok = false;
+    }
+    for (unsigned i = 0; i < kBurst; ++i) {
+      if (mag_cache_free(&cache, objs[i]) != 0) ok = false;
+    }
+  }
+  const uint64_t mag_ns = arch_counter_to_ns(arch_counter_read() - t0);
+
+  mag_cache_stats s;
+  mag_cache_stats_get(&cache, &s);
+  const uint64_t ops = 2ull * kRounds * kBurst;
+  put_u64("[mem-lab][mag] ops=", ops);
+  put_u64("[mem-lab][mag] locked_ns_per_op=", locked_ns / ops);
+  put_u64("[mem-lab][mag] mag_ns_per_op=", mag_ns / ops);
+  put_u64("[mem-lab][mag] hits=", s.hits);
+  put_u64("[mem-lab][mag] depot_exchanges=", s.depot);
+  put_u64("[mem-lab][mag] pool_trips=", s.pool);
+  put_u64("[mem-lab][mag] cached=", s.cached);
+  if (s.hits * 10u < ops * 9u) {
+    uart_puts("[mem-lab][mag] hit rate below 90%\n");
+    ok = false;
+  }
+
+  mag_cache_drain(&cache);
+  if (mem_pool_available(&pool) != kBlocks) {
+    put_u64("[mem-lab][mag] blocks missing after drain: available=", mem_pool_available(&pool));
+    ok = false;
+  } else {
+    uart_puts("[mem-lab][mag] drain returned every block\n");
+  }
+  kfree(backing);
+
+  uart_puts(ok ? "[mem-lab][mag] PASS\n" : "[mem-lab][mag] FAIL\n");
+  return ok;
+}
+
+// ---------- Mode 5: constructed object cache with slab coloring ----------
+struct lab_obj {
+  uint32_t magic;      // set by the constructor, must survive free/alloc
+  uint32_t uses;
+  uint8_t  payload[200];
+};
+
+constexpr uint32_t kLabObjMagic = 0x6f626a31u;  // "obj1"
+
+static void lab_obj_ctor(void* p) {
+  auto* o = static_cast<lab_obj*>(p);
+  o->magic = kLabObjMagic;
+  o->uses = 0;
+}
+
+static bool demo_kmem_cache() {
+  uart_puts("[mem-lab][cache] object cache demo\n");
+  bool ok = true;
+
+  kmem_cache* c = kmem_cache_create("lab_obj", sizeof(lab_obj), 64, lab_obj_ctor);
+  if (!c) {
+    uart_puts("[mem-lab][cache] kmem_cache_create failed\n");
+    return false;
+  }
+  put_u64("[mem-lab][cache] per_slab=", c->per_slab);
+  put_u64("[mem-lab][cache] colors=", c->colors);
+
+  // Fill several slabs; the first object of each new slab should start at a
+  // different cache-line offset within its slab.
+  constexpr unsigned kSlabs = 4;
+  constexpr unsigned kMax = 256;
+  const unsigned n = static_cast<unsigned>(c->per_slab * kSlabs);
+  if (n > kMax) return false;
+  lab_obj* objs[kMax] = {};
+  const uintptr_t slab_mask = (PAGE_SIZE << c->slab_order) - 1u;
+  uintptr_t offsets[kSlabs] = {};
+  for (unsigned i = 0; i < n; ++i) {
+    objs[i] = static_cast<lab_obj*>(kmem_cache_alloc(c));
+    if (!objs[i] || objs[i]->magic != kLabObjMagic || (reinterpret_cast<uintptr_t>(objs[i]) & 63u)) {
+      ok = false;
+      continue;
+    }
+    objs[i]->uses++;
+    if (i % c->per_slab == 0) offsets[i / c->per_slab] = reinterpret_cast<uintptr_t>(objs[i]) & slab_mask;
+  }
+  unsigned distinct = 0;
+  for (unsigned s = 0; s < kSlabs; ++s) {
+    put_u64("[mem-lab][cache] first_obj_offset=", offsets[s]);
+    bool seen = false;
+    for (unsigned t = 0; t < s; ++t) seen = seen || offsets[t] == offsets[s];
+    if (!seen) distinct++;
+  }
+  const unsigned want = (c->colors < kSlabs) ? static_cast<unsigned>(c->colors) : kSlabs;
+  if (distinct == want) {
+    uart_puts("[mem-lab][cache] slab colors spread first objects\n");
+  } else {
+    ok = false;
+  }
+
+  // Freed objects keep their constructed state: no constructor runs again.
+  const uint64_t ctors = c->ctor_calls;
+  for (unsigned i = 0; i < n; ++i) {
+    if (!objs[i]) continue;
+    objs[i]->uses = 0;  // back to the constructed state
+    if (kmem_cache_free(c, objs[i]) != 0) ok = false;
+  }
+  lab_obj* again = static_cast<lab_obj*>(kmem_cache_alloc(c));
+  if (!again || again->magic != kLabObjMagic || again->uses != 0 || c->ctor_calls != ctors) {
+    ok = false;
+  } else {
+    uart_puts("[mem-lab][cache] reused object kept its constructed state\n");
+  }
+  kmem_cache_free(c, again);
+  if (kmem_cache_free(c, again) != -1) ok = false;  // double free
+  put_u64("[mem-lab][cache] slabs_after_free=", c->slabs);
+  kmem_cache_dump();
+
+  uart_puts(ok ? "[mem-lab][cache] PASS\n" : "[mem-lab][cache] FAIL\n");
+  return ok;
+}
+
+// ---------- Mode 6: TLSF vs the first-fit heap ----------
+struct op_latency {
+  uint64_t total_ns;
+  uint64_t max_ns;
+  uint64_t n;
+};
+
+static void op_record(op_latency* l, uint64_t t0) {
+  const uint64_t ns = arch_counter_to_ns(arch_counter_read() - t0);
+  l->total_ns += ns;
+  if (ns > l->max_ns) l->max_ns = ns;
+  l->n++;
+}
+
+static void op_print(const char* label, const op_latency& l) {
+  uart_puts(label);
+  uart_puts(" n="); uart_print_u64(l.n);
+  uart_puts(" avg_ns="); uart_print_u64(l.n ? l.total_ns / l.n : 0);
+  uart_puts(" max_ns="); uart_print_u64(l.max_ns);
+  uart_puts("\n");
+}
+
+// The same random mix of sizes against both heaps; each op is timed with
+// IRQs masked so only allocator work is measured.
+constexpr unsigned kTlsfSlots = 96;
+constexpr unsigned kTlsfOps = 6000;
+
+static size_t tlsf_lab_size(uint32_t* rng) {
+  const uint32_t r = lcg_next(rng);
+  // Mostly small objects, some buffers up to 4 KiB.
+  return ((r >> 8) % 8u == 0) ? 512u + (r >> 12) % 3584u : 16u + (r >> 12) % 240u;
+}
+
+static bool demo_tlsf() {
+  uart_puts("[mem-lab][tlsf] TLSF vs first-fit demo\n");
+  bool ok = true;
+
+  constexpr unsigned kOrder = 6;  // 256 KiB per heap
+  constexpr size_t kBytes = PAGE_SIZE << kOrder;
+  void* ff_mem = alloc_pages(kOrder);
+  void* tl_mem = alloc_pages(kOrder);
+  static tlsf_heap heap;
+  if (!ff_mem || !tl_mem || tlsf_init(&heap, tl_mem, kBytes) != 0) {
+    uart_puts("[mem-lab][tlsf] heap setup failed\n");
+    return false;
+  }
+  heap_init(ff_mem, kBytes);
+  tlsf_report fresh;
+  tlsf_report_get(&heap, &fresh);
+
+  op_latency ff_alloc{}, ff_free{}, tl_alloc{}, tl_free{};
+  size_t ff_steps_max = 0;
+  void* ff[kTlsfSlots] = {};
+  void* tl[kTlsfSlots] = {};
+  uint32_t rng = 0x7157u;
+  for (unsigned op = 0; op < kTlsfOps; ++op) {
+    const unsigned i = (lcg_next(&rng) >> 8) % kTlsfSlots;
+    if (tl[i]) {
+      unsigned long flags = local_irq_save();
+      uint64_t t0 = arch_counter_read();
+      heap_free(ff_mem, kBytes, ff[i]);
+      op_record(&ff_free, t0);
+      t0 = arch_counter_read();
+      tlsf_free(&heap, tl[i]);
+      op_record(&tl_free, t0);
+      local_irq_restore(flags);
+      ff[i] = nullptr;
+      tl[i] = nullptr;
+      continue;
+    }
+    const size_t size = tlsf_lab_size(&rng);
+    size_t steps = 0;
+    unsigned long flags = local_irq_save();
+    uint64_t t0 = arch_counter_read();
+    ff[i] = heap_alloc_first_fit(ff_mem, kBytes, size, &steps);
+    op_record(&ff_alloc, t0);
+    t0 = arch_counter_read();
+    tl[i] = tlsf_malloc(&heap, size);
+    op_record(&tl_alloc, t0);
+    local_irq_restore(flags);
+    if (steps > ff_steps_max) ff_steps_max = steps;
+    // Keep the two heaps on the same live set.
+    if (!ff[i] || !tl[i]) {
+      heap_free(ff_mem, kBytes, ff[i]);
+      tlsf_free(&heap, tl[i]);
+      ff[i] = nullptr;
+      tl[i] = nullptr;
+      continue;
+    }
+    if (tlsf_block_size(tl[i]) < size || (reinterpret_cast<uintptr_t>(tl[i]) & 15u)) ok = false;
+    *static_cast<uint8_t*>(tl[i]) = static_cast<uint8_t>(i);
+  }
+  op_print("[mem-lab][tlsf] first_fit alloc", ff_alloc);
+  op_print("[mem-lab][tlsf] first_fit free ", ff_free);
+  op_print("[mem-lab][tlsf] tlsf alloc     ", tl_alloc);
+  op_print("[mem-lab][tlsf] tlsf free      ", tl_free);
+  put_u64("[mem-lab][tlsf] first_fit_steps_max=", ff_steps_max);
+
+  size_t ff_free_bytes = 0, ff_largest = 0, ff_blocks = 0;
+  heap_stats(ff_mem, kBytes, &ff_free_bytes, &ff_largest, &ff_blocks);
+  put_u64("[mem-lab][tlsf] first_fit_free_blocks=", ff_blocks);
+  put_u64("[mem-lab][tlsf] first_fit_frag_pct=",
+          ff_free_bytes ? ((ff_free_bytes - ff_largest) * 100u) / ff_free_bytes : 0);
+  tlsf_report_print("[mem-lab][tlsf] report", &heap);
+
+  // Live blocks kept their contents.
+  for (unsigned i = 0; i < kTlsfSlots; ++i) {
+    if (tl[i] && *static_cast<uint8_t*>(tl[i]) != static_cast<uint8_t>(i)) ok = false;
+  }
+
+  // Immediate coalescing: with everything freed the heap is one block again.
+  for (unsigned i = 0; i < kTlsfSlots; ++i) {
+    heap_free(ff_mem, kBytes, ff[i]);
+    tlsf_free(&heap, tl[i]);
+  }
+  tlsf_report done;
+  tlsf_report_get(&heap, &done);
+  if (done.free_blocks == 1 && done.largest_free == fresh.largest_free && done.used_blocks == 0) {
+    uart_puts("[mem-lab][tlsf] heap coalesced back to one block\n");
+  } else {
+    ok = false;
+  }
+
+  // Double free and foreign pointers are caught by the header check.
+  void* p = tlsf_malloc(&heap, 100);
+  tlsf_free(&heap, p);
+  tlsf_free(&heap, p);
+  alignas(16) uint64_t foreign[4] = {};
+  tlsf_free(&heap, &foreign[2]);
+  tlsf_report_get(&heap, &done);
+  put_u64("[mem-lab][tlsf] bad_frees=", done.bad_frees);
+  if (done.bad_frees != 2) ok = false;
+
+  free_pages(ff_mem, kOrder);
+  free_pages(tl_mem, kOrder);
+
+  // With KMALLOC_TLSF=1 kmalloc itself runs on TLSF and reports no classes.
+  kmalloc_stats ks;
+  kmalloc_stats_get(&ks);
+  if (ks.classes == 0) kmalloc_dump();
+  uart_puts(ok ? "[mem-lab][tlsf] PASS\n" : "[mem-lab][tlsf] FAIL\n");
+  return ok;
+}
+
+// ---------- Mode 7: typed static pools ----------
+struct lab_msg {
+  uint32_t id;
+  uint32_t len;
+  uint8_t  payload[56];
+};
+
+constexpr size_t kLabMsgs = 8;
+StaticPool<lab_msg, kLabMsgs> g_lab_msgs;  // .bss, usable without init
+static_assert(decltype(g_lab_msgs)::slot_bytes() == sizeof(lab_msg), "slots are packed");
+static_assert(decltype(g_lab_msgs)::footprint() < kLabMsgs * sizeof(lab_msg) + 128,
+              "metadata stays small next to the storage");
+
+static bool demo_static_pool() {
+  uart_puts("[mem-lab][static] StaticPool<T, N> demo\n");
+  bool ok = true;
+  put_u64("[mem-lab][static] slot_bytes=", decltype(g_lab_msgs)::slot_bytes());
+  put_u64("[mem-lab][static] footprint=", decltype(g_lab_msgs)::footprint());
+
+  // Exhaust the pool; every object is distinct and maps to its own handle.
+  lab_msg* msgs[kLabMsgs] = {};
+  decltype(g_lab_msgs)::handle_t handles[kLabMsgs] = {};
+  for (size_t i = 0; i < kLabMsgs; ++i) {
+    msgs[i] = g_lab_msgs.alloc();
+    if (!msgs[i]) {
+      ok = false;
+      continue;
+    }
+    msgs[i]->id = static_cast<uint32_t>(100u + i);
+    handles[i] = g_lab_msgs.handle(msgs[i]);
+    if (handles[i] == 0 || g_lab_msgs.from_handle(handles[i]) != msgs[i]) ok = false;
+  }
+  if (g_lab_msgs.alloc() != nullptr) ok = false;  // exhausted
+  if (ok) uart_puts("[mem-lab][static] handles round-trip\n");
+
+  // A freed object keeps its contents; its handle goes stale until reuse.
+  lab_msg* victim = msgs[3];
+  if (g_lab_msgs.free(victim) != 0 || g_lab_msgs.from_handle(handles[3]) != nullptr) ok = false;
+  if (g_lab_msgs.free(victim) != -1) ok = false;  // double free
+  lab_msg outside = {};
+  if (g_lab_msgs.free(&outside) != -1 || g_lab_msgs.owns(&outside)) ok = false;
+  lab_msg* again = g_lab_msgs.alloc();
+  if (again != victim || again->id != 103u) ok = false;
+  // Same slot, new generation: the old handle stays stale.
+  if (g_lab_msgs.from_handle(handles[3]) != nullptr || g_lab_msgs.handle(again) == handles[3]) ok = false;
+  if (ok) uart_puts("[mem-lab][static] handle to a reused slot rejected\n");
+
+  for (size_t i = 0; i < kLabMsgs; ++i) {
+    if (g_lab_msgs.free(msgs[i]) != 0) ok = false;
+  }
+  static_pool_stats st;
+  g_lab_msgs.stats(&st);
+  static_pool_print("lab_msg", &st);
+  if (st.in_use != 0 || st.high_water != kLabMsgs || st.failed != 1 || st.bad_frees != 2) ok = false;
+
+  uart_puts(ok ? "[mem-lab][static] PASS\n" : "[mem-lab][static] FAIL\n");
+  return ok;
+}
+
+// ---------- Mode 8: request-scoped arenas and memory resources ----------
+struct lab_token {
+  uint32_t kind;
+  uint32_t value;
+};
+
+// One "request": parse into a token vector, queue work items, use scratch
+// space, then let the scope drop all of it at once.
+static bool lab_handle_request(arena_resource* arena, uint32_t* seed, uint64_t* checksum) {
+  ArenaScope scope(arena);
+  SmallVector<lab_token, 8> tokens(&arena->res);
+  const uint32_t n = 4u + (lcg_next(seed) % 200u);
+  for (uint32_t i = 0; i < n; ++i) {
+    if (!tokens.push_back(lab_token{i & 3u, lcg_next(seed) >> 8})) return false;
+  }
+  Ring<uint32_t> work;
+  if (!work.init(&arena->res, 32)) return false;
+  auto* scratch = static_cast<uint8_t*>(mr_allocate(&arena->res, 512, 64));
+  if (!scratch || (reinterpret_cast<uintptr_t>(scratch) & 63u)) return false;
+  for (const lab_token& t : tokens) {
+    if (t.kind == 0 && !work.push(t.value)) break;
+  }
+  uint32_t v;
+  while (work.pop(&v)) *checksum += v;
+  scratch[0] = static_cast<uint8_t>(n);
+  return tokens.size() == n;
+}
+
+static bool demo_mem_resource() {
+  uart_puts("[mem-lab][arena] memory resource demo\n");
+  bool ok = true;
+
+  // Warm the kmalloc class timed below so its slab exists before the page
+  // snapshot.
+  constexpr unsigned kObjs = 64;
+  void* objs[kObjs];
+  for (unsigned i = 0; i < kObjs; ++i) objs[i] = kmalloc(48, 0);
+  for (unsigned i = 0; i < kObjs; ++i) kfree(objs[i]);
+
+  page_alloc_stats before;
+  page_alloc_stats_get(&before);
+
+  alignas(16) uint8_t initial[1024];
+  arena_resource arena;
+  arena_init(&arena, initial, sizeof(initial), nullptr);
+
+  // Every request spills past the stack buffer into page chunks and leaves
+  // nothing behind when its scope ends.
+  constexpr unsigned kRequests = 200;
+  uint32_t seed = 0x5eedu;
+  uint64_t checksum = 0;
+  bool rewound = true;
+  for (unsigned r = 0; r < kRequests; ++r) {
+    if (!lab_handle_request(&arena, &seed, &checksum)) ok = false;
+    if (arena.used != 0 || arena.nr_chunks != 0) rewound = false;
+  }
+  put_u64("[mem-lab][arena] requests=", kRequests);
+  put_u64("[mem-lab][arena] peak_bytes=", arena.peak);
+  put_u64("[mem-lab][arena] allocs=", arena.allocs);
+  if (arena.peak <= sizeof(initial)) ok = false;
+  if (rewound) uart_puts("[mem-lab][arena] every request rewound to empty\n");
+  ok = ok && rewound;
+
+  // Nested scopes: the inner rewind keeps what the outer scope allocated.
+  void* outer = mr_allocate(&arena.res, 3000, 16);
+  {
+    ArenaScope inner(&arena);
+    if (!mr_allocate(&arena.res, 20000, 16)) ok = false;
+  }
+  void* next = mr_allocate(&arena.res, 16, 16);
+  if (!outer || reinterpret_cast<uint8_t*>(next) < reinterpret_cast<uint8_t*>(outer) + 3000) ok = false;
+  arena_release(&arena);
+
+  // Cost per object: bump + one rewind against kmalloc/kfree pairs.
+  constexpr unsigned kRounds = 50;
+  unsigned long flags = local_irq_save();
+  uint64_t t0 = arch_counter_read();
+  for (unsigned r = 0; r < kRounds; ++r) {
+    ArenaScope scope(&arena);
+    for (unsigned i = 0; i < kObjs; ++i) objs[i] = mr_allocate(&arena.res, 48, 16);
+  }
+  const uint64_t arena_ns = arch_counter_to_ns(arch_counter_read() - t0);
+  t0 = arch_counter_read();
+  for (unsigned r = 0; r < kRounds; ++r) {
+    for (unsigned i = 0; i < kObjs; ++i) objs[i] = kmalloc(48, 0);
+    for (unsigned i = 0; i < kObjs; ++i) kfree(objs[i]);
+  }
+  const uint64_t kmalloc_ns = arch_counter_to_ns(arch_counter_read() - t0);
+  local_irq_restore(flags);
+  put_u64("[mem-lab][arena] arena_ns_per_obj=", arena_ns / (kRounds * kObjs));
+  put_u64("[mem-lab][arena] kmalloc_ns_per_obj=", kmalloc_ns / (kRounds * kObjs));
+  arena_release(&arena);
+
+  // The same containers over a fixed-size pool and over whole pages.
+  alignas(16) uint8_t pool_mem[4 * 128];
+  mem_pool pool;
+  pool_resource pres;
+  if (mem_pool_init(&pool, pool_mem, sizeof(pool_mem), 128) != 0) ok = false;
+  pool_resource_init(&pres, &pool);
+  {
+    Ring<uint64_t> fits;
+    Ring<uint64_t> too_big;
+    if (!fits.init(&pres.res, 16) || too_big.init(&pres.res, 32)) ok = false;
+    SmallVector<uint64_t, 2> spill(&pres.res);
+    for (uint64_t i = 0; i < 16; ++i) {
+      if (!spill.push_back(i)) ok = false;
+    }
+    if (spill.push_back(16) || !spill.on_heap() || spill.size() != 16) ok = false;  // pool block full
+    if (mem_pool_available(&pool) != 2) ok = false;
+  }
+  if (mem_pool_available(&pool) != 4) ok = false;
+  {
+    Ring<uint64_t> big;
+    if (!big.init(page_resource(), 1000) || big.capacity() != 1024) ok = false;
+    for (uint64_t i = 0; i < 1024; ++i) big.push(i);
+    uint64_t sum = 0, v;
+    while (big.pop(&v)) sum += v;
+    if (sum != 1023u * 1024u / 2u) ok = false;
+  }
+
+  page_alloc_stats after;
+  page_alloc_stats_get(&after);
+  if (page_stats_equal(before, after)) {
+    uart_puts("[mem-lab][arena] pages returned on release\n");
+  } else {
+    ok = false;
+  }
+
+  uart_puts(ok ? "[mem-lab][arena] PASS\n" : "[mem-lab][arena] FAIL\n");
+  return ok;
+}
+
 static void print_embedded_malloc_takeaways() {
   uart_puts("[mem-lab] why embedded often avoids malloc/free:\n");
   uart_puts("  - unpredictable latency (first-fit search/coalesce steps vary)\n");
@@ -293,8 +973,24 @@ extern "C" void mem_lab_run(unsigned mode) {
   if (mode == 0) return;
 
   uart_puts("[mem-lab] begin\n");
-  demo_pool_internal_fragmentation();
-  demo_malloc_external_fragmentation();
-  print_embedded_malloc_takeaways();
+  if (mode == 2) {
+    demo_page_allocator();
+  } else if (mode == 3) {
+    demo_kmalloc();
+  } else if (mode == 4) {
+    demo_magazines();
+  } else if (mode == 5) {
+    demo_kmem_cache();
+  } else if (mode == 6) {
+    demo_tlsf();
+  } else if (mode == 7) {
+    demo_static_pool();
+  } else if (mode == 8) {
+    demo_mem_resource();
+  } else {
+    demo_pool_internal_fragmentation();
+    demo_malloc_external_fragmentation();
+    print_embedded_malloc_takeaways();
+  }
   uart_puts("[mem-lab] end\n");
 }
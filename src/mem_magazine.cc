@@ -0,0 +1,236 @@
+#include "mem_magazine.h"
+
+#include <stdint.h>
+
+#include "arch/irqflags.h"
+#include "kmalloc.h"
+
+namespace {
+static_assert(sizeof(magazine) == 128, "magazine should fill one kmalloc class exactly");
+
+static inline mag_cpu* this_cpu(mag_cache* c) {
+  return &c->cpu[smp_processor_id()];
+}
+
+static inline void mag_push(magazine** list, size_t* nr, magazine* m) {
+  m->next = *list;
+  *list = m;
+  (*nr)++;
+}
+
+static inline magazine* mag_pop(magazine** list, size_t* nr) {
+  magazine* m = *list;
+  if (m) {
+    *list = m->next;
+    m->next = nullptr;
+    (*nr)--;
+  }
+  return m;
+}
+
+static magazine* mag_new() {
+  auto* m = static_cast<magazine*>(kmalloc(sizeof(magazine), 0));
+  if (m) {
+    m->next = nullptr;
+    m->rounds = 0;
+  }
+  return m;
+}
+
+// Pool slow paths; the caller has local IRQs masked.
+static void mag_refill(mag_cache* c, magazine* m) {
+  spin_lock(&c->pool_lock);
+  m->rounds = static_cast<uint32_t>(mem_pool_alloc_bulk(c->pool, m->obj, MAG_ROUNDS));
+  spin_unlock(&c->pool_lock);
+}
+
+static void mag_flush(mag_cache* c, magazine* m) {
+  spin_lock(&c->pool_lock);
+  mem_pool_free_bulk(c->pool, m->obj, m->rounds);
+  spin_unlock(&c->pool_lock);
+  m->rounds = 0;
+}
+
+// Hand a full magazine to the depot, or flush it if the depot is at its cap.
+// Returns the magazine if it came back empty and is still the caller's.
+static magazine* depot_put_full(mag_cache* c, magazine* m) {
+  spin_lock(&c->depot_lock);
+  if (c->nr_full < MAG_DEPOT_MAX_FULL) {
+    mag_push(&c->full, &c->nr_full, m);
+    m = nullptr;
+  }
+  spin_unlock(&c->depot_lock);
+  if (m) mag_flush(c, m);
+  return m;
+}
+}  // namespace
+
+extern "C" int mag_cache_init(struct mag_cache* c, struct mem_pool* pool) {
+  if (!c || !pool) return -1;
+  c->pool = pool;
+  spin_init(&c->pool_lock);
+  spin_init(&c->depot_lock);
+  c->full = nullptr;
+  c->empty = nullptr;
+  c->nr_full = 0;
+  c->nr_empty = 0;
+  for (unsigned i = 0; i < SMP_MAX_CPUS; ++i) {
+    c->cpu[i] = mag_cpu{};
+  }
+  return 0;
+}
+
+extern "C" void* mag_cache_alloc(struct mag_cache* c) {
+  if (!c) return nullptr;
+  unsigned long flags = local_irq_save();
+  mag_cpu* mc = this_cpu(c);
+
+  magazine* m = mc->loaded;
+  if (!m || !m->rounds) {
+    if (mc->previous && mc->previous->rounds) {
+      mc->loaded = mc->previous;
+      mc->previous = m;
+    } else {
+      // Trade the empty previous magazine for a full one from the depot.
+      spin_lock(&c->depot_lock);
+      magazine* full = mag_pop(&c->full, &c->nr_full);
+      if (full && mc->previous) mag_push(&c->empty, &c->nr_empty, mc->previous);
+      spin_unlock(&c->depot_lock);
+      if (full) {
+        mc->previous = m;
+        mc->loaded = full;
+        mc->depot++;
+      } else {
+        if (!m) m = mc->loaded = mag_new();
+        if (!m) {
+          // No magazine to cache into: plain locked pool allocation.
+          spin_lock(&c->pool_lock);
+          void* p = mem_pool_alloc(c->pool);
+          spin_unlock(&c->pool_lock);
+          mc->pool++;
+          local_irq_restore(flags);
+          return p;
+        }
+        mag_refill(c, m);
+        mc->pool++;
+        if (!m->rounds) {
+          local_irq_restore(flags);
+          return nullptr;
+        }
+      }
+    }
+    m = mc->loaded;
+  } else {
+    mc->hits++;
+  }
+
+  void* p = m->obj[--m->rounds];
+  local_irq_restore(flags);
+  return p;
+}
+
+extern "C" int mag_cache_free(struct mag_cache* c, void* p) {
+  if (!c || !p || !mem_pool_owns(c->pool, p)) return -1;
+  unsigned long flags = local_irq_save();
+  mag_cpu* mc = this_cpu(c);
+
+  magazine* m = mc->loaded;
+  if (!m || m->rounds == MAG_ROUNDS) {
+    if (mc->previous && !mc->previous->rounds) {
+      mc->loaded = mc->previous;
+      mc->previous = m;
+    } else {
+      // Trade the full previous magazine for an empty one from the depot,
+      // growing the depot when it has none.
+      spin_lock(&c->depot_lock);
+      magazine* empty = mag_pop(&c->empty, &c->nr_empty);
+      spin_unlock(&c->depot_lock);
+      if (!empty) empty = mag_new();
+      if (empty) {
+        if (mc->previous) {
+          magazine* back = depot_put_full(c, mc->previous);
+          if (back) {
+            spin_lock(&c->depot_lock);
+            mag_push(&c->empty, &c->nr_empty, back);
+            spin_unlock(&c->depot_lock);
+            mc->pool++;
+          }
+        }
+        mc->previous = m;
+        mc->loaded = empty;
+        mc->depot++;
+      } else if (m) {
+        mag_flush(c, m);
+        mc->pool++;
+      } else {
+        spin_lock(&c->pool_lock);
+        const int rc = mem_pool_free(c->pool, p);
+        spin_unlock(&c->pool_lock);
+        mc->pool++;
+        local_irq_restore(flags);
+        return rc;
+      }
+    }
+    m = mc->loaded;
+  } else {
+    mc->hits++;
+  }
+
+  m->obj[m->rounds++] = p;
+  local_irq_restore(flags);
+  return 0;
+}
+
+extern "C" void mag_cache_drain(struct mag_cache* c) {
+  if (!c) return;
+  unsigned long flags = local_irq_save();
+  mag_cpu* mc = this_cpu(c);
+  magazine* mine[2] = {mc->loaded, mc->previous};
+  mc->loaded = nullptr;
+  mc->previous = nullptr;
+
+  spin_lock(&c->depot_lock);
+  magazine* full = c->full;
+  magazine* empty = c->empty;
+  c->full = nullptr;
+  c->empty = nullptr;
+  c->nr_full = 0;
+  c->nr_empty = 0;
+  spin_unlock(&c->depot_lock);
+
+  for (magazine* m : mine) {
+    if (!m) continue;
+    mag_flush(c, m);
+    kfree(m);
+  }
+  magazine* lists[2] = {full, empty};
+  for (magazine* head : lists) {
+    while (head) {
+      magazine* next = head->next;
+      if (head->rounds) mag_flush(c, head);
+      kfree(head);
+      head = next;
+    }
+  }
+  local_irq_restore(flags);
+}
+
+extern "C" void mag_cache_stats_get(struct mag_cache* c, struct mag_cache_stats* out) {
+  if (!c || !out) return;
+  *out = mag_cache_stats{};
+  unsigned long flags = local_irq_save();
+  for (unsigned i = 0; i < SMP_MAX_CPUS; ++i) {
+    const mag_cpu* mc = &c->cpu[i];
+    out->hits += mc->hits;
+    out->depot += mc->depot;
+    out->pool += mc->pool;
+    if (mc->loaded) out->cached += mc->loaded->rounds;
+    if (mc->previous) out->cached += mc->previous->rounds;
+  }
+  spin_lock(&c->depot_lock);
+  out->depot_full = c->nr_full;
+  out->depot_empty = c->nr_empty;
+  out->cached += c->nr_full * MAG_ROUNDS;
+  spin_unlock(&c->depot_lock);
+  local_irq_restore(flags);
+}
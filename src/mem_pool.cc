@@ -33,6 +33,38 @@ static inline void store_next(void* p, void* next) {
   *reinterpret_cast<void**>(p) = next;
 }
 
+// Block index of offset |off| from the pool base, or false if |off| is not a
+// block boundary. Offsets are below 2^32, which keeps the reciprocal exact
+// (Lemire, Kaser, Kurz: "Faster Remainder by Direct Computation", 2019).
+static inline bool block_index(const mem_pool* pool, uint64_t off, size_t* idx) {
+  if (pool->block_shift) {
+    if (off & (pool->block_size - 1u)) return false;
+    *idx = static_cast<size_t>(off >> pool->block_shift);
+    return true;
+  }
+  if (pool->div_magic * off >= pool->div_magic) return false;  // off % block_size != 0
+  *idx = static_cast<size_t>((static_cast<unsigned __int128>(pool->div_magic) * off) >> 64);
+  return true;
+}
+
+static inline size_t index_of(const mem_pool* pool, const void* p) {
+  size_t idx = 0;
+  block_index(pool, static_cast<uint64_t>(static_cast<const uint8_t*>(p) - pool->base), &idx);
+  return idx;
+}
+
+static inline bool bit_test(const uint64_t* bm, size_t i) {
+  return (bm[i / 64u] >> (i % 64u)) & 1u;
+}
+
+static inline void bit_set(uint64_t* bm, size_t i) {
+  bm[i / 64u] |= uint64_t{1} << (i % 64u);
+}
+
+static inline void bit_clear(uint64_t* bm, size_t i) {
+  bm[i / 64u] &= ~(uint64_t{1} << (i % 64u));
+}
+
 #if MEM_POOL_DEBUG
 static bool freelist_contains(void* head, const void* p) {
   for (void* it = head; it; it = load_next(it)) {
@@ -60,14 +92,20 @@ extern "C" int mem_pool_init(struct mem_pool* pool, void* backing, size_t backin
   size_t usable = backing_size - lost;
 
   const size_t blk = static_cast<size_t>(align_up(block_size, align));
-  if (blk == 0) return -1;
+  if (blk == 0 || blk > UINT32_MAX) return -1;
+  // Keep every offset below 2^32 for block_index().
+  constexpr size_t kMaxSpan = size_t{1} << 32;
+  if (usable > kMaxSpan) usable = kMaxSpan;
   const size_t count = usable / blk;
   if (count == 0) return -1;
 
   pool->base = reinterpret_cast<uint8_t*>(aligned);
-  pool->block_size = blk;
-  pool->block_count = count;
-  pool->free_count = count;
+  pool->bitmap = nullptr;
+  pool->block_size = static_cast<uint32_t>(blk);
+  pool->block_count = static_cast<uint32_t>(count);
+  pool->free_count = static_cast<uint32_t>(count);
+  pool->block_shift = is_pow2(blk) ? static_cast<uint32_t>(__builtin_ctzll(blk)) : 0u;
+  pool->div_magic = UINT64_MAX / blk + 1u;
 
   void* head = nullptr;
   for (size_t i = 0; i < count; ++i) {
@@ -79,12 +117,22 @@ extern "C" int mem_pool_init(struct mem_pool* pool, void* backing, size_t backin
   return 0;
 }
 
+extern "C" int mem_pool_attach_bitmap(struct mem_pool* pool, uint64_t* words, size_t nwords) {
+  if (!pool || !words || nwords < MEM_POOL_BITMAP_WORDS(pool->block_count)) return -1;
+  for (size_t w = 0; w < nwords; ++w) words[w] = 0;
+  for (size_t i = 0; i < pool->block_count; ++i) bit_set(words, i);
+  for (void* it = pool->free_list; it; it = load_next(it)) bit_clear(words, index_of(pool, it));
+  pool->bitmap = words;
+  return 0;
+}
+
 extern "C" void* mem_pool_alloc(struct mem_pool* pool) {
   if (!pool || !pool->free_list) return nullptr;
   void* p = pool->free_list;
   pool->free_list = load_next(p);
   if (pool->free_count) pool->free_count--;
   store_next(p, nullptr);
+  if (pool->bitmap) bit_set(pool->bitmap, index_of(pool, p));
   return p;
 }
 
@@ -93,8 +141,13 @@ extern "C" int mem_pool_free(struct mem_pool* pool, void* p) {
   if (!mem_pool_owns(pool, p)) return -1;
   if (pool->free_count >= pool->block_count) return -1;
 
+  if (pool->bitmap) {
+    const size_t idx = index_of(pool, p);
+    if (!bit_test(pool->bitmap, idx)) return -1;
+    bit_clear(pool->bitmap, idx);
+  }
 #if MEM_POOL_DEBUG
-  if (freelist_contains(pool->free_list, p)) {
+  else if (freelist_contains(pool->free_list, p)) {
     return -1;
   }
 #endif
@@ -105,14 +158,63 @@ extern "C" int mem_pool_free(struct mem_pool* pool, void* p) {
   return 0;
 }
 
+extern "C" size_t mem_pool_alloc_bulk(struct mem_pool* pool, void** out, size_t n) {
+  if (!pool || !out) return 0;
+  void* head = pool->free_list;
+  size_t got = 0;
+  while (got < n && head) {
+    void* next = load_next(head);
+    store_next(head, nullptr);
+    if (pool->bitmap) bit_set(pool->bitmap, index_of(pool, head));
+    out[got++] = head;
+    head = next;
+  }
+  pool->free_list = head;
+  pool->free_count -= static_cast<uint32_t>(got);
+  return got;
+}
+
+extern "C" size_t mem_pool_free_bulk(struct mem_pool* pool, void* const* blocks, size_t n) {
+  if (!pool || !blocks) return 0;
+  // Chain the accepted blocks privately, then splice the chain in once.
+  void* first = nullptr;
+  void* last = nullptr;
+  size_t freed = 0;
+  for (size_t i = 0; i < n; ++i) {
+    void* p = blocks[i];
+    if (!p || !mem_pool_owns(pool, p)) continue;
+    if (pool->free_count + freed >= pool->block_count) break;
+    if (pool->bitmap) {
+      const size_t idx = index_of(pool, p);
+      if (!bit_test(pool->bitmap, idx)) continue;
+      bit_clear(pool->bitmap, idx);
+    }
+#if MEM_POOL_DEBUG
+    else if (freelist_contains(pool->free_list, p) || freelist_contains(first, p)) {
+      continue;
+    }
+#endif
+    store_next(p, first);
+    first = p;
+    if (!last) last = p;
+    freed++;
+  }
+  if (first) {
+    store_next(last, pool->free_list);
+    pool->free_list = first;
+    pool->free_count += static_cast<uint32_t>(freed);
+  }
+  return freed;
+}
+
 extern "C" int mem_pool_owns(const struct mem_pool* pool, const void* p) {
   if (!pool || !pool->base || !p) return 0;
   const uintptr_t start = reinterpret_cast<uintptr_t>(pool->base);
-  const uintptr_t end = start + pool->block_count * pool->block_size;
+  const uintptr_t end = start + static_cast<size_t>(pool->block_count) * pool->block_size;
   const uintptr_t v = reinterpret_cast<uintptr_t>(p);
   if (v < start || v >= end) return 0;
-  const uintptr_t off = v - start;
-  return (off % pool->block_size) == 0u;
+  size_t idx;
+  return block_index(pool, v - start, &idx) ? 1 : 0;
 }
 
 extern "C" size_t mem_pool_block_size(const struct mem_pool* pool) {
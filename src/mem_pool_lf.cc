@@ -0,0 +1,102 @@
+#include "mem_pool_lf.h"
+
+#include <stdint.h>
+
+namespace {
+constexpr size_t kAlign = 16;
+constexpr uint64_t kIndexMask = 0xFFFFFFFFull;
+
+static inline uintptr_t align_up(uintptr_t v, uintptr_t a) {
+  return (v + a - 1u) & ~(a - 1u);
+}
+
+static inline uint32_t* link_of(const mem_pool_lf* pool, uint32_t idx1) {
+  return reinterpret_cast<uint32_t*>(pool->base + static_cast<size_t>(idx1 - 1u) * pool->block_size);
+}
+
+static inline uint64_t make_head(uint64_t old, uint32_t idx1) {
+  return ((old & ~kIndexMask) + (kIndexMask + 1u)) | idx1;
+}
+}  // namespace
+
+extern "C" int mem_pool_lf_init(struct mem_pool_lf* pool, void* backing, size_t backing_size,
+                                size_t block_size) {
+  if (!pool || !backing || backing_size == 0 || block_size == 0) return -1;
+
+  const uintptr_t raw = reinterpret_cast<uintptr_t>(backing);
+  const uintptr_t aligned = align_up(raw, kAlign);
+  const size_t lost = static_cast<size_t>(aligned - raw);
+  if (lost >= backing_size) return -1;
+  const size_t blk = static_cast<size_t>(align_up(block_size, kAlign));
+  size_t count = (backing_size - lost) / blk;
+  if (count == 0) return -1;
+  if (count > kIndexMask - 1u) count = kIndexMask - 1u;
+
+  pool->base = reinterpret_cast<uint8_t*>(aligned);
+  pool->block_size = blk;
+  pool->block_count = static_cast<uint32_t>(count);
+  pool->free_count = static_cast<uint32_t>(count);
+  pool->cas_retries = 0;
+  // Block i links to i + 1, so the first allocations come out in address order.
+  for (uint32_t i = 1; i <= pool->block_count; ++i) {
+    *link_of(pool, i) = (i < pool->block_count) ? i + 1u : 0u;
+  }
+  __atomic_store_n(&pool->head, uint64_t{1}, __ATOMIC_RELEASE);
+  return 0;
+}
+
+extern "C" void* mem_pool_lf_alloc(struct mem_pool_lf* pool) {
+  if (!pool) return nullptr;
+  uint64_t old = __atomic_load_n(&pool->head, __ATOMIC_ACQUIRE);
+  uint32_t idx1;
+  for (;;) {
+    idx1 = static_cast<uint32_t>(old & kIndexMask);
+    if (!idx1) return nullptr;
+    // The block may already belong to someone else and be scribbled on; the
+    // tag makes the CAS below fail in that case.
+    const uint32_t next = __atomic_load_n(link_of(pool, idx1), __ATOMIC_RELAXED);
+    if (__atomic_compare_exchange_n(&pool->head, &old, make_head(old, next), /*weak=*/true,
+                                    __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+      break;
+    }
+    __atomic_fetch_add(&pool->cas_retries, 1u, __ATOMIC_RELAXED);
+  }
+  __atomic_fetch_sub(&pool->free_count, 1u, __ATOMIC_RELAXED);
+  return link_of(pool, idx1);
+}
+
+extern "C" int mem_pool_lf_free(struct mem_pool_lf* pool, void* p) {
+  if (!mem_pool_lf_owns(pool, p)) return -1;
+  const size_t off = static_cast<size_t>(static_cast<uint8_t*>(p) - pool->base);
+  const uint32_t idx1 = static_cast<uint32_t>(off / pool->block_size) + 1u;
+  uint32_t* link = static_cast<uint32_t*>(p);
+
+  uint64_t old = __atomic_load_n(&pool->head, __ATOMIC_RELAXED);
+  for (;;) {
+    __atomic_store_n(link, static_cast<uint32_t>(old & kIndexMask), __ATOMIC_RELAXED);
+    if (__atomic_compare_exchange_n(&pool->head, &old, make_head(old, idx1), /*weak=*/true,
+                                    __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+      break;
+    }
+    __atomic_fetch_add(&pool->cas_retries, 1u, __ATOMIC_RELAXED);
+  }
+  __atomic_fetch_add(&pool->free_count, 1u, __ATOMIC_RELAXED);
+  return 0;
+}
+
+extern "C" int mem_pool_lf_owns(const struct mem_pool_lf* pool, const void* p) {
+  if (!pool || !pool->base || !p) return 0;
+  const uintptr_t start = reinterpret_cast<uintptr_t>(pool->base);
+  const uintptr_t end = start + static_cast<size_t>(pool->block_count) * pool->block_size;
+  const uintptr_t v = reinterpret_cast<uintptr_t>(p);
+  if (v < start || v >= end) return 0;
+  return ((v - start) % pool->block_size) == 0u;
+}
+
+extern "C" size_t mem_pool_lf_capacity(const struct mem_pool_lf* pool) {
+  return pool ? pool->block_count : 0;
+}
+
+extern "C" size_t mem_pool_lf_available(const struct mem_pool_lf* pool) {
+  return pool ? __atomic_load_n(&pool->free_count, __ATOMIC_RELAXED) : 0;
+}
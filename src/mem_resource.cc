@@ -0,0 +1,173 @@
+#include "mem_resource.h"
+
+#include <stdint.h>
+
+#include "page_alloc.h"
+
+// Sits at the start of every upstream chunk.
+struct arena_chunk {
+  arena_chunk* prev;
+  size_t       bytes;
+};
+
+namespace {
+constexpr size_t kMinAlign = 16;
+constexpr size_t kChunkHeader = (sizeof(arena_chunk) + kMinAlign - 1u) & ~(kMinAlign - 1u);
+
+static inline uintptr_t align_up(uintptr_t v, uintptr_t a) {
+  return (v + a - 1u) & ~(a - 1u);
+}
+
+static inline size_t fix_align(size_t align) {
+  return align < kMinAlign ? kMinAlign : align;
+}
+
+static inline uintptr_t chunk_start(arena_chunk* c) {
+  return reinterpret_cast<uintptr_t>(c) + kChunkHeader;
+}
+
+static inline uintptr_t chunk_end(arena_chunk* c) {
+  return reinterpret_cast<uintptr_t>(c) + c->bytes;
+}
+
+static bool arena_grow(arena_resource* a, size_t size, size_t align) {
+  size_t bytes = a->next_chunk;
+  const size_t need = kChunkHeader + size + align;
+  while (bytes < need) bytes <<= 1u;
+  void* mem = mr_allocate(a->upstream, bytes, kMinAlign);
+  if (!mem) return false;
+  auto* c = static_cast<arena_chunk*>(mem);
+  c->prev = a->chunks;
+  c->bytes = bytes;
+  a->chunks = c;
+  a->nr_chunks++;
+  a->cur = chunk_start(c);
+  a->end = chunk_end(c);
+  if (a->next_chunk < ARENA_CHUNK_MAX) a->next_chunk <<= 1u;
+  return true;
+}
+
+static void* arena_allocate(mem_resource* r, size_t size, size_t align) {
+  auto* a = reinterpret_cast<arena_resource*>(r);
+  align = fix_align(align);
+  uintptr_t p = align_up(a->cur, align);
+  if (p + size > a->end || p < a->cur) {
+    if (!arena_grow(a, size, align)) return nullptr;
+    p = align_up(a->cur, align);
+  }
+  a->used += (p + size) - a->cur;
+  if (a->used > a->peak) a->peak = a->used;
+  a->cur = p + size;
+  a->allocs++;
+  return reinterpret_cast<void*>(p);
+}
+
+static void arena_deallocate(mem_resource*, void*, size_t, size_t) {
+  // Monotonic: memory comes back on release or rewind only.
+}
+
+static void arena_release_op(mem_resource* r) {
+  arena_release(reinterpret_cast<arena_resource*>(r));
+}
+
+const mem_resource_ops kArenaOps = {arena_allocate, arena_deallocate, arena_release_op};
+
+static void free_chunks_until(arena_resource* a, arena_chunk* keep) {
+  while (a->chunks && a->chunks != keep) {
+    arena_chunk* c = a->chunks;
+    a->chunks = c->prev;
+    a->nr_chunks--;
+    mr_deallocate(a->upstream, c, c->bytes, kMinAlign);
+  }
+  // Chunk sizes double per live chunk, so after a rewind the next request
+  // grows the same way the previous one did.
+  a->next_chunk = ARENA_CHUNK_MIN;
+  for (size_t i = 0; i < a->nr_chunks && a->next_chunk < ARENA_CHUNK_MAX; ++i) a->next_chunk <<= 1u;
+}
+
+static void* pool_allocate(mem_resource* r, size_t size, size_t align) {
+  auto* pr = reinterpret_cast<pool_resource*>(r);
+  if (size > mem_pool_block_size(pr->pool) || fix_align(align) > kMinAlign) return nullptr;
+  return mem_pool_alloc(pr->pool);
+}
+
+static void pool_deallocate(mem_resource* r, void* p, size_t, size_t) {
+  mem_pool_free(reinterpret_cast<pool_resource*>(r)->pool, p);
+}
+
+const mem_resource_ops kPoolOps = {pool_allocate, pool_deallocate, nullptr};
+
+// Buddy blocks are aligned to their own size, which covers any |align| up
+// to that size.
+static unsigned page_order(size_t size, size_t align) {
+  return page_order_for(size > align ? size : align);
+}
+
+static void* page_allocate(mem_resource*, size_t size, size_t align) {
+  const unsigned order = page_order(size, align);
+  return (order <= PAGE_ORDER_MAX) ? alloc_pages(order) : nullptr;
+}
+
+static void page_deallocate(mem_resource*, void* p, size_t size, size_t align) {
+  free_pages(p, page_order(size, align));
+}
+
+const mem_resource_ops kPageOps = {page_allocate, page_deallocate, nullptr};
+mem_resource g_page_resource = {&kPageOps, "pages"};
+}  // namespace
+
+extern "C" void arena_init(struct arena_resource* a, void* buf, size_t bytes,
+                           struct mem_resource* upstream) {
+  if (!a) return;
+  a->res.ops = &kArenaOps;
+  a->res.name = "arena";
+  a->upstream = upstream ? upstream : &g_page_resource;
+  a->initial = static_cast<uint8_t*>(buf);
+  a->initial_bytes = buf ? bytes : 0;
+  a->chunks = nullptr;
+  a->cur = reinterpret_cast<uintptr_t>(a->initial);
+  a->end = a->cur + a->initial_bytes;
+  a->next_chunk = ARENA_CHUNK_MIN;
+  a->used = 0;
+  a->peak = 0;
+  a->nr_chunks = 0;
+  a->allocs = 0;
+}
+
+extern "C" void arena_release(struct arena_resource* a) {
+  if (!a) return;
+  free_chunks_until(a, nullptr);
+  a->cur = reinterpret_cast<uintptr_t>(a->initial);
+  a->end = a->cur + a->initial_bytes;
+  a->used = 0;
+}
+
+extern "C" struct arena_mark arena_mark_get(const struct arena_resource* a) {
+  arena_mark m = {};
+  if (a) {
+    m.chunk = a->chunks;
+    m.cur = a->cur;
+    m.used = a->used;
+  }
+  return m;
+}
+
+extern "C" void arena_rewind(struct arena_resource* a, struct arena_mark m) {
+  if (!a) return;
+  free_chunks_until(a, m.chunk);
+  a->cur = m.cur;
+  a->end = m.chunk ? chunk_end(m.chunk)
+                   : reinterpret_cast<uintptr_t>(a->initial) + a->initial_bytes;
+  a->used = m.used;
+}
+
+extern "C" void pool_resource_init(struct pool_resource* r, struct mem_pool* pool) {
+  if (!r) return;
+  r->res.ops = &kPoolOps;
+  r->res.name = "pool";
+  r->pool = pool;
+}
+
+extern "C" struct mem_resource* page_resource(void) {
+  return &g_page_resource;
+}
@@ -0,0 +1,219 @@
+#include "page_alloc.h"
+
+#include <stdint.h>
+
+#include "drivers/uart_pl011.h"
+#include "kmem.h"
+#include "platform.h"
+#include "spinlock.h"
+
+extern "C" char __dma_nc_end[];
+extern "C" void* memset(void* dst, int c, size_t n);
+
+namespace {
+// Page map entries: a block head carries its state and order; every other
+// frame (block tails, the map itself, pages below the managed range) is 0, so
+// it never looks like a mergeable buddy.
+constexpr uint8_t kStateFree = 0x80u;
+constexpr uint8_t kStateAlloc = 0x40u;
+constexpr uint8_t kOrderMask = 0x0Fu;
+static_assert(PAGE_ORDER_MAX <= kOrderMask, "order must fit the page map");
+
+constexpr uintptr_t kMaxBlockBytes = PAGE_SIZE << PAGE_ORDER_MAX;
+
+struct free_block {
+  free_block* next;
+  free_block* prev;
+};
+
+spinlock g_lock;
+uintptr_t g_base = 0;       // aligned to kMaxBlockBytes so buddies are idx ^ (1 << order)
+size_t g_npages = 0;        // frames covered by the map, counted from g_base
+uint8_t* g_map = nullptr;
+free_block* g_free[PAGE_ORDER_MAX + 1];
+size_t g_free_blocks[PAGE_ORDER_MAX + 1];
+size_t g_total_pages = 0;
+size_t g_free_pages = 0;
+
+constexpr char kHexDigits[] = "0123456789abcdef";
+
+static void uart_puthex64(uint64_t value) {
+  if (value == 0) { uart_putc('0'); return; }
+  char buf[16]; int idx = 0;
+  while (value && idx < 16) { buf[idx++] = kHexDigits[value & 0xFu]; value >>= 4; }
+  while (idx--) uart_putc(buf[idx]);
+}
+
+static inline uintptr_t align_up(uintptr_t v, uintptr_t a) {
+  return (v + a - 1u) & ~(a - 1u);
+}
+
+static inline uintptr_t align_down(uintptr_t v, uintptr_t a) {
+  return v & ~(a - 1u);
+}
+
+static inline free_block* block_at(size_t idx) {
+  return reinterpret_cast<free_block*>(g_base + (idx << PAGE_SHIFT));
+}
+
+static inline size_t index_of(const void* p) {
+  return (reinterpret_cast<uintptr_t>(p) - g_base) >> PAGE_SHIFT;
+}
+
+static void push_free(size_t idx, unsigned order) {
+  free_block* b = block_at(idx);
+  b->prev = nullptr;
+  b->next = g_free[order];
+  if (b->next) b->next->prev = b;
+  g_free[order] = b;
+  g_free_blocks[order]++;
+  g_map[idx] = static_cast<uint8_t>(kStateFree | order);
+}
+
+static void remove_free(size_t idx, unsigned order) {
+  free_block* b = block_at(idx);
+  if (b->prev) {
+    b->prev->next = b->next;
+  } else {
+    g_free[order] = b->next;
+  }
+  if (b->next) b->next->prev = b->prev;
+  g_free_blocks[order]--;
+  g_map[idx] = 0;
+}
+
+// Seed [first, end) with the largest naturally aligned blocks that fit.
+static void add_range(size_t first, size_t end) {
+  size_t idx = first;
+  while (idx < end) {
+    unsigned order = PAGE_ORDER_MAX;
+    while (order && ((idx & ((1ul << order) - 1u)) || idx + (1ul << order) > end)) {
+      order--;
+    }
+    push_free(idx, order);
+    idx += 1ul << order;
+  }
+  g_total_pages += end - first;
+  g_free_pages += end - first;
+}
+}  // namespace
+
+extern "C" void page_alloc_init(void) {
+  spin_init(&g_lock);
+  for (unsigned o = 0; o <= PAGE_ORDER_MAX; ++o) {
+    g_free[o] = nullptr;
+    g_free_blocks[o] = 0;
+  }
+  g_total_pages = 0;
+  g_free_pages = 0;
+
+  uintptr_t ram_start = 0, ram_end = 0;
+  platform_ram_range(&ram_start, &ram_end);
+  uintptr_t lo = align_up(reinterpret_cast<uintptr_t>(__dma_nc_end), PAGE_SIZE);
+  if (lo < ram_start) lo = align_up(ram_start, PAGE_SIZE);
+  ram_end = align_down(ram_end, PAGE_SIZE);
+  if (lo >= ram_end) {
+    uart_puts("[page] no RAM above the kernel image\n");
+    return;
+  }
+
+  g_base = align_down(lo, kMaxBlockBytes);
+  g_npages = (ram_end - g_base) >> PAGE_SHIFT;
+  g_map = reinterpret_cast<uint8_t*>(lo);
+  memset(g_map, 0, g_npages);
+
+  const uintptr_t first = align_up(lo + g_npages, PAGE_SIZE);
+  if (first >= ram_end) {
+    uart_puts("[page] no RAM left after the page map\n");
+    g_map = nullptr;
+    return;
+  }
+  add_range(index_of(reinterpret_cast<void*>(first)), g_npages);
+
+  uart_puts("[page] range=[0x"); uart_puthex64(first);
+  uart_puts(" .. 0x"); uart_puthex64(ram_end);
+  uart_puts("] pages="); uart_print_u64(g_total_pages);
+  uart_puts(" map_bytes="); uart_print_u64(g_npages);
+  uart_puts("\n");
+
+  kmem_handoff();
+}
+
+extern "C" void* alloc_pages(unsigned order) {
+  if (order > PAGE_ORDER_MAX || !g_map) return nullptr;
+
+  unsigned long flags = spin_lock_irqsave(&g_lock);
+  unsigned o = order;
+  while (o <= PAGE_ORDER_MAX && !g_free[o]) o++;
+  if (o > PAGE_ORDER_MAX) {
+    spin_unlock_irqrestore(&g_lock, flags);
+    return nullptr;
+  }
+
+  const size_t idx = index_of(g_free[o]);
+  remove_free(idx, o);
+  while (o > order) {
+    o--;
+    push_free(idx + (1ul << o), o);
+  }
+  g_map[idx] = static_cast<uint8_t>(kStateAlloc | order);
+  g_free_pages -= 1ul << order;
+  spin_unlock_irqrestore(&g_lock, flags);
+  return block_at(idx);
+}
+
+extern "C" int free_pages(void* p, unsigned order) {
+  if (!p || order > PAGE_ORDER_MAX || !g_map) return -1;
+  const uintptr_t v = reinterpret_cast<uintptr_t>(p);
+  if (v < g_base || (v & (PAGE_SIZE - 1u))) return -1;
+  size_t idx = index_of(p);
+  if (idx >= g_npages || (idx & ((1ul << order) - 1u))) return -1;
+
+  unsigned long flags = spin_lock_irqsave(&g_lock);
+  if (g_map[idx] != (kStateAlloc | order)) {
+    spin_unlock_irqrestore(&g_lock, flags);
+    return -1;
+  }
+  g_map[idx] = 0;
+  g_free_pages += 1ul << order;
+
+  while (order < PAGE_ORDER_MAX) {
+    const size_t buddy = idx ^ (1ul << order);
+    if (buddy >= g_npages || g_map[buddy] != (kStateFree | order)) break;
+    remove_free(buddy, order);
+    idx &= ~(1ul << order);
+    order++;
+  }
+  push_free(idx, order);
+  spin_unlock_irqrestore(&g_lock, flags);
+  return 0;
+}
+
+extern "C" unsigned page_order_for(size_t bytes) {
+  unsigned order = 0;
+  while (order <= PAGE_ORDER_MAX && (PAGE_SIZE << order) < bytes) order++;
+  return order;
+}
+
+extern "C" void page_alloc_stats_get(struct page_alloc_stats* out) {
+  if (!out) return;
+  unsigned long flags = spin_lock_irqsave(&g_lock);
+  out->total_pages = g_total_pages;
+  out->free_pages = g_free_pages;
+  for (unsigned o = 0; o <= PAGE_ORDER_MAX; ++o) {
+    out->free_blocks[o] = g_free_blocks[o];
+  }
+  spin_unlock_irqrestore(&g_lock, flags);
+}
+
+extern "C" void page_alloc_dump(void) {
+  page_alloc_stats s;
+  page_alloc_stats_get(&s);
+  uart_puts("[page] total="); uart_print_u64(s.total_pages);
+  uart_puts(" free="); uart_print_u64(s.free_pages);
+  uart_puts(" blocks:");
+  for (unsigned o = 0; o <= PAGE_ORDER_MAX; ++o) {
+    uart_puts(" "); uart_print_u64(s.free_blocks[o]);
+  }
+  uart_puts("\n");
+}
@@ -52,6 +52,12 @@ extern "C" void platform_early_init(void) {
   gpio_init_pl011_uart0();
 }
 
+extern "C" void platform_ram_range(uintptr_t* start, uintptr_t* end) {
+  // Low 1 GiB minus the VideoCore carve-out with the default gpu_mem=76.
+  *start = 0;
+  *end = 0x3B400000ull;
+}
+
 extern "C" void platform_irq_init(void) {
   // TODO: BCM2711 interrupt controller (RPi4) bring-up.
 }
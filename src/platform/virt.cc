@@ -1,5 +1,7 @@
 #include "platform.h"
 
+#include <stdint.h>
+
 #include "arch/gicv3.h"
 #include "drivers/uart_pl011.h"
 
@@ -13,6 +15,20 @@ extern "C" void platform_early_init(void) {
   uart_pl011_set_clock_hz(24000000u);
 }
 
+#ifndef VIRT_RAM_MB
+#define VIRT_RAM_MB 512
+#endif
+
+extern "C" void platform_ram_range(uintptr_t* start, uintptr_t* end) {
+  // Must match QEMU -m. The MMU maps 1 GiB of cacheable RAM at 0x4000_0000.
+  constexpr uintptr_t kRamBase = 0x40000000ull;
+  constexpr uintptr_t kMappedBytes = 1ull << 30;
+  uintptr_t bytes = static_cast<uintptr_t>(VIRT_RAM_MB) << 20;
+  if (bytes > kMappedBytes) bytes = kMappedBytes;
+  *start = kRamBase;
+  *end = kRamBase + bytes;
+}
+
 extern "C" void platform_irq_init(void) {
   gic_init();
 }
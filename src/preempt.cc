@@ -1,12 +1,19 @@
 #include "preempt.h"
 
 #include "arch/cpu_local.h"
+#include "irqsoff_trace.h"
 #include "thread.h"
 
 extern "C" void preempt_disable(void) {
   auto* cpu = cpu_local();
   cpu->preempt_cnt++;
   __asm__ __volatile__("" ::: "memory");
+#if IRQSOFF_TRACE
+  // Handlers run non-preemptible anyway; only thread sections count.
+  if (cpu->preempt_cnt == 1 && !cpu->irq_depth) {
+    trace_preempt_off(reinterpret_cast<uintptr_t>(__builtin_return_address(0)));
+  }
+#endif
 }
 
 extern "C" void preempt_enable(void) {
@@ -15,15 +22,13 @@ extern "C" void preempt_enable(void) {
   if (cpu->preempt_cnt == 0) {
     return;
   }
+#if IRQSOFF_TRACE
+  if (cpu->preempt_cnt == 1 && !cpu->irq_depth) {
+    trace_preempt_on(reinterpret_cast<uintptr_t>(__builtin_return_address(0)));
+  }
+#endif
   cpu->preempt_cnt--;
   if (cpu->preempt_cnt == 0 && cpu->need_resched && cpu->irq_depth == 0) {
     sched_resched_from_irq_tail();
   }
 }
-
-extern "C" void preempt_return(void) {
-  auto* cpu = cpu_local();
-  if (cpu->preempt_cnt == 0 && cpu->need_resched) {
-    sched_resched_from_irq_tail();
-  }
-}
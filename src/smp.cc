@@ -0,0 +1,192 @@
+#include "smp.h"
+
+#include "arch/cpu_local.h"
+#include "arch/gicv3.h"
+#include "arch/irqflags.h"
+#include "drivers/uart_pl011.h"
+#include "irq.h"
+#include "preempt.h"
+
+namespace {
+constexpr uint32_t kCsdLocked = 1u;
+
+struct call_queue {
+  call_single_data* head;   // LIFO, pushed by any CPU, detached by the owner
+};
+
+call_queue g_call_queue[SMP_MAX_CPUS];
+// Per (sender, target) slots for calls that do not wait.
+call_single_data g_csd_async[SMP_MAX_CPUS][SMP_MAX_CPUS];
+cpumask_t g_online_mask = 1u;
+uint64_t g_ipi_resched[SMP_MAX_CPUS];
+uint64_t g_ipi_call[SMP_MAX_CPUS];
+
+static inline void cpu_relax() {
+  asm volatile("yield" ::: "memory");
+}
+
+static inline bool csd_busy(const call_single_data* csd) {
+  return (__atomic_load_n(&csd->flags, __ATOMIC_ACQUIRE) & kCsdLocked) != 0;
+}
+
+static void csd_lock(call_single_data* csd) {
+  while (csd_busy(csd)) {
+    cpu_relax();
+  }
+  csd->flags = kCsdLocked;
+}
+
+static void csd_wait(const call_single_data* csd) {
+  while (csd_busy(csd)) {
+    cpu_relax();
+  }
+}
+
+// Returns true if the queue was empty, i.e. the target needs an IPI.
+static bool call_queue_push(unsigned cpu, call_single_data* csd) {
+  call_queue* q = &g_call_queue[cpu];
+  call_single_data* old = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+  do {
+    csd->next = old;
+  } while (!__atomic_compare_exchange_n(&q->head, &old, csd, /*weak=*/true, __ATOMIC_RELEASE,
+                                        __ATOMIC_RELAXED));
+  return old == nullptr;
+}
+
+static void ipi_call_func_handler(uint32_t, void*) {
+  const unsigned cpu = smp_processor_id();
+  g_ipi_call[cpu]++;
+  call_single_data* list = __atomic_exchange_n(&g_call_queue[cpu].head, nullptr, __ATOMIC_ACQUIRE);
+
+  call_single_data* fifo = nullptr;
+  while (list) {
+    call_single_data* next = list->next;
+    list->next = fifo;
+    fifo = list;
+    list = next;
+  }
+  while (fifo) {
+    call_single_data* next = fifo->next;  // |fifo| may be reused once unlocked
+    fifo->func(fifo->info);
+    __atomic_store_n(&fifo->flags, 0u, __ATOMIC_RELEASE);
+    fifo = next;
+  }
+}
+
+static void ipi_resched_handler(uint32_t, void*) {
+  auto* cpu = cpu_local();
+  g_ipi_resched[cpu->cpu_id]++;
+  cpu->need_resched = 1;
+}
+
+static inline bool cpu_online(unsigned cpu) {
+  return cpu < SMP_MAX_CPUS && (g_online_mask & (1u << cpu)) != 0;
+}
+}  // namespace
+
+extern "C" void smp_init(void) {
+  if (irq_register(IPI_SGI_RESCHEDULE, ipi_resched_handler, nullptr, IRQF_TRIGGER_EDGE) != 0 ||
+      irq_register(IPI_SGI_CALL_FUNC, ipi_call_func_handler, nullptr, IRQF_TRIGGER_EDGE) != 0) {
+    uart_puts("[smp] IPI registration failed\n");
+  }
+}
+
+extern "C" unsigned smp_processor_id(void) {
+  return cpu_local()->cpu_id;
+}
+
+extern "C" cpumask_t smp_online_mask(void) {
+  return __atomic_load_n(&g_online_mask, __ATOMIC_ACQUIRE);
+}
+
+extern "C" void smp_send_reschedule(unsigned cpu) {
+  if (!cpu_online(cpu)) return;
+  gic_send_sgi(IPI_SGI_RESCHEDULE, static_cast<uint16_t>(1u << cpu));
+}
+
+extern "C" int smp_call_function_single(unsigned cpu, smp_call_func_t func, void* info, int wait) {
+  if (!func || !cpu_online(cpu)) return -1;
+  preempt_disable();
+  const unsigned self = smp_processor_id();
+  if (cpu == self) {
+    unsigned long flags = local_irq_save();
+    func(info);
+    local_irq_restore(flags);
+    preempt_enable();
+    return 0;
+  }
+
+  call_single_data on_stack;
+  on_stack.flags = 0;
+  call_single_data* csd = wait ? &on_stack : &g_csd_async[self][cpu];
+  csd_lock(csd);
+  csd->func = func;
+  csd->info = info;
+  if (call_queue_push(cpu, csd)) {
+    gic_send_sgi(IPI_SGI_CALL_FUNC, static_cast<uint16_t>(1u << cpu));
+  }
+  if (wait) csd_wait(csd);
+  preempt_enable();
+  return 0;
+}
+
+extern "C" int smp_call_function_many(cpumask_t mask, smp_call_func_t func, void* info, int wait) {
+  if (!func) return 0;
+  preempt_disable();
+  const unsigned self = smp_processor_id();
+  mask &= smp_online_mask() & ~(1u << self);
+
+  uint16_t kick = 0;
+  int n = 0;
+  for (unsigned cpu = 0; cpu < SMP_MAX_CPUS; ++cpu) {
+    if (!(mask & (1u << cpu))) continue;
+    call_single_data* csd = &g_csd_async[self][cpu];
+    csd_lock(csd);
+    csd->func = func;
+    csd->info = info;
+    if (call_queue_push(cpu, csd)) {
+      kick = static_cast<uint16_t>(kick | (1u << cpu));
+    }
+    ++n;
+  }
+  gic_send_sgi(IPI_SGI_CALL_FUNC, kick);
+  if (wait) {
+    for (unsigned cpu = 0; cpu < SMP_MAX_CPUS; ++cpu) {
+      if (mask & (1u << cpu)) csd_wait(&g_csd_async[self][cpu]);
+    }
+  }
+  preempt_enable();
+  return n;
+}
+
+extern "C" void on_each_cpu(smp_call_func_t func, void* info, int wait) {
+  if (!func) return;
+  preempt_disable();
+  (void)smp_call_function_many(~0u, func, info, wait);
+  unsigned long flags = local_irq_save();
+  func(info);
+  local_irq_restore(flags);
+  preempt_enable();
+}
+
+extern "C" int smp_call_function_single_async(unsigned cpu, call_single_data* csd) {
+  if (!csd || !csd->func || !cpu_online(cpu)) return -1;
+  unsigned long flags = local_irq_save();
+  if (csd_busy(csd)) {
+    local_irq_restore(flags);
+    return -1;
+  }
+  csd->flags = kCsdLocked;
+  if (call_queue_push(cpu, csd)) {
+    gic_send_sgi(IPI_SGI_CALL_FUNC, static_cast<uint16_t>(1u << cpu));
+  }
+  local_irq_restore(flags);
+  return 0;
+}
+
+extern "C" uint64_t smp_ipi_count(unsigned sgi) {
+  const unsigned cpu = smp_processor_id();
+  if (sgi == IPI_SGI_RESCHEDULE) return g_ipi_resched[cpu];
+  if (sgi == IPI_SGI_CALL_FUNC) return g_ipi_call[cpu];
+  return 0;
+}
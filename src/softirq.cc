@@ -0,0 +1,125 @@
+#include "softirq.h"
+
+#include "arch/counter.h"
+#include "arch/cpu_local.h"
+#include "arch/irqflags.h"
+#include "drivers/uart_pl011.h"
+#include "irq.h"
+#include "preempt.h"
+#include "sync.h"
+#include "thread.h"
+
+#ifndef KSOFTIRQD_PRIO
+#define KSOFTIRQD_PRIO 28
+#endif
+
+namespace {
+softirq_fn_t g_softirq_vec[SOFTIRQ_NR];
+uint64_t g_softirq_runs[SOFTIRQ_NR];
+
+Thread* g_ksoftirqd = nullptr;
+semaphore g_ksoftirqd_wake;
+volatile int g_ksoftirqd_kicked = 0;
+
+static void wakeup_ksoftirqd() {
+  if (!g_ksoftirqd || g_ksoftirqd_kicked) return;
+  g_ksoftirqd_kicked = 1;
+  sem_up(&g_ksoftirqd_wake);
+}
+
+static void softirq_run_mask(unsigned pending) {
+  while (pending) {
+    const unsigned nr = static_cast<unsigned>(__builtin_ctz(pending));
+    pending &= pending - 1u;
+    if (g_softirq_vec[nr]) {
+      g_softirq_vec[nr]();
+    }
+    g_softirq_runs[nr]++;
+  }
+}
+
+static void ksoftirqd_main(void*) {
+  auto* cpu = cpu_local();
+  while (1) {
+    sem_down(&g_ksoftirqd_wake);
+    g_ksoftirqd_kicked = 0;
+    for (;;) {
+      preempt_disable();
+      unsigned long flags = local_irq_save();
+      const unsigned pending = cpu->softirq_pending;
+      cpu->softirq_pending = 0;
+      if (!pending) {
+        local_irq_restore(flags);
+        preempt_enable();
+        break;
+      }
+      // IRQ exits skip softirqs while in_softirq is set, so handlers never
+      // nest; they run here with IRQs enabled.
+      cpu->in_softirq = 1;
+      local_irq_restore(flags);
+      softirq_run_mask(pending);
+      cpu->in_softirq = 0;
+      preempt_enable();  // let higher-priority threads run between passes
+    }
+  }
+}
+}  // namespace
+
+extern "C" void softirq_init(void) {
+  for (unsigned i = 0; i < SOFTIRQ_NR; ++i) {
+    g_softirq_runs[i] = 0;
+  }
+  open_softirq(SOFTIRQ_TIMER, sched_run_timeouts);
+  sem_init(&g_ksoftirqd_wake, 0);
+  g_ksoftirqd_kicked = 0;
+  g_ksoftirqd = thread_create_prio(ksoftirqd_main, nullptr, 8 * 1024, KSOFTIRQD_PRIO);
+  if (!g_ksoftirqd) {
+    uart_puts("[softirq] ksoftirqd create failed\n");
+    return;
+  }
+  sched_add(g_ksoftirqd);
+}
+
+extern "C" void open_softirq(unsigned nr, softirq_fn_t fn) {
+  if (nr < SOFTIRQ_NR) g_softirq_vec[nr] = fn;
+}
+
+extern "C" void raise_softirq(unsigned nr) {
+  if (nr >= SOFTIRQ_NR) return;
+  auto* cpu = cpu_local();
+  unsigned long flags = local_irq_save();
+  cpu->softirq_pending |= 1u << nr;
+  // Outside IRQ and softirq context nobody else will notice the bit soon.
+  if (!cpu->irq_depth && !cpu->in_softirq) {
+    wakeup_ksoftirqd();
+  }
+  local_irq_restore(flags);
+}
+
+extern "C" void softirq_irq_exit(void) {
+  auto* cpu = cpu_local();
+  if (!cpu->softirq_pending || cpu->in_softirq) return;
+
+  cpu->in_softirq = 1;
+  const uint64_t budget = (arch_counter_freq() * SOFTIRQ_BUDGET_US) / 1000000ull;
+  const uint64_t start = arch_counter_read();
+  for (unsigned pass = 1;; ++pass) {
+    const unsigned pending = cpu->softirq_pending;
+    cpu->softirq_pending = 0;
+    // Past the EOI nothing is active, so any interrupt may nest here; its own
+    // exit sees irq_depth > 1 and leaves new bits to this loop.
+    if (IRQ_NESTING) local_irq_enable();
+    softirq_run_mask(pending);
+    if (IRQ_NESTING) local_irq_disable();
+    if (!cpu->softirq_pending) break;
+    if (pass >= SOFTIRQ_MAX_RESTART || arch_counter_read() - start >= budget) {
+      wakeup_ksoftirqd();
+      break;
+    }
+  }
+  cpu->in_softirq = 0;
+}
+
+extern "C" uint64_t softirq_count(unsigned nr) {
+  return (nr < SOFTIRQ_NR) ? g_softirq_runs[nr] : 0;
+}
@@ -0,0 +1,17 @@
+#include "static_pool.h"
+
+#include "drivers/uart_pl011.h"
+
+extern "C" void static_pool_print(const char* name, const struct static_pool_stats* s) {
+  if (!s) return;
+  uart_puts("[static_pool] "); uart_puts(name ? name : "?");
+  uart_puts(" obj="); uart_print_u64(s->obj_size);
+  uart_puts(" cap="); uart_print_u64(s->capacity);
+  uart_puts(" bytes="); uart_print_u64(s->footprint);
+  uart_puts(" in_use="); uart_print_u64(s->in_use);
+  uart_puts(" high_water="); uart_print_u64(s->high_water);
+  uart_puts(" allocs="); uart_print_u64(s->allocs);
+  uart_puts(" failed="); uart_print_u64(s->failed);
+  uart_puts(" bad_frees="); uart_print_u64(s->bad_frees);
+  uart_puts("\n");
+}
@@ -1,53 +1,89 @@
 #include "sync.h"
 
 #include "arch/cpu_local.h"
-#include "drivers/uart_pl011.h"
+#include "arch/irqflags.h"
+#include "lockdep.h"
 #include "preempt.h"
+#include "waitq.h"
 
 namespace {
-#ifndef SYNC_LAB_MODE
-#define SYNC_LAB_MODE 0
-#endif
-
 #ifndef MUTEX_PI
 #define MUTEX_PI 1
 #endif
 
-#if SYNC_LAB_MODE == 5
-#define LOCKDEP_ENABLED 1
-#else
-#define LOCKDEP_ENABLED 0
+constexpr unsigned kCompletionAll = ~0u;
+
+static void thread_owned_mutex_add(Thread* t, mutex* m) {
+  if (!t || !m) return;
+  m->owner_next = t->owned_mutexes;
+  t->owned_mutexes = m;
+}
+
+static void thread_owned_mutex_remove(Thread* t, mutex* m) {
+  if (!t || !m) return;
+  mutex* prev = nullptr;
+  for (mutex* it = t->owned_mutexes; it; it = it->owner_next) {
+    if (it == m) {
+      if (prev) {
+        prev->owner_next = it->owner_next;
+      } else {
+        t->owned_mutexes = it->owner_next;
+      }
+      it->owner_next = nullptr;
+      return;
+    }
+    prev = it;
+  }
+}
+
+static void mutex_apply_pi(mutex* m) {
+  if (!m || !m->pi_enabled) return;
+  if (!m->owner) return;
+  thread_recompute_priority(m->owner);
+}
+
+// Move a thread dequeued from a condvar onto |m|'s wait-queue without waking
+// it; mutex_unlock() later hands it the mutex directly.
+static void condvar_requeue(Thread* t, mutex* m) {
+  t->waiting_on = m;
+  waitq_append(&m->waiters, t);
+  mutex_apply_pi(m);
+}
+}  // namespace
+
+extern "C" void thread_recompute_priority(Thread* t) {
+  if (!t) return;
+  int eff = thread_base_priority(t);
+#if MUTEX_PI
+  for (mutex* m = t->owned_mutexes; m; m = m->owner_next) {
+    if (!m->pi_enabled) continue;
+    int w = waitq_max_priority(m->waiters);
+    if (w > eff) eff = w;
+  }
 #endif
+  if (t->ipc_donated_prio > eff) eff = t->ipc_donated_prio;
+  thread_set_effective_priority(t, eff);
+}
 
-#if LOCKDEP_ENABLED
-static void lockdep_panic_deadlock(Thread* cur, mutex* m) {
-  uart_puts("[lockdep] deadlock cycle detected: tid=");
-  uart_print_u64(static_cast<unsigned long long>(cur ? cur->id : -1));
-  uart_puts(" waiting_on=0x");
-  uart_print_u64(static_cast<unsigned long long>(reinterpret_cast<uintptr_t>(m)));
-  uart_puts("\n");
-  uart_puts("[lockdep] result PASS\n");
-  while (1) {
-    asm volatile("wfe");
+extern "C" void waitq_append(Thread** head, Thread* t) {
+  t->wait_next = nullptr;
+  Thread** link = head;
+  while (*link) {
+    link = &(*link)->wait_next;
   }
+  *link = t;
 }
 
-static bool lockdep_would_deadlock(Thread* cur, mutex* m) {
-  if (!cur || !m) return false;
-  Thread* owner = m->owner;
-  // Walk the owner -> waiting_on -> owner chain looking for a cycle to |cur|.
-  // This is sufficient to catch classic AB/BA deadlocks and small cycles.
-  for (unsigned depth = 0; owner && depth < 16u; ++depth) {
-    if (owner == cur) return true;
-    mutex* wait = owner->waiting_on;
-    if (!wait) break;
-    owner = wait->owner;
+extern "C" int waitq_max_priority(Thread* head) {
+  int best = -1;
+  for (Thread* t = head; t; t = t->wait_next) {
+    int prio = thread_effective_priority(t);
+    if (prio > best) best = prio;
   }
-  return false;
+  return best;
 }
-#endif
 
-static Thread* waitq_pop_highest(Thread** head) {
+extern "C" Thread* waitq_pop_highest(Thread** head) {
   if (!head || !*head) return nullptr;
 
   Thread* best_prev = nullptr;
@@ -74,64 +110,55 @@ static Thread* waitq_pop_highest(Thread** head) {
   return best;
 }
 
-static int waitq_max_priority(Thread* head) {
-  int best = -1;
-  for (Thread* t = head; t; t = t->wait_next) {
-    int prio = thread_effective_priority(t);
-    if (prio > best) best = prio;
-  }
-  return best;
-}
-
-static void thread_owned_mutex_add(Thread* t, mutex* m) {
-  if (!t || !m) return;
-  m->owner_next = t->owned_mutexes;
-  t->owned_mutexes = m;
-}
-
-static void thread_owned_mutex_remove(Thread* t, mutex* m) {
-  if (!t || !m) return;
-  mutex* prev = nullptr;
-  for (mutex* it = t->owned_mutexes; it; it = it->owner_next) {
-    if (it == m) {
-      if (prev) {
-        prev->owner_next = it->owner_next;
-      } else {
-        t->owned_mutexes = it->owner_next;
-      }
-      it->owner_next = nullptr;
-      return;
+extern "C" int waitq_remove(Thread** head, Thread* t) {
+  if (!head || !t) return 0;
+  for (Thread** link = head; *link; link = &(*link)->wait_next) {
+    if (*link == t) {
+      *link = t->wait_next;
+      t->wait_next = nullptr;
+      return 1;
     }
-    prev = it;
   }
+  return 0;
 }
 
-static void recompute_effective_priority(Thread* t) {
-  if (!t) return;
-  int eff = thread_base_priority(t);
-#if MUTEX_PI
-  for (mutex* m = t->owned_mutexes; m; m = m->owner_next) {
-    if (!m->pi_enabled) continue;
-    int w = waitq_max_priority(m->waiters);
-    if (w > eff) eff = w;
+extern "C" void waitq_wake(Thread* t) {
+  sched_make_runnable(t);
+  auto* cpu = cpu_local();
+  if (cpu && cpu->current_thread &&
+      thread_effective_priority(t) > thread_effective_priority(cpu->current_thread)) {
+    cpu->need_resched = 1;
   }
-#endif
-  thread_set_effective_priority(t, eff);
-}
-
-static void mutex_apply_pi(mutex* m) {
-  if (!m || !m->pi_enabled) return;
-  if (!m->owner) return;
-  recompute_effective_priority(m->owner);
 }
-}  // namespace
 
-extern "C" void mutex_init(mutex* m) {
+extern "C" void mutex_init_key(mutex* m, const void* key, const char* name) {
   if (!m) return;
   m->owner = nullptr;
   m->waiters = nullptr;
   m->owner_next = nullptr;
   m->pi_enabled = MUTEX_PI ? 1 : 0;
+  m->lock_key = key;
+  m->lock_name = name;
+  m->lock_class = -1;
+}
+
+extern "C" void mutex_destroy(mutex* m) {
+  if (!m) return;
+#if LOCKDEP_ENABLED
+  if (!m->lock_key || m->lock_key == m) {
+    preempt_disable();
+    lockdep_free_key(m);
+    preempt_enable();
+  }
+#endif
+  m->lock_class = -1;
+}
+
+extern "C" void mutex_set_lock_class(mutex* m, const void* key, const char* name) {
+  if (!m) return;
+  m->lock_key = key;
+  m->lock_name = name;
+  m->lock_class = -1;
 }
 
 extern "C" void mutex_set_pi_enabled(mutex* m, int enabled) {
@@ -139,7 +166,7 @@ extern "C" void mutex_set_pi_enabled(mutex* m, int enabled) {
   preempt_disable();
   m->pi_enabled = enabled ? 1 : 0;
   if (m->owner) {
-    recompute_effective_priority(m->owner);
+    thread_recompute_priority(m->owner);
   }
   preempt_enable();
 }
@@ -147,6 +174,9 @@ extern "C" void mutex_set_pi_enabled(mutex* m, int enabled) {
 extern "C" void mutex_lock(mutex* m) {
   if (!m) return;
 
+#if LOCKDEP_ENABLED
+  bool lockdep_checked = false;
+#endif
   for (;;) {
     preempt_disable();
     auto* cpu = cpu_local();
@@ -163,6 +193,15 @@ extern "C" void mutex_lock(mutex* m) {
       return;
     }
 
+#if LOCKDEP_ENABLED
+    // Validate the acquisition order up front, whether or not we would block:
+    // an inversion is reported the first time it is attempted.
+    if (!lockdep_checked) {
+      lockdep_acquire(cur, m);
+      lockdep_checked = true;
+    }
+#endif
+
     if (m->owner == nullptr) {
       m->owner = cur;
       thread_owned_mutex_add(cur, m);
@@ -171,12 +210,6 @@ extern "C" void mutex_lock(mutex* m) {
       return;
     }
 
-#if LOCKDEP_ENABLED
-    if (lockdep_would_deadlock(cur, m)) {
-      lockdep_panic_deadlock(cur, m);
-    }
-#endif
-
     // Block.
     cur->waiting_on = m;
     cur->wait_next = m->waiters;
@@ -242,7 +275,7 @@ extern "C" void mutex_unlock(mutex* m) {
     m->owner = nullptr;
   }
 
-  recompute_effective_priority(cur);
+  thread_recompute_priority(cur);
   if (next_owner && cpu && cpu->current_thread == cur &&
       thread_effective_priority(next_owner) > thread_effective_priority(cur)) {
     cpu->need_resched = 1;
@@ -259,8 +292,10 @@ extern "C" void sem_init(semaphore* s, int initial_count) {
 extern "C" void sem_down(semaphore* s) {
   if (!s) return;
   preempt_disable();
+  unsigned long flags = local_irq_save();
   s->count--;
   if (s->count >= 0) {
+    local_irq_restore(flags);
     preempt_enable();
     return;
   }
@@ -268,6 +303,8 @@ extern "C" void sem_down(semaphore* s) {
   auto* cpu = cpu_local();
   Thread* cur = cpu ? cpu->current_thread : nullptr;
   if (!cur) {
+    s->count++;
+    local_irq_restore(flags);
     preempt_enable();
     return;
   }
@@ -277,25 +314,184 @@ extern "C" void sem_down(semaphore* s) {
   s->waiters = cur;
   sched_block_current();
   cpu->need_resched = 1;
+  local_irq_restore(flags);
   preempt_enable();
 }
 
+extern "C" int sem_trydown(semaphore* s) {
+  if (!s) return -1;
+  unsigned long flags = local_irq_save();
+  int ret = -1;
+  if (s->count > 0) {
+    s->count--;
+    ret = 0;
+  }
+  local_irq_restore(flags);
+  return ret;
+}
+
 extern "C" void sem_up(semaphore* s) {
   if (!s) return;
   preempt_disable();
+  unsigned long flags = local_irq_save();
 
   s->count++;
   if (s->count <= 0) {
     Thread* t = waitq_pop_highest(&s->waiters);
     if (t) {
-      sched_make_runnable(t);
-      auto* cpu = cpu_local();
-      if (cpu && cpu->current_thread &&
-          thread_effective_priority(t) > thread_effective_priority(cpu->current_thread)) {
-        cpu->need_resched = 1;
-      }
+      waitq_wake(t);
+    }
+  }
+
+  local_irq_restore(flags);
+  preempt_enable();
+}
+
+extern "C" void condvar_init(condvar* cv) {
+  if (!cv) return;
+  cv->waiters = nullptr;
+  cv->m = nullptr;
+}
+
+extern "C" void condvar_wait(condvar* cv, mutex* m) {
+  if (!cv || !m) return;
+  preempt_disable();
+  auto* cpu = cpu_local();
+  Thread* cur = cpu ? cpu->current_thread : nullptr;
+  if (!cur || m->owner != cur) {
+    preempt_enable();
+    return;
+  }
+
+  // Queue first, then release: with preemption disabled no signal can slip
+  // in between, so the release+block pair is atomic.
+  cv->m = m;
+  cur->waiting_on = nullptr;
+  sched_block_current();
+  waitq_append(&cv->waiters, cur);
+  mutex_unlock(m);
+  cpu->need_resched = 1;
+  preempt_enable();
+
+  // Either woken with the mutex free, or requeued and already handed the
+  // mutex (mutex_lock() then returns immediately).
+  mutex_lock(m);
+}
+
+extern "C" void condvar_signal(condvar* cv) {
+  if (!cv) return;
+  preempt_disable();
+  Thread* t = waitq_pop_highest(&cv->waiters);
+  if (t) {
+    mutex* m = cv->m;
+    if (m && m->owner) {
+      condvar_requeue(t, m);
+    } else {
+      waitq_wake(t);
     }
   }
+  if (!cv->waiters) cv->m = nullptr;
+  preempt_enable();
+}
+
+extern "C" void condvar_broadcast(condvar* cv) {
+  if (!cv) return;
+  preempt_disable();
+  mutex* m = cv->m;
+  if (m && !m->owner) {
+    // Nobody holds the mutex: wake exactly one thread to take it; the rest
+    // follow through mutex_unlock() handoff.
+    Thread* t = waitq_pop_highest(&cv->waiters);
+    if (t) waitq_wake(t);
+  }
+  while (Thread* t = waitq_pop_highest(&cv->waiters)) {
+    condvar_requeue(t, m);
+  }
+  cv->m = nullptr;
+  preempt_enable();
+}
+
+extern "C" void init_completion(completion* c) {
+  if (!c) return;
+  c->done = 0;
+  c->waiters = nullptr;
+}
+
+extern "C" void reinit_completion(completion* c) {
+  if (!c) return;
+  preempt_disable();
+  unsigned long flags = local_irq_save();
+  c->done = 0;
+  local_irq_restore(flags);
+  preempt_enable();
+}
+
+extern "C" void wait_for_completion(completion* c) {
+  if (!c) return;
+  preempt_disable();
+  // IRQs stay masked from the check to the append, so a complete() from an
+  // interrupt handler either sees this waiter or banks done before we look.
+  unsigned long flags = local_irq_save();
+  if (c->done) {
+    if (c->done != kCompletionAll) c->done--;
+    local_irq_restore(flags);
+    preempt_enable();
+    return;
+  }
 
+  auto* cpu = cpu_local();
+  Thread* cur = cpu ? cpu->current_thread : nullptr;
+  if (!cur) {
+    local_irq_restore(flags);
+    preempt_enable();
+    return;
+  }
+
+  cur->waiting_on = nullptr;
+  sched_block_current();
+  waitq_append(&c->waiters, cur);
+  cpu->need_resched = 1;
+  local_irq_restore(flags);
+  preempt_enable();
+}
+
+extern "C" int try_wait_for_completion(completion* c) {
+  if (!c) return -1;
+  preempt_disable();
+  unsigned long flags = local_irq_save();
+  int ret = -1;
+  if (c->done) {
+    if (c->done != kCompletionAll) c->done--;
+    ret = 0;
+  }
+  local_irq_restore(flags);
+  preempt_enable();
+  return ret;
+}
+
+extern "C" void complete(completion* c) {
+  if (!c) return;
+  preempt_disable();
+  unsigned long flags = local_irq_save();
+  Thread* t = waitq_pop_highest(&c->waiters);
+  if (t) {
+    // Direct handoff: the woken waiter owns this completion.
+    waitq_wake(t);
+  } else if (c->done < kCompletionAll - 1u) {
+    c->done++;
+  }
+  local_irq_restore(flags);
+  preempt_enable();
+}
+
+extern "C" void complete_all(completion* c) {
+  if (!c) return;
+  preempt_disable();
+  unsigned long flags = local_irq_save();
+  c->done = kCompletionAll;
+  while (Thread* t = waitq_pop_highest(&c->waiters)) {
+    waitq_wake(t);
+  }
+  local_irq_restore(flags);
   preempt_enable();
 }
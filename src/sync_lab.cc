@@ -20,12 +20,24 @@ volatile int g_high_done = 0;
 mutex g_dl_a;
 mutex g_dl_b;
 semaphore g_dl_hold;
+semaphore g_dl_step;
 volatile unsigned g_dl_ready = 0;
 volatile int g_dl_done = 0;
 volatile unsigned g_dl_mode = 0;
 Thread* g_dl_t1 = nullptr;
 Thread* g_dl_t2 = nullptr;
 
+// Condvar/completion lab state (1 producer / 3 consumers).
+constexpr unsigned kCvConsumers = 3;
+mutex g_cv_lock;
+condvar g_cv;
+completion g_cv_done;
+completion g_cv_release;
+semaphore g_cv_hold;
+volatile int g_cv_ready = 0;
+volatile unsigned g_cv_woken = 0;
+volatile unsigned g_cv_released = 0;
+
 static inline void spin(unsigned n) {
   for (volatile unsigned i = 0; i < n; ++i) {
     asm volatile("" ::: "memory");
@@ -200,6 +212,22 @@ static void deadlock_worker(void* arg) {
     uart_puts("[deadlock-lab] T"); uart_print_u64(tid); uart_puts(" locking second...\n");
     mutex_lock(second);  // Expected to trigger lockdep and halt.
     uart_puts("[deadlock-lab] BUG: lockdep did not trigger\n");
+  } else if (g_dl_mode == 6u) {
+    // Fix #3b: the AB/BA orders never overlap (no actual deadlock), but the
+    // lock-class graph still reports the inversion on the first BA attempt.
+    if (tid == 2) {
+      sem_down(&g_dl_step);
+    }
+    mutex_lock(first);
+    mutex_lock(second);
+    uart_puts("[deadlock-lab] T"); uart_print_u64(tid); uart_puts(" acquired both (serialized)\n");
+    mutex_unlock(second);
+    mutex_unlock(first);
+    if (tid == 1) {
+      sem_up(&g_dl_step);
+    } else {
+      uart_puts("[deadlock-lab] BUG: lockdep did not trigger\n");
+    }
   } else {
     uart_puts("[deadlock-lab] invalid mode\n");
   }
@@ -250,7 +278,7 @@ static void deadlock_watchdog(void*) {
         break;
       }
     } else {
-      // Mode 5 halts inside lockdep on success; nothing to do here.
+      // Modes 5/6 halt inside lockdep on success; nothing to do here.
       if (dt >= 200) {
         uart_puts("[deadlock-lab] FAIL: lockdep did not trigger\n");
         break;
@@ -265,6 +293,55 @@ static void deadlock_watchdog(void*) {
     asm volatile("wfe");
   }
 }
+static unsigned waitq_len(Thread* head) {
+  unsigned n = 0;
+  for (Thread* t = head; t; t = t->wait_next) n++;
+  return n;
+}
+
+static void cv_consumer(void* arg) {
+  const unsigned id = static_cast<unsigned>(reinterpret_cast<uintptr_t>(arg));
+  mutex_lock(&g_cv_lock);
+  while (!g_cv_ready) {
+    condvar_wait(&g_cv, &g_cv_lock);
+  }
+  g_cv_woken++;
+  uart_puts("[cv-lab] C"); uart_print_u64(id); uart_puts(" woke with lock held\n");
+  mutex_unlock(&g_cv_lock);
+  complete(&g_cv_done);
+
+  wait_for_completion(&g_cv_release);
+  g_cv_released++;
+  sem_down(&g_cv_hold);
+}
+
+static void cv_producer(void*) {
+  uart_puts("[cv-lab] producer start\n");
+  mutex_lock(&g_cv_lock);
+  g_cv_ready = 1;
+  condvar_broadcast(&g_cv);
+
+  // We still hold the mutex, so broadcast must have requeued every waiter
+  // onto it instead of waking threads that would immediately block again.
+  const unsigned requeued = waitq_len(g_cv_lock.waiters);
+  uart_puts("[cv-lab] broadcast requeued="); uart_print_u64(requeued); uart_puts("\n");
+  mutex_unlock(&g_cv_lock);
+
+  for (unsigned i = 0; i < kCvConsumers; ++i) {
+    wait_for_completion(&g_cv_done);
+  }
+  complete_all(&g_cv_release);
+  thread_yield();
+
+  if (requeued == kCvConsumers && g_cv_woken == kCvConsumers && g_cv_released == kCvConsumers) {
+    uart_puts("[cv-lab] result PASS\n");
+  } else {
+    uart_puts("[cv-lab] FAIL\n");
+  }
+  while (1) {
+    asm volatile("wfe");
+  }
+}
 }  // namespace
 
 extern "C" void sync_lab_setup(unsigned mode) {
@@ -299,7 +376,7 @@ extern "C" void sync_lab_setup(unsigned mode) {
     return;
   }
 
-  if (mode >= 2u && mode <= 5u) {
+  if (mode >= 2u && mode <= 6u) {
     uart_puts("[deadlock-lab] setup\n");
     g_dl_mode = mode;
     g_dl_done = 0;
@@ -309,7 +386,10 @@ extern "C" void sync_lab_setup(unsigned mode) {
 
     mutex_init(&g_dl_a);
     mutex_init(&g_dl_b);
+    mutex_set_lock_class(&g_dl_a, &g_dl_a, "dl_a");
+    mutex_set_lock_class(&g_dl_b, &g_dl_b, "dl_b");
     sem_init(&g_dl_hold, 0);
+    sem_init(&g_dl_step, 0);
 
     // Two workers intentionally acquire locks in opposite order. A watchdog
     // thread guarantees there is always at least one runnable thread.
@@ -330,8 +410,43 @@ extern "C" void sync_lab_setup(unsigned mode) {
     return;
   }
 
+  if (mode == 7u) {
+    uart_puts("[cv-lab] setup\n");
+    g_cv_ready = 0;
+    g_cv_woken = 0;
+    g_cv_released = 0;
+    mutex_init(&g_cv_lock);
+    condvar_init(&g_cv);
+    init_completion(&g_cv_done);
+    init_completion(&g_cv_release);
+    sem_init(&g_cv_hold, 0);
+
+    // Consumers outrank the producer so they are all parked on the condvar
+    // before the producer broadcasts.
+    Thread* p = thread_create_prio(cv_producer, nullptr, 16 * 1024, /*prio=*/10);
+    if (!p) {
+      uart_puts("[cv-lab] thread_create failed\n");
+      while (1) {
+        asm volatile("wfe");
+      }
+    }
+    for (unsigned i = 0; i < kCvConsumers; ++i) {
+      Thread* c = thread_create_prio(cv_consumer, reinterpret_cast<void*>(static_cast<uintptr_t>(i + 1u)),
+                                     16 * 1024, /*prio=*/20);
+      if (!c) {
+        uart_puts("[cv-lab] thread_create failed\n");
+        while (1) {
+          asm volatile("wfe");
+        }
+      }
+      sched_add(c);
+    }
+    sched_add(p);
+    return;
+  }
+
   uart_puts("[sync-lab] unknown mode\n");
-  uart_puts("[sync-lab] modes: 1=pi, 2=deadlock, 3=ordering, 4=trylock, 5=lockdep\n");
+  uart_puts("[sync-lab] modes: 1=pi, 2=deadlock, 3=ordering, 4=trylock, 5=lockdep, 6=lockdep-order, 7=condvar\n");
   while (1) {
     asm volatile("wfe");
   }
@@ -3,10 +3,14 @@
 #include "arch/ctx.h"
 #include "arch/cpu_local.h"
 #include "arch/fpsimd.h"
+#include "arch/irqflags.h"
 #include "arch/mmu.h"
 #include "drivers/uart_pl011.h"
 #include "kmem.h"
-#include "mem_pool.h"
+#include "kmem_cache.h"
+#include "preempt.h"
+#include "softirq.h"
+#include "waitq.h"
 
 #include <stddef.h>
 #include <stdint.h>
@@ -42,13 +46,19 @@ Thread* rq_head = nullptr;
 Thread* rq_tail = nullptr;
 int next_thread_id = 1;
 
-mem_pool g_thread_pool;
-int g_thread_pool_inited = 0;
+// Threads with an armed timeout, earliest wake_tick first.
+Thread* g_timeout_head = nullptr;
 
-constexpr size_t kThreadPoolAlign = 16;
-constexpr size_t kThreadPoolBlockSize = (sizeof(Thread) + (kThreadPoolAlign - 1u)) & ~(kThreadPoolAlign - 1u);
-constexpr size_t kThreadPoolCount = 32;
-constexpr size_t kThreadPoolBytes = (kThreadPoolBlockSize * kThreadPoolCount) + kThreadPoolAlign;
+// Thread structs stay zeroed while cached, so creation skips clearing them.
+// Anything handed back to the cache must be zero again.
+kmem_cache* g_thread_cache = nullptr;
+
+static void thread_ctor(void* obj) {
+  volatile uint8_t* t_bytes = static_cast<volatile uint8_t*>(obj);
+  for (size_t i = 0; i < sizeof(Thread); ++i) {
+    t_bytes[i] = 0;
+  }
+}
 
 static inline int clamp_priority(int prio) {
   if (prio < 0) return 0;
@@ -155,6 +165,42 @@ static void rq_remove(Thread* t) {
   t->next = nullptr;
 }
 
+// Timeout list helpers; callers mask IRQs (the list is walked from the timer softirq).
+static void timeout_insert(Thread* t) {
+  Thread** link = &g_timeout_head;
+  while (*link && (*link)->wake_tick <= t->wake_tick) {
+    link = &(*link)->timeout_next;
+  }
+  t->timeout_next = *link;
+  *link = t;
+  t->timeout_armed = 1;
+}
+
+static void timeout_remove(Thread* t) {
+  if (!t->timeout_armed) return;
+  for (Thread** link = &g_timeout_head; *link; link = &(*link)->timeout_next) {
+    if (*link == t) {
+      *link = t->timeout_next;
+      break;
+    }
+  }
+  t->timeout_next = nullptr;
+  t->timeout_waitq = nullptr;
+  t->timeout_armed = 0;
+}
+
+static void timeout_expire(unsigned long now) {
+  while (g_timeout_head && g_timeout_head->wake_tick <= now) {
+    Thread* t = g_timeout_head;
+    Thread** waitq = t->timeout_waitq;
+    timeout_remove(t);
+    if (t->state != kThreadBlocked) continue;
+    if (waitq) waitq_remove(waitq, t);
+    t->wait_result = -1;
+    waitq_wake(t);
+  }
+}
+
 #if defined(SCHED_POLICY_PRIO)
 static int rq_max_ready_priority() {
   if (!rq_head) return -1;
@@ -215,24 +261,32 @@ static Thread* prio_pick_next(Thread* cur, bool exclude_current, bool rotate_equ
 
 static void do_switch(Thread* cur, Thread* next) {
   auto* cpu = cpu_local();
+  // Switch with IRQs masked. |flags| stays on |cur|'s stack, so each thread
+  // gets its own mask back when it is switched in again (an IRQ-exit switch
+  // resumes masked and erets; new threads unmask in sched_thread_start()).
+  unsigned long flags = local_irq_save();
   // Use the no-argument FPSIMD API (state is read/written via cpu_local()->current_thread).
   // Save current thread FPSIMD, switch current_thread, then restore next thread FPSIMD.
   fpsimd_save();
   cpu->current_thread = next;
   arch_switch(&cur->sp, next->sp);
   fpsimd_load();
+  local_irq_restore(flags);
 }
 }
 
+extern "C" void sched_thread_start(void) {
+  local_irq_enable();
+}
+
 extern "C" void sched_init(void) {
   rq_head = nullptr;
   rq_tail = nullptr;
+  g_timeout_head = nullptr;
   next_thread_id = 1;
 
-  g_thread_pool_inited = 0;
-  void* backing = kmem_alloc_aligned(kThreadPoolBytes, kThreadPoolAlign);
-  if (backing && mem_pool_init(&g_thread_pool, backing, kThreadPoolBytes, kThreadPoolBlockSize) == 0) {
-    g_thread_pool_inited = 1;
+  if (!g_thread_cache) {
+    g_thread_cache = kmem_cache_create("thread", sizeof(Thread), alignof(Thread), thread_ctor);
   }
 }
 
@@ -247,37 +301,24 @@ extern "C" Thread* thread_create_prio(void (*entry)(void*), void* arg, size_t st
     return nullptr;
   }
 
-  Thread* t = nullptr;
-  if (g_thread_pool_inited) {
-    t = reinterpret_cast<Thread*>(mem_pool_alloc(&g_thread_pool));
-  }
-  if (!t) {
-    t = reinterpret_cast<Thread*>(kmem_alloc_aligned(sizeof(Thread), alignof(Thread)));
-  }
+  // Comes back zeroed (thread_ctor); both error paths below return it
+  // untouched.
+  Thread* t = static_cast<Thread*>(kmem_cache_alloc(g_thread_cache));
   if (!t) {
     uart_puts("[sched][err] no memory for Thread struct\n");
     return nullptr;
   }
 
-  volatile uint8_t* t_bytes = reinterpret_cast<volatile uint8_t*>(t);
-  for (size_t i = 0; i < sizeof(Thread); ++i) {
-    t_bytes[i] = 0;
-  }
-
   if (stack_size > (static_cast<size_t>(-1) - kStackGuardPageBytes)) {
     uart_puts("[sched][err] stack too large\n");
-    if (g_thread_pool_inited && mem_pool_owns(&g_thread_pool, t)) {
-      mem_pool_free(&g_thread_pool, t);
-    }
+    kmem_cache_free(g_thread_cache, t);
     return nullptr;
   }
 
   void* stack_alloc = kmem_alloc_aligned(stack_size + kStackGuardPageBytes, kStackGuardPageBytes);
   if (!stack_alloc) {
     uart_puts("[sched][err] no memory for thread stack\n");
-    if (g_thread_pool_inited && mem_pool_owns(&g_thread_pool, t)) {
-      mem_pool_free(&g_thread_pool, t);
-    }
+    kmem_cache_free(g_thread_cache, t);
     return nullptr;
   }
   // Guard page lives below the usable stack region; stack grows down.
@@ -318,6 +359,15 @@ extern "C" Thread* thread_create_prio(void (*entry)(void*), void* arg, size_t st
   t->wait_next = nullptr;
   t->waiting_on = nullptr;
   t->owned_mutexes = nullptr;
+  t->ipc_buf = nullptr;
+  t->ipc_partner = nullptr;
+  t->ipc_donated_prio = -1;
+  t->ipc_saved_budget = kQuantumTicks;
+  t->wake_tick = 0;
+  t->timeout_next = nullptr;
+  t->timeout_waitq = nullptr;
+  t->timeout_armed = 0;
+  t->wait_result = 0;
   // FPSIMD state was zeroed above: fpsimd_valid=0, vregs=0, fpcr/fpsr=0.
 
   uart_puts("[sched][diag] thread created id=");
@@ -335,10 +385,12 @@ extern "C" void sched_add(Thread* t) {
   if (!t) {
     return;
   }
+  unsigned long flags = local_irq_save();
   if (t->state != kThreadReady) {
     t->state = kThreadReady;
   }
   rq_append(t);
+  local_irq_restore(flags);
 }
 
 extern "C" void sched_start(void) {
@@ -353,6 +405,9 @@ extern "C" void sched_start(void) {
     }
   }
   cur->budget = kQuantumTicks;
+  // An IRQ exit must not see current_thread while we are still on the boot
+  // stack; the trampoline unmasks again.
+  local_irq_disable();
   cpu_local()->current_thread = cur;
   void* boot_sp = nullptr;
   arch_switch(&boot_sp, cur->sp);
@@ -390,9 +445,18 @@ extern "C" __attribute__((noreturn)) void thread_exit(void) {
   }
 }
 
+extern "C" void sched_run_timeouts(void) {
+  unsigned long flags = local_irq_save();
+  timeout_expire(cpu_local()->ticks);
+  local_irq_restore(flags);
+}
+
 extern "C" void sched_on_tick(void) {
   auto* cpu = cpu_local();
   Thread* cur = cpu->current_thread;
+  if (g_timeout_head && g_timeout_head->wake_tick <= cpu->ticks) {
+    raise_softirq(SOFTIRQ_TIMER);
+  }
   if (!cur) {
     return;
   }
@@ -440,16 +504,30 @@ extern "C" void sched_resched_from_irq_tail(void) {
   }
 
   Thread* next = nullptr;
+  Thread* handoff = cpu->handoff_next;
+  cpu->handoff_next = nullptr;
+  if (handoff && handoff != cur && is_ready(handoff)) {
+    next = handoff;
 #if defined(SCHED_POLICY_PRIO)
-  const bool rotate = (cpu->need_resched == kNeedReschedRotate);
-  next = prio_pick_next(cur, /*exclude_current=*/rotate, /*rotate_equal=*/rotate);
-#else
-  if (cur && is_ready(cur) && cur->next) {
-    next = cur->next;
-  } else {
-    next = rq_head;
+    // Directed switches never override strict priority.
+    if (rq_has_ready_prio_gt(handoff->effective_priority)) {
+      next = nullptr;
+    }
+#endif
   }
+
+  if (!next) {
+#if defined(SCHED_POLICY_PRIO)
+    const bool rotate = (cpu->need_resched == kNeedReschedRotate);
+    next = prio_pick_next(cur, /*exclude_current=*/rotate, /*rotate_equal=*/rotate);
+#else
+    if (cur && is_ready(cur) && cur->next) {
+      next = cur->next;
+    } else {
+      next = rq_head;
+    }
 #endif
+  }
 
   if (!cur || !next || next == cur) {
     cpu->need_resched = kNeedReschedNone;
@@ -465,18 +543,66 @@ extern "C" void sched_block_current(void) {
   Thread* cur = cpu ? cpu->current_thread : nullptr;
   if (!cur) return;
   if (cur->state == kThreadBlocked) return;
+  unsigned long flags = local_irq_save();
   rq_remove(cur);
   cur->state = kThreadBlocked;
-  cur->wait_next = nullptr;
+  local_irq_restore(flags);
+  // Do not touch wait_next: callers may already have linked |cur| into a
+  // wait-queue, and clearing it would drop every waiter queued behind it.
 }
 
 extern "C" void sched_make_runnable(Thread* t) {
   if (!t) return;
-  if (t->state == kThreadReady) return;
+  // Wakeups may come from IRQ context (e.g. sem_up() in a handler); mask
+  // IRQs so a thread-context rq_remove() never interleaves with rq_append().
+  unsigned long flags = local_irq_save();
+  if (t->state == kThreadReady) {
+    local_irq_restore(flags);
+    return;
+  }
+  timeout_remove(t);
   t->state = kThreadReady;
   t->wait_next = nullptr;
   t->budget = kQuantumTicks;
   rq_append(t);
+  local_irq_restore(flags);
+}
+
+extern "C" void sched_timeout_arm(Thread* t, uint64_t deadline, Thread** waitq) {
+  if (!t) return;
+  unsigned long flags = local_irq_save();
+  timeout_remove(t);
+  t->wake_tick = deadline;
+  t->timeout_waitq = waitq;
+  t->wait_result = 0;
+  timeout_insert(t);
+  local_irq_restore(flags);
+}
+
+extern "C" void thread_sleep_until(uint64_t deadline) {
+  auto* cpu = cpu_local();
+  if (!cpu || !cpu->current_thread || cpu->irq_depth) return;
+  preempt_disable();
+  unsigned long flags = local_irq_save();
+  while (cpu->ticks < deadline) {
+    sched_timeout_arm(cpu->current_thread, deadline, nullptr);
+    sched_block_current();
+    cpu->need_resched = kNeedReschedNormal;
+    local_irq_restore(flags);
+    preempt_enable();
+    preempt_disable();
+    flags = local_irq_save();
+  }
+  local_irq_restore(flags);
+  preempt_enable();
+}
+
+extern "C" void sched_handoff(Thread* next) {
+  auto* cpu = cpu_local();
+  if (!cpu || !next) return;
+  sched_make_runnable(next);
+  cpu->handoff_next = next;
+  cpu->need_resched = kNeedReschedNormal;
 }
 
 extern "C" int thread_base_priority(const Thread* t) {
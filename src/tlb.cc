@@ -0,0 +1,59 @@
+#include "tlb.h"
+
+#include "arch/irqflags.h"
+
+namespace {
+tlb_stats g_tlb_stats;
+
+static void tlb_flush_local(const tlb_batch* b) {
+  asm volatile("dsb ishst" ::: "memory");  // PTE updates visible to the walker
+  if (b->full) {
+    asm volatile("tlbi vmalle1" ::: "memory");
+  } else {
+    for (unsigned i = 0; i < b->nr; ++i) {
+      asm volatile("tlbi vaale1, %0" :: "r"(b->va[i] >> 12) : "memory");
+    }
+  }
+  asm volatile("dsb nsh" ::: "memory");
+  asm volatile("isb" ::: "memory");
+}
+
+static void tlb_flush_ipi(void* info) {
+  tlb_flush_local(static_cast<const tlb_batch*>(info));
+}
+}  // namespace
+
+extern "C" void tlb_batch_init(tlb_batch* b) {
+  if (!b) return;
+  b->nr = 0;
+  b->full = 0;
+}
+
+extern "C" void tlb_batch_add(tlb_batch* b, uintptr_t va) {
+  if (!b || b->full) return;
+  if (b->nr == TLB_BATCH_MAX) {
+    b->full = 1;
+    return;
+  }
+  b->va[b->nr++] = va & ~static_cast<uintptr_t>(0xFFFu);
+}
+
+extern "C" void tlb_batch_flush(tlb_batch* b) {
+  if (!b || (!b->nr && !b->full)) return;
+  const int remote = smp_call_function_many(~0u, tlb_flush_ipi, b, /*wait=*/1);
+  unsigned long flags = local_irq_save();
+  tlb_flush_local(b);
+  g_tlb_stats.batches++;
+  g_tlb_stats.pages += b->full ? 0 : b->nr;
+  g_tlb_stats.full += b->full ? 1 : 0;
+  g_tlb_stats.ipis += static_cast<uint64_t>(remote);
+  local_irq_restore(flags);
+  tlb_batch_init(b);
+}
+
+extern "C" void tlb_get_stats(tlb_stats* out) {
+  if (!out) return;
+  unsigned long flags = local_irq_save();
+  *out = g_tlb_stats;
+  local_irq_restore(flags);
+}
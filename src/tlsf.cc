@@ -0,0 +1,320 @@
+#include "tlsf.h"
+
+#include <stdint.h>
+
+#include "drivers/uart_pl011.h"
+
+// Header in front of every block. |prev_phys| is valid only while the
+// previous block is free. The free-list links overlay the first payload bytes
+// and exist only while the block is free.
+struct tlsf_block {
+  tlsf_block* prev_phys;
+  uint64_t    word;         // magic << 32 | size | flags
+  tlsf_block* next_free;
+  tlsf_block* prev_free;
+};
+
+namespace {
+constexpr uint64_t kMagic = 0x544c5346ull << 32;  // "TLSF"
+constexpr uint64_t kMagicMask = 0xFFFFFFFFull << 32;
+constexpr uint64_t kFree = 1u;
+constexpr uint64_t kPrevFree = 2u;
+constexpr uint64_t kSizeMask = 0xFFFFFFFFull & ~static_cast<uint64_t>(15u);
+
+constexpr size_t kAlign = 16;
+constexpr size_t kHeader = 16;                              // prev_phys + word
+constexpr size_t kMinPayload = 16;                          // room for the free links
+constexpr size_t kSmallBlock = size_t{1} << TLSF_FL_SHIFT;  // 256
+constexpr size_t kMaxBlock = size_t{1} << TLSF_FL_MAX;
+static_assert(kSmallBlock / TLSF_SL_COUNT == kAlign, "linear range must step by the alignment");
+static_assert(TLSF_FL_COUNT <= 32, "first-level bitmap is 32 bits");
+
+static inline size_t align_up(size_t v, size_t a) {
+  return (v + a - 1u) & ~(a - 1u);
+}
+
+static inline unsigned fls_sz(size_t v) {
+  return 63u - static_cast<unsigned>(__builtin_clzll(v));
+}
+
+static inline unsigned ffs32(uint32_t v) {
+  return static_cast<unsigned>(__builtin_ctz(v));
+}
+
+static inline size_t block_size(const tlsf_block* b) {
+  return static_cast<size_t>(b->word & kSizeMask);
+}
+
+static inline void block_set_size(tlsf_block* b, size_t size) {
+  b->word = (b->word & ~kSizeMask) | size;
+}
+
+static inline bool block_is_free(const tlsf_block* b) {
+  return (b->word & kFree) != 0;
+}
+
+static inline bool block_prev_free(const tlsf_block* b) {
+  return (b->word & kPrevFree) != 0;
+}
+
+static inline bool block_valid(const tlsf_block* b) {
+  return (b->word & kMagicMask) == kMagic;
+}
+
+static inline void* block_payload(tlsf_block* b) {
+  return reinterpret_cast<uint8_t*>(b) + kHeader;
+}
+
+static inline tlsf_block* block_from_payload(const void* p) {
+  return reinterpret_cast<tlsf_block*>(const_cast<uint8_t*>(static_cast<const uint8_t*>(p)) - kHeader);
+}
+
+static inline tlsf_block* block_next(tlsf_block* b) {
+  return reinterpret_cast<tlsf_block*>(reinterpret_cast<uint8_t*>(b) + kHeader + block_size(b));
+}
+
+static inline void block_mark_free(tlsf_block* b) {
+  b->word |= kFree;
+  tlsf_block* n = block_next(b);
+  n->prev_phys = b;
+  n->word |= kPrevFree;
+}
+
+static inline void block_mark_used(tlsf_block* b) {
+  b->word &= ~kFree;
+  block_next(b)->word &= ~kPrevFree;
+}
+
+// Sizes below 256 map linearly; above, fl is the power of two and sl the
+// linear subdivision inside it.
+static inline void mapping_insert(size_t size, unsigned* fl, unsigned* sl) {
+  if (size < kSmallBlock) {
+    *fl = 0;
+    *sl = static_cast<unsigned>(size / kAlign);
+  } else {
+    const unsigned f = fls_sz(size);
+    *sl = static_cast<unsigned>(size >> (f - TLSF_SL_LOG2)) ^ TLSF_SL_COUNT;
+    *fl = f - (TLSF_FL_SHIFT - 1u);
+  }
+}
+
+// Round up to the next list boundary so any block found there fits.
+static inline void mapping_search(size_t size, unsigned* fl, unsigned* sl) {
+  if (size >= kSmallBlock) {
+    size += (size_t{1} << (fls_sz(size) - TLSF_SL_LOG2)) - 1u;
+  }
+  mapping_insert(size, fl, sl);
+}
+
+static tlsf_block* search_suitable(tlsf_heap* h, unsigned* fl, unsigned* sl) {
+  uint32_t sl_map = h->sl_bitmap[*fl] & (~0u << *sl);
+  if (!sl_map) {
+    const uint32_t fl_map = (*fl + 1u < 32u) ? (h->fl_bitmap & (~0u << (*fl + 1u))) : 0u;
+    if (!fl_map) return nullptr;
+    *fl = ffs32(fl_map);
+    sl_map = h->sl_bitmap[*fl];
+  }
+  *sl = ffs32(sl_map);
+  return h->blocks[*fl][*sl];
+}
+
+static void remove_free(tlsf_heap* h, tlsf_block* b, unsigned fl, unsigned sl) {
+  tlsf_block* prev = b->prev_free;
+  tlsf_block* next = b->next_free;
+  if (next) next->prev_free = prev;
+  if (prev) {
+    prev->next_free = next;
+  } else {
+    h->blocks[fl][sl] = next;
+    if (!next) {
+      h->sl_bitmap[fl] &= ~(1u << sl);
+      if (!h->sl_bitmap[fl]) h->fl_bitmap &= ~(1u << fl);
+    }
+  }
+}
+
+static void insert_free(tlsf_heap* h, tlsf_block* b) {
+  unsigned fl, sl;
+  mapping_insert(block_size(b), &fl, &sl);
+  tlsf_block* head = h->blocks[fl][sl];
+  b->prev_free = nullptr;
+  b->next_free = head;
+  if (head) head->prev_free = b;
+  h->blocks[fl][sl] = b;
+  h->fl_bitmap |= 1u << fl;
+  h->sl_bitmap[fl] |= 1u << sl;
+}
+
+static void unlink_block(tlsf_heap* h, tlsf_block* b) {
+  unsigned fl, sl;
+  mapping_insert(block_size(b), &fl, &sl);
+  remove_free(h, b, fl, sl);
+}
+
+// Carve |size| payload bytes off the front of free block |b|; the rest goes
+// back on a free list if it can hold a block of its own.
+static void split(tlsf_heap* h, tlsf_block* b, size_t size) {
+  const size_t total = block_size(b);
+  if (total < size + kHeader + kMinPayload) return;
+  auto* rest = reinterpret_cast<tlsf_block*>(reinterpret_cast<uint8_t*>(b) + kHeader + size);
+  rest->word = kMagic | (total - size - kHeader);
+  block_set_size(b, size);
+  block_mark_free(rest);     // also points the following block back at |rest|
+  rest->prev_phys = b;
+  insert_free(h, rest);
+}
+}  // namespace
+
+extern "C" int tlsf_add_pool(struct tlsf_heap* h, void* mem, size_t bytes) {
+  if (!h || !mem || h->nr_pools >= TLSF_MAX_POOLS) return -1;
+  const uintptr_t raw = reinterpret_cast<uintptr_t>(mem);
+  const uintptr_t start = align_up(raw, kAlign);
+  if (bytes <= start - raw) return -1;
+  bytes = (bytes - (start - raw)) & ~(kAlign - 1u);
+  // One block plus the zero-sized sentinel that ends the pool.
+  if (bytes < 2u * kHeader + kMinPayload) return -1;
+  const size_t size = bytes - 2u * kHeader;
+  if (size >= kMaxBlock) return -1;
+
+  auto* b = reinterpret_cast<tlsf_block*>(start);
+  b->prev_phys = nullptr;
+  b->word = kMagic | size;   // previous "block" is never free: no merge past the start
+  tlsf_block* sentinel = block_next(b);
+  sentinel->word = kMagic;   // size 0, used
+  block_mark_free(b);
+  insert_free(h, b);
+  h->pools[h->nr_pools++] = b;
+  return 0;
+}
+
+extern "C" int tlsf_init(struct tlsf_heap* h, void* mem, size_t bytes) {
+  if (!h) return -1;
+  h->fl_bitmap = 0;
+  for (unsigned fl = 0; fl < TLSF_FL_COUNT; ++fl) {
+    h->sl_bitmap[fl] = 0;
+    for (unsigned sl = 0; sl < TLSF_SL_COUNT; ++sl) h->blocks[fl][sl] = nullptr;
+  }
+  h->nr_pools = 0;
+  h->mallocs = 0;
+  h->frees = 0;
+  h->failed = 0;
+  h->bad_frees = 0;
+  return tlsf_add_pool(h, mem, bytes);
+}
+
+extern "C" void* tlsf_malloc(struct tlsf_heap* h, size_t size) {
+  if (!h || size == 0 || size >= kMaxBlock) {
+    if (h) h->failed++;
+    return nullptr;
+  }
+  size = align_up(size < kMinPayload ? kMinPayload : size, kAlign);
+
+  unsigned fl, sl;
+  mapping_search(size, &fl, &sl);
+  tlsf_block* b = (fl < TLSF_FL_COUNT) ? search_suitable(h, &fl, &sl) : nullptr;
+  if (!b) {
+    h->failed++;
+    return nullptr;
+  }
+  remove_free(h, b, fl, sl);
+  split(h, b, size);
+  block_mark_used(b);
+  h->mallocs++;
+  return block_payload(b);
+}
+
+extern "C" int tlsf_pool_fits(size_t pool_bytes, size_t size) {
+  pool_bytes &= ~(kAlign - 1u);
+  if (size == 0 || size >= kMaxBlock || pool_bytes < 2u * kHeader + kMinPayload) return 0;
+  const size_t block = pool_bytes - 2u * kHeader;
+  if (block >= kMaxBlock) return 0;
+  size = align_up(size < kMinPayload ? kMinPayload : size, kAlign);
+  if (size > block) return 0;
+  // tlsf_malloc() only searches lists at or above the rounded-up request.
+  unsigned fl, sl, bfl, bsl;
+  mapping_search(size, &fl, &sl);
+  mapping_insert(block, &bfl, &bsl);
+  return (fl < bfl || (fl == bfl && sl <= bsl)) ? 1 : 0;
+}
+
+extern "C" void tlsf_free(struct tlsf_heap* h, void* p) {
+  if (!h || !p) return;
+  tlsf_block* b = block_from_payload(p);
+  if ((reinterpret_cast<uintptr_t>(p) & (kAlign - 1u)) || !block_valid(b) || block_is_free(b) ||
+      block_size(b) == 0) {
+    h->bad_frees++;
+    return;
+  }
+  h->frees++;
+  block_mark_free(b);
+
+  if (block_prev_free(b)) {
+    tlsf_block* prev = b->prev_phys;
+    unlink_block(h, prev);
+    block_set_size(prev, block_size(prev) + kHeader + block_size(b));
+    b->word = 0;   // no longer a header; a stale free of it must not validate
+    b = prev;
+    block_next(b)->prev_phys = b;
+  }
+  tlsf_block* next = block_next(b);
+  if (block_is_free(next)) {
+    unlink_block(h, next);
+    block_set_size(b, block_size(b) + kHeader + block_size(next));
+    next->word = 0;
+    block_next(b)->prev_phys = b;
+  }
+  insert_free(h, b);
+}
+
+extern "C" size_t tlsf_block_size(const void* p) {
+  if (!p) return 0;
+  const tlsf_block* b = block_from_payload(p);
+  return (block_valid(b) && !block_is_free(b)) ? block_size(b) : 0;
+}
+
+extern "C" void tlsf_report_get(const struct tlsf_heap* h, struct tlsf_report* out) {
+  if (!h || !out) return;
+  *out = tlsf_report{};
+  for (unsigned i = 0; i < h->nr_pools; ++i) {
+    auto* b = static_cast<tlsf_block*>(h->pools[i]);
+    for (; block_size(b) != 0; b = block_next(b)) {
+      const size_t sz = block_size(b);
+      out->pool_bytes += kHeader + sz;
+      if (block_is_free(b)) {
+        out->free_bytes += sz;
+        out->free_blocks++;
+        if (sz > out->largest_free) out->largest_free = sz;
+      } else {
+        out->used_bytes += sz;
+        out->used_blocks++;
+      }
+    }
+    out->pool_bytes += kHeader;  // sentinel
+  }
+  if (out->free_bytes) {
+    out->external_frag_pct =
+        static_cast<unsigned>(((out->free_bytes - out->largest_free) * 100u) / out->free_bytes);
+  }
+  out->mallocs = h->mallocs;
+  out->frees = h->frees;
+  out->failed = h->failed;
+  out->bad_frees = h->bad_frees;
+}
+
+extern "C" void tlsf_report_print(const char* tag, const struct tlsf_heap* h) {
+  tlsf_report r;
+  tlsf_report_get(h, &r);
+  uart_puts(tag);
+  uart_puts(" pool="); uart_print_u64(r.pool_bytes);
+  uart_puts(" used="); uart_print_u64(r.used_bytes);
+  uart_puts(" used_blocks="); uart_print_u64(r.used_blocks);
+  uart_puts(" free="); uart_print_u64(r.free_bytes);
+  uart_puts(" free_blocks="); uart_print_u64(r.free_blocks);
+  uart_puts(" largest_free="); uart_print_u64(r.largest_free);
+  uart_puts(" frag_pct="); uart_print_u64(r.external_frag_pct);
+  uart_puts(" mallocs="); uart_print_u64(r.mallocs);
+  uart_puts(" frees="); uart_print_u64(r.frees);
+  uart_puts(" failed="); uart_print_u64(r.failed);
+  uart_puts(" bad_frees="); uart_print_u64(r.bad_frees);
+  uart_puts("\n");
+}
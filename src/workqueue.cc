@@ -0,0 +1,105 @@
+#include "workqueue.h"
+
+#include "arch/irqflags.h"
+#include "drivers/uart_pl011.h"
+#include "static_pool.h"
+#include "thread.h"
+
+#ifndef SYSTEM_WQ_WORKERS
+#define SYSTEM_WQ_WORKERS 2
+#endif
+#ifndef SYSTEM_WQ_PRIO
+#define SYSTEM_WQ_PRIO 10
+#endif
+
+workqueue* system_wq = nullptr;
+
+namespace {
+constexpr size_t kWorkerStack = 8 * 1024;
+// Queues are created at boot and never destroyed; system_wq is one of them.
+constexpr size_t kMaxWorkqueues = 8;
+StaticPool<workqueue, kMaxWorkqueues> g_workqueues;
+
+static work_struct* wq_pop(workqueue* wq) {
+  unsigned long flags = local_irq_save();
+  work_struct* w = wq->head;
+  if (w) {
+    wq->head = w->next;
+    if (!wq->head) wq->tail = nullptr;
+    w->next = nullptr;
+    w->pending = 0;  // may be requeued (even by itself) from here on
+  }
+  local_irq_restore(flags);
+  return w;
+}
+
+static void worker_main(void* p) {
+  auto* wq = static_cast<workqueue*>(p);
+  while (1) {
+    sem_down(&wq->items);
+    work_struct* w = wq_pop(wq);
+    if (!w) continue;
+    w->fn(w);
+    __atomic_fetch_add(&wq->executed, 1ull, __ATOMIC_RELAXED);
+  }
+}
+}  // namespace
+
+extern "C" void work_init(work_struct* work, work_fn_t fn) {
+  if (!work) return;
+  work->next = nullptr;
+  work->fn = fn;
+  work->pending = 0;
+}
+
+extern "C" workqueue* workqueue_create(const char* name, unsigned nr_workers, int prio) {
+  if (nr_workers == 0) return nullptr;
+  workqueue* wq = g_workqueues.alloc();
+  if (!wq) return nullptr;
+  wq->name = name;
+  wq->head = nullptr;
+  wq->tail = nullptr;
+  sem_init(&wq->items, 0);
+  wq->nr_workers = 0;
+  wq->executed = 0;
+  for (unsigned i = 0; i < nr_workers; ++i) {
+    Thread* t = thread_create_prio(worker_main, wq, kWorkerStack, prio);
+    if (!t) break;
+    sched_add(t);
+    wq->nr_workers++;
+  }
+  if (wq->nr_workers == 0) {
+    uart_puts("[wq] no workers for "); uart_puts(name ? name : "?"); uart_puts("\n");
+    g_workqueues.free(wq);
+    return nullptr;
+  }
+  return wq;
+}
+
+extern "C" int queue_work(workqueue* wq, work_struct* work) {
+  if (!wq || !work || !work->fn) return 0;
+  unsigned long flags = local_irq_save();
+  if (work->pending) {
+    local_irq_restore(flags);
+    return 0;
+  }
+  work->pending = 1;
+  work->next = nullptr;
+  if (wq->tail) {
+    wq->tail->next = work;
+  } else {
+    wq->head = work;
+  }
+  wq->tail = work;
+  local_irq_restore(flags);
+  sem_up(&wq->items);
+  return 1;
+}
+
+extern "C" void workqueue_init(void) {
+  system_wq = workqueue_create("system", SYSTEM_WQ_WORKERS, SYSTEM_WQ_PRIO);
+}
+
+extern "C" int schedule_work(work_struct* work) {
+  return queue_work(system_wq, work);
+}